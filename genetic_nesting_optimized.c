@@ -4,47 +4,65 @@
 #include <math.h>
 #include <time.h>
 #include <float.h>
+#include <limits.h>
 #include <stdbool.h>
+#include <stdint.h>
 #include <errno.h>
+#include <stdarg.h>
 
 #ifdef _OPENMP
     #include <omp.h>
 #endif
 
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+    #define SIMD_X86 1
+    #include <immintrin.h>
+#else
+    #define SIMD_X86 0
+#endif
+
 #ifdef _WIN32
     #include <windows.h>
     #include <process.h>
     #define getpid _getpid
 #else
     #include <unistd.h>
+    #include <fcntl.h>
+    #include <sys/mman.h>
+    #include <sys/stat.h>
     #include <sys/time.h>
 #endif
 
-#define MAX_PIECES 100
-#define MAX_POINTS 1000
-#define MAX_BOARDS 50
-#define MAX_ANGLES 10
 #define PI 3.14159265359
 
 // ==================== CONCAVE NESTING FEATURE ====================
 // Feature flag: Set to 0 to disable concave nesting optimization (Phase 3)
 #define ENABLE_CONCAVE_NESTING 1
 
+// Benchmarks (gerador de instancias, microbenchmarks, CSV de progresso): make bench
+#ifndef ENABLE_BENCHMARKS
+#define ENABLE_BENCHMARKS 0
+#endif
+
+// Contadores do hot path e tempos por fase (tabela + JSON no fim); 0 remove tudo
+#ifndef ENABLE_PROFILING
+#define ENABLE_PROFILING 1
+#endif
+
 // Concave nesting parameters - AGRESSIVO PARA EXPLORAÇÃO MÁXIMA
+// (valores padrao; ajustaveis em tempo de execucao, ver --help)
 #define CONCAVITY_THRESHOLD 0.20      // Reduzido para 20% (era 25%) - detecta mais concavidades
 #define GRID_RESOLUTION 50            // Aumentado para 50x50 (era 40x40) - 25% mais pontos candidatos
 #define SUBGRID_RESOLUTION 7          // Aumentado para 7x7 (era 5x5) - refinamento mais fino
 #define MAX_SMALL_PIECE_RATIO 0.35    // Aumentado para 35% (era 25%) - aceita peças maiores em concavidades
 
-// Debug mode: Set to 1 to enable detailed logging
-#define DEBUG_CONCAVE_NESTING 1
-
 // Alternative parameters for experimentation:
 // For maximum precision (slower): GRID_RESOLUTION 60, MAX_SMALL_PIECE_RATIO 0.30
 // For speed (faster): GRID_RESOLUTION 30, MAX_SMALL_PIECE_RATIO 0.20
 // For aggressive fitting: CONCAVITY_THRESHOLD 0.15, MAX_SMALL_PIECE_RATIO 0.35
 
 // Parametros do Algoritmo Genetico - AJUSTADOS PARA EXPLORAÇÃO AGRESSIVA
+// (valores padrao; ajustaveis em tempo de execucao, ver --help)
 #define POPULATION_SIZE 100
 #define GENERATIONS 50
 #define TOURNAMENT_SIZE 3
@@ -58,6 +76,18 @@
 // #define MUTATION_RATE 0.30
 // #define ELITE_SIZE 2
 
+// Valores efetivos: padroes acima, sobrescritos por --config e pela linha de comando
+static int population_size = POPULATION_SIZE;
+static int generations = GENERATIONS;
+static int tournament_size = TOURNAMENT_SIZE;
+static double mutation_rate = MUTATION_RATE;
+static int elite_size = ELITE_SIZE;
+static double concavity_threshold = CONCAVITY_THRESHOLD;
+static int grid_resolution = GRID_RESOLUTION;
+static int subgrid_resolution = SUBGRID_RESOLUTION;
+static double max_small_piece_ratio = MAX_SMALL_PIECE_RATIO;
+static char input_path[256] = "input_shapes.json";
+
 // Core data structures (mesmas do codigo original)
 typedef struct {
     double x, y;
@@ -78,14 +108,266 @@ typedef struct {
 
 #endif // ENABLE_CONCAVE_NESTING
 
-// Pre-allocated buffer pools para evitar malloc/free repetidos
-#define POOL_SIZE 1024
-static Point point_pool[POOL_SIZE];
-static int pool_index = 0;
+// ==================== LOG ====================
+// Nivel das mensagens escolhido em tempo de execucao (--log-level):
+//   silent  - apenas erros e avisos
+//   summary - cabecalhos, progresso a cada 5 geracoes e resultados (padrao)
+//   verbose - tambem cada individuo inicial, migracoes e tentativas da fase 3
+// Dentro de regioes paralelas cada thread acumula as mensagens no proprio
+// buffer, sem lock; o buffer vai para stdout numa unica escrita quando a
+// thread chega ao fim da geracao (log_flush) ou a regiao termina (log_flush_all).
+
+typedef enum {
+    LOG_LEVEL_SILENT,
+    LOG_LEVEL_SUMMARY,
+    LOG_LEVEL_VERBOSE
+} LogLevel;
+
+static int log_level = LOG_LEVEL_SUMMARY;
+
+typedef struct {
+    char* data;
+    size_t length, capacity;
+} LogBuffer;
+
+#define LOG_MAX_THREADS 256
+
+typedef struct {
+    LogBuffer buffer;
+    char padding[64 - sizeof(LogBuffer) % 64];
+} LogSlot;
+
+static LogSlot log_slots[LOG_MAX_THREADS];
+
+static void log_buffer_vappend(LogBuffer* log, const char* format, va_list args) {
+    va_list copy;
+    va_copy(copy, args);
+    int needed = vsnprintf(NULL, 0, format, copy);
+    va_end(copy);
+    if (needed <= 0) return;
+    if (log->length + needed + 1 > log->capacity) {
+        size_t capacity = log->capacity ? log->capacity * 2 : 4096;
+        while (capacity < log->length + needed + 1) capacity *= 2;
+        char* data = realloc(log->data, capacity);
+        if (!data) return;   // Sem memoria: a mensagem e descartada
+        log->data = data;
+        log->capacity = capacity;
+    }
+    vsnprintf(log->data + log->length, needed + 1, format, args);
+    log->length += needed;
+}
+
+static void log_buffer_write(LogBuffer* log) {
+    if (log->length == 0) return;
+    fwrite(log->data, 1, log->length, stdout);
+    fflush(stdout);
+    log->length = 0;
+}
+
+static inline LogBuffer* log_thread_buffer() {
+    #ifdef _OPENMP
+        return &log_slots[omp_get_thread_num() % LOG_MAX_THREADS].buffer;
+    #else
+        return &log_slots[0].buffer;
+    #endif
+}
+
+// Escreve as mensagens pendentes da thread atual
+static void log_flush() {
+    log_buffer_write(log_thread_buffer());
+}
+
+// Fora de regioes paralelas: mensagens pendentes de todas as threads, em ordem
+static void log_flush_all() {
+    for (int t = 0; t < LOG_MAX_THREADS; t++) {
+        log_buffer_write(&log_slots[t].buffer);
+    }
+}
+
+static void log_message(const char* format, ...) {
+    LogBuffer* log = log_thread_buffer();
+    va_list args;
+    va_start(args, format);
+    log_buffer_vappend(log, format, args);
+    va_end(args);
+    #ifdef _OPENMP
+        if (omp_in_parallel()) return;
+    #endif
+    log_buffer_write(log);
+}
+
+// O nivel e testado antes de formatar: mensagens filtradas nao custam nada
+#define LOG_SUMMARY(...) do { if (log_level >= LOG_LEVEL_SUMMARY) log_message(__VA_ARGS__); } while (0)
+#define LOG_VERBOSE(...) do { if (log_level >= LOG_LEVEL_VERBOSE) log_message(__VA_ARGS__); } while (0)
+
+// ==================== PERFIL (CONTADORES) ====================
+// Contadores por thread (linha de cache propria, sem atomicos no hot path),
+// somados apenas no relatorio final. Com ENABLE_PROFILING 0 as macros somem.
+
+typedef enum {
+    PROF_COLLISION_CALLS,       // Testes peca x peca (pieces_collide)
+    PROF_NFP_QUERIES,           // ... resolvidos pela tabela de NFPs
+    PROF_BBOX_REJECTS,          // ... descartados pelas bounding boxes
+    PROF_SAT_HITS,              // ... sobreposicao confirmada pelo SAT
+    PROF_DISTANCE_EVALS,        // ... que chegaram ao teste de distancia completo
+    PROF_HEAP_FALLBACKS,        // Arena sem espaco: novo bloco via malloc
+    PROF_CONTACT_CANDIDATES,    // Posicoes de contato testadas
+    PROF_GRID_CANDIDATES,       // Posicoes da busca em grade testadas
+    PROF_ROTATE_PIECE,          // Chamadas a rotate_piece
+    PROF_COUNTER_COUNT
+} ProfileCounter;
+
+typedef enum {
+    PHASE_PARSE,
+    PHASE_SETUP,                // Rotacoes, NFPs, grade e cache
+    PHASE_INIT_POPULATION,
+    PHASE_EVOLUTION,
+    PHASE_CONCAVE,
+    PHASE_OUTPUT,
+    PHASE_COUNT
+} ProfilePhase;
+
+#if ENABLE_PROFILING
+
+#define PROFILE_MAX_THREADS 256
+
+typedef struct {
+    long long count[PROF_COUNTER_COUNT];
+    char padding[64 - (PROF_COUNTER_COUNT * sizeof(long long)) % 64];
+} ProfileSlot;
+
+static ProfileSlot profile_slots[PROFILE_MAX_THREADS];
+static double profile_phase_seconds[PHASE_COUNT];
+static double profile_phase_start[PHASE_COUNT];
+static char profile_json_path[256] = "";
+
+static inline ProfileSlot* profile_slot() {
+    #ifdef _OPENMP
+        return &profile_slots[omp_get_thread_num() % PROFILE_MAX_THREADS];
+    #else
+        return &profile_slots[0];
+    #endif
+}
+
+#define PROFILE_COUNT(counter) (profile_slot()->count[counter]++)
+#define PROFILE_ADD(counter, n) (profile_slot()->count[counter] += (n))
+#define PROFILE_PHASE_BEGIN(phase) (profile_phase_start[phase] = wall_time())
+#define PROFILE_PHASE_END(phase) (profile_phase_seconds[phase] += wall_time() - profile_phase_start[phase])
+
+static const char* profile_counter_names[PROF_COUNTER_COUNT] = {
+    "collision_calls", "nfp_queries", "bbox_rejects", "sat_hits", "distance_evals",
+    "heap_fallbacks", "contact_candidates", "grid_candidates", "rotate_piece_calls"
+};
+
+static const char* profile_phase_names[PHASE_COUNT] = {
+    "parse", "setup", "init_population", "evolution", "concave", "output"
+};
+
+// Soma os contadores de todas as threads; imprime a tabela e grava o JSON (se pedido)
+static void profile_report(int thread_count) {
+    if (thread_count > PROFILE_MAX_THREADS) thread_count = PROFILE_MAX_THREADS;
+    long long total[PROF_COUNTER_COUNT] = {0};
+    for (int t = 0; t < PROFILE_MAX_THREADS; t++) {
+        for (int c = 0; c < PROF_COUNTER_COUNT; c++) total[c] += profile_slots[t].count[c];
+    }
+
+    LOG_SUMMARY("\n========================================\n");
+    LOG_SUMMARY("  PERFIL\n");
+    LOG_SUMMARY("========================================\n");
+    LOG_SUMMARY("%-22s %16s", "contador", "total");
+    for (int t = 0; t < thread_count; t++) LOG_SUMMARY("  thread %-3d", t);
+    LOG_SUMMARY("\n");
+    for (int c = 0; c < PROF_COUNTER_COUNT; c++) {
+        LOG_SUMMARY("%-22s %16lld", profile_counter_names[c], total[c]);
+        for (int t = 0; t < thread_count; t++) LOG_SUMMARY(" %11lld", profile_slots[t].count[c]);
+        LOG_SUMMARY("\n");
+    }
+    LOG_SUMMARY("\n%-22s %16s\n", "fase", "segundos");
+    for (int p = 0; p < PHASE_COUNT; p++) {
+        LOG_SUMMARY("%-22s %16.3f\n", profile_phase_names[p], profile_phase_seconds[p]);
+    }
+
+    if (!profile_json_path[0]) return;
+    FILE* file = fopen(profile_json_path, "wb");
+    if (!file) {
+        printf("ERRO: Nao foi possivel criar %s: %s\n", profile_json_path, strerror(errno));
+        return;
+    }
+    fprintf(file, "{\n  \"threads\": %d,\n  \"counters\": {\n", thread_count);
+    for (int c = 0; c < PROF_COUNTER_COUNT; c++) {
+        fprintf(file, "    \"%s\": {\"total\": %lld, \"per_thread\": [", profile_counter_names[c], total[c]);
+        for (int t = 0; t < thread_count; t++) {
+            fprintf(file, "%s%lld", t > 0 ? ", " : "", profile_slots[t].count[c]);
+        }
+        fprintf(file, "]}%s\n", c < PROF_COUNTER_COUNT - 1 ? "," : "");
+    }
+    fprintf(file, "  },\n  \"phase_seconds\": {\n");
+    for (int p = 0; p < PHASE_COUNT; p++) {
+        fprintf(file, "    \"%s\": %.6f%s\n", profile_phase_names[p], profile_phase_seconds[p],
+                p < PHASE_COUNT - 1 ? "," : "");
+    }
+    fprintf(file, "  }\n}\n");
+    fclose(file);
+    LOG_SUMMARY("Perfil salvo em: %s\n", profile_json_path);
+}
+
+#else
+
+#define PROFILE_COUNT(counter) ((void)0)
+#define PROFILE_ADD(counter, n) ((void)0)
+#define PROFILE_PHASE_BEGIN(phase) ((void)0)
+#define PROFILE_PHASE_END(phase) ((void)0)
+
+#endif // ENABLE_PROFILING
+
+// Arena de memoria por thread para evitar malloc/free repetidos no hot path
+#define ARENA_BLOCK_SIZE (256 * 1024)
+#define ARENA_ALIGNMENT 16
+
+typedef struct ArenaBlock {
+    struct ArenaBlock* prev;    // Bloco anterior (mais antigo)
+    size_t capacity;
+    size_t used;
+} ArenaBlock;
+
+typedef struct Arena {
+    ArenaBlock* head;           // Bloco atual
+    size_t total_capacity;      // Soma das capacidades de todos os blocos
+    char padding[48];           // Evita false sharing entre arenas de threads vizinhas
+} Arena;
+
+typedef struct {
+    ArenaBlock* block;
+    size_t used;
+} ArenaMark;
+
+// Layout SoA dos vertices para os kernels SIMD (arrays alinhados a 64 bytes).
+// x/y tem point_count + 1 entradas uteis (x[n] = x[0]) e sao preenchidos
+// ate o multiplo de SIMD_PAD repetindo o primeiro vertice; nas arestas de
+// preenchimento ex = ey = inv_len_sq = 0.
+// Os blocos de SIMD_PAD arestas consecutivas sao as folhas de uma hierarquia
+// de bboxes (arvore binaria implicita: no i tem filhos 2i e 2i + 1, folhas em
+// leaf_count + b), percorrida aos pares nos testes peca x peca.
+#define SIMD_PAD 8   // Largura AVX-512 em doubles
+
+typedef struct {
+    double* x;
+    double* y;
+    double* ex;             // Vetor da aresta k -> k+1
+    double* ey;
+    double* inv_len_sq;     // 1 / |aresta|^2 (0 para arestas degeneradas)
+    double* tree_bbox;      // Bbox de cada no da hierarquia (min_x, min_y, max_x, max_y); no 1 = raiz
+    double* block_bbox;     // Folhas: bbox de cada bloco de SIMD_PAD arestas (= tree_bbox + 4 * leaf_count)
+    int count;              // Numero de arestas (= point_count)
+    int block_count;
+    int leaf_count;         // Potencia de 2 >= block_count; folhas excedentes tem bbox vazia
+    void* block;            // Alocacao unica que contem todos os arrays
+} PolygonSoA;
 
 typedef struct {
     Point* points;
     int point_count;
+    PolygonSoA soa;         // Preenchido apenas nas formas da tabela de rotacoes
     int* allowed_angles;
     int angle_count;
     int id;
@@ -93,29 +375,54 @@ typedef struct {
     double area;
     // Otimização: cache de bounding box
     double min_x, min_y, max_x, max_y;
+    // Indice na tabela de formas orientadas (NFP); -1 se nao pertence a tabela
+    int shape_id;
+    // Tipo de peca (entrada de "peaces"); copias de "quantity" compartilham
+    // pontos, angulos e formas orientadas do tipo
+    int type_id;
 } Piece;
 
 typedef struct {
     Point position;
     int angle;
     int piece_id;
-    Piece rotated_piece;
+    Piece* rotated_piece;    // Entrada da tabela de rotacoes (somente leitura)
 } PlacedPiece;
 
+// Indice espacial de uma placa: grade uniforme sobre as bounding boxes das pecas
+typedef struct {
+    int cols, rows;
+    double cell_w, cell_h;
+    int* cell_head;              // Primeira entrada de cada celula (-1 = vazia)
+    int* entry_piece;            // Indice da peca em placed_pieces
+    int* entry_next;             // Proxima entrada na mesma celula
+    int entry_count, entry_capacity;
+    int* first_cell;             // Por peca: celula (r0, c0) do canto da bbox, deduplica
+                                 // pecas em varias celulas sem escrever na grade
+    int* dead_shape;             // Por peca, DEAD_SHAPE_WAYS entradas (forma & mascara):
+                                 // formas cujos contatos com ela ja falharam todos
+                                 // (-1 = vazia); a placa so cresce, entao continuam
+                                 // falhando ate uma peca ser movida
+    struct Arena* arena;         // Arena de onde saem as entradas (crescimento)
+} SpatialGrid;
+
 typedef struct {
     double width, height;
     PlacedPiece* placed_pieces;
     int piece_count;
     double used_area;
     double efficiency;
+    SpatialGrid grid;
 } Board;
 
 typedef struct {
     double board_x, board_y;
     double distance_between_boards;
     double distance_between_pieces;
-    Piece* pieces;
+    Piece* pieces;           // Instancias: cada copia de "quantity" e uma peca
     int piece_count;
+    int* type_first;         // type_first[t] = primeira instancia do tipo t (type_count + 1 entradas)
+    int type_count;
 } InputData;
 
 typedef struct {
@@ -125,11 +432,20 @@ typedef struct {
     double execution_time;
 } Result;
 
+// Registro de colocacao: onde a peca da posicao i da sequencia foi parar
+typedef struct {
+    int piece_id;
+    int rotation_idx;
+    int board_idx;           // -1 se a peca nao foi colocada
+    Point position;
+} PlacementRecord;
+
 // Estrutura do Genoma (Individuo)
 // NOTA: rotation_choices é indexado por piece_id, NÃO por posição na sequência!
 typedef struct {
     int* piece_sequence;     // sequence[i] = piece_id
     int* rotation_choices;   // rotation_choices[piece_id] = rotation index
+    PlacementRecord* placements;  // Log da ultima avaliacao (NULL se nao avaliado)
     double fitness;
     int board_count;
     double total_efficiency;
@@ -140,12 +456,13 @@ InputData input_data;
 Result result;
 Result best_result;
 
-// Thread-local RNG state para evitar race conditions
-// Cada thread mantem seu proprio estado de geracao de numeros aleatorios
-#ifdef _OPENMP
-    static unsigned int* thread_seeds = NULL;
-    static int max_threads = 0;
-#endif
+// Uma arena por thread (indexada por omp_get_thread_num); em modo serial, apenas uma
+static Arena* thread_arenas = NULL;
+static int arena_count = 0;
+
+// Arenas dos resultados globais ('result' e 'best_result')
+static Arena result_arena;
+static Arena best_result_arena;
 
 // Cache para senos e cossenos pre-calculados
 #define ANGLE_CACHE_SIZE 360
@@ -163,8 +480,139 @@ void init_trig_cache() {
     cache_initialized = true;
 }
 
+// ==================== ARENA ALLOCATOR ====================
+// Alocador bump por thread: evaluate_genome reinicia a arena da thread no
+// inicio de cada genoma e todas as alocacoes temporarias (placas, pecas
+// posicionadas, buffers de poligonos grandes) saem dela, sem free e sem
+// contencao no malloc da glibc entre threads.
+
+static ArenaBlock* arena_new_block(ArenaBlock* prev, size_t capacity) {
+    ArenaBlock* block = malloc(sizeof(ArenaBlock) + capacity);
+    if (!block) {
+        printf("ERRO: Falha ao alocar bloco de arena (%zu bytes)\n", capacity);
+        exit(1);
+    }
+    block->prev = prev;
+    block->capacity = capacity;
+    block->used = 0;
+    return block;
+}
+
+void arena_init(Arena* arena, size_t capacity) {
+    arena->head = arena_new_block(NULL, capacity);
+    arena->total_capacity = capacity;
+}
+
+void arena_destroy(Arena* arena) {
+    ArenaBlock* block = arena->head;
+    while (block) {
+        ArenaBlock* prev = block->prev;
+        free(block);
+        block = prev;
+    }
+    arena->head = NULL;
+    arena->total_capacity = 0;
+}
+
+void* arena_alloc(Arena* arena, size_t size) {
+    size = (size + ARENA_ALIGNMENT - 1) & ~(size_t)(ARENA_ALIGNMENT - 1);
+    ArenaBlock* block = arena->head;
+
+    if (block->used + size > block->capacity) {
+        size_t capacity = block->capacity * 2;
+        if (capacity < size) capacity = size;
+        block = arena_new_block(block, capacity);
+        arena->head = block;
+        PROFILE_COUNT(PROF_HEAP_FALLBACKS);
+        arena->total_capacity += capacity;
+    }
+
+    void* ptr = (char*)(block + 1) + block->used;
+    block->used += size;
+    return ptr;
+}
+
+void* arena_calloc(Arena* arena, size_t count, size_t size) {
+    void* ptr = arena_alloc(arena, count * size);
+    memset(ptr, 0, count * size);
+    return ptr;
+}
+
+// Libera tudo; se a arena cresceu, funde os blocos em um unico bloco do tamanho total
+void arena_reset(Arena* arena) {
+    if (arena->head->prev) {
+        size_t capacity = arena->total_capacity;
+        arena_destroy(arena);
+        arena_init(arena, capacity);
+    } else {
+        arena->head->used = 0;
+    }
+}
+
+static inline ArenaMark arena_mark(Arena* arena) {
+    ArenaMark mark = {arena->head, arena->head->used};
+    return mark;
+}
+
+// Desfaz as alocacoes feitas apos arena_mark (uso em pilha dentro de um genoma)
+void arena_release(Arena* arena, ArenaMark mark) {
+    while (arena->head != mark.block) {
+        ArenaBlock* prev = arena->head->prev;
+        arena->total_capacity -= arena->head->capacity;
+        free(arena->head);
+        arena->head = prev;
+    }
+    arena->head->used = mark.used;
+}
+
+void init_thread_arenas() {
+    #ifdef _OPENMP
+        arena_count = omp_get_max_threads();
+    #else
+        arena_count = 1;
+    #endif
+    thread_arenas = malloc(sizeof(Arena) * arena_count);
+    for (int i = 0; i < arena_count; i++) {
+        arena_init(&thread_arenas[i], ARENA_BLOCK_SIZE);
+    }
+}
+
+void free_thread_arenas() {
+    for (int i = 0; i < arena_count; i++) {
+        arena_destroy(&thread_arenas[i]);
+    }
+    free(thread_arenas);
+    thread_arenas = NULL;
+    arena_count = 0;
+}
+
+// Obter arena da thread atual
+static inline Arena* get_thread_arena() {
+    #ifdef _OPENMP
+        int tid = omp_get_thread_num();
+        if (tid < arena_count) {
+            return &thread_arenas[tid];
+        }
+    #endif
+    return &thread_arenas[0];
+}
+
 // ==================== OPTIMIZED UTILITY FUNCTIONS ====================
 
+// Relogio monotonico de parede em segundos
+static double wall_time() {
+    #ifdef _WIN32
+        LARGE_INTEGER counter, frequency;
+        QueryPerformanceCounter(&counter);
+        QueryPerformanceFrequency(&frequency);
+        return (double)counter.QuadPart / (double)frequency.QuadPart;
+    #else
+        struct timespec ts;
+        clock_gettime(CLOCK_MONOTONIC, &ts);
+        return ts.tv_sec + ts.tv_nsec * 1e-9;
+    #endif
+}
+
 // Inline functions para operações simples
 static inline double calculate_distance_squared(Point a, Point b) {
     double dx = a.x - b.x;
@@ -248,17 +696,89 @@ void calculate_bounding_box_cached(Piece* piece) {
     }
 }
 
-Piece rotate_piece(Piece* original, int angle) {
-    Piece rotated = *original;
-    rotated.points = malloc(sizeof(Point) * original->point_count);
+// Tamanho (em doubles) de cada array SoA para n arestas, multiplo de SIMD_PAD
+static inline int soa_padded_count(int n) {
+    return ((n + SIMD_PAD) / SIMD_PAD) * SIMD_PAD;
+}
+
+// Constroi o layout SoA de um poligono (coordenadas locais)
+void polygon_soa_build(PolygonSoA* soa, const Point* points, int n) {
+    int len = soa_padded_count(n);
+    soa->count = n;
+    soa->block_count = (n + SIMD_PAD - 1) / SIMD_PAD;
+    soa->leaf_count = 1;
+    while (soa->leaf_count < soa->block_count) soa->leaf_count *= 2;
+    soa->block = malloc(sizeof(double) * (5 * len + 8 * soa->leaf_count) + 63);
+    double* base = (double*)(((uintptr_t)soa->block + 63) & ~(uintptr_t)63);
+    soa->x = base;
+    soa->y = base + len;
+    soa->ex = base + 2 * len;
+    soa->ey = base + 3 * len;
+    soa->inv_len_sq = base + 4 * len;
+    soa->tree_bbox = base + 5 * len;
+    soa->block_bbox = soa->tree_bbox + 4 * soa->leaf_count;
+
+    for (int k = 0; k < len; k++) {
+        Point a = points[k < n ? k : 0];
+        soa->x[k] = a.x;
+        soa->y[k] = a.y;
+        soa->ex[k] = soa->ey[k] = soa->inv_len_sq[k] = 0.0;
+        if (k < n) {
+            Point b = points[(k + 1) % n];
+            double ex = b.x - a.x, ey = b.y - a.y;
+            double len_sq = ex * ex + ey * ey;
+            soa->ex[k] = ex;
+            soa->ey[k] = ey;
+            soa->inv_len_sq[k] = len_sq > 1e-10 ? 1.0 / len_sq : 0.0;
+        }
+    }
+
+    for (int b = 0; b < soa->leaf_count; b++) {
+        double* box = &soa->block_bbox[4 * b];
+        box[0] = box[1] = DBL_MAX;
+        box[2] = box[3] = -DBL_MAX;
+        if (b >= soa->block_count) continue;     // Folha excedente: bbox vazia
+        int last = (b + 1) * SIMD_PAD < n ? (b + 1) * SIMD_PAD : n;
+        for (int k = b * SIMD_PAD; k <= last; k++) {
+            Point a = points[k % n];
+            if (a.x < box[0]) box[0] = a.x;
+            if (a.y < box[1]) box[1] = a.y;
+            if (a.x > box[2]) box[2] = a.x;
+            if (a.y > box[3]) box[3] = a.y;
+        }
+    }
+    for (int node = soa->leaf_count - 1; node >= 1; node--) {
+        double* box = &soa->tree_bbox[4 * node];
+        const double* left = &soa->tree_bbox[8 * node];
+        const double* right = left + 4;
+        box[0] = min_double(left[0], right[0]);
+        box[1] = min_double(left[1], right[1]);
+        box[2] = max_double(left[2], right[2]);
+        box[3] = max_double(left[3], right[3]);
+    }
+}
+
+void polygon_soa_free(PolygonSoA* soa) {
+    free(soa->block);
+    soa->block = NULL;
+}
 
+// Media dos vertices: centro de rotacao das pecas (ver --transforms-only)
+static Point piece_vertex_mean(const Piece* piece) {
     Point center = {0, 0};
-    for (int i = 0; i < original->point_count; i++) {
-        center.x += original->points[i].x;
-        center.y += original->points[i].y;
+    for (int i = 0; i < piece->point_count; i++) {
+        center.x += piece->points[i].x;
+        center.y += piece->points[i].y;
     }
-    center.x /= original->point_count;
-    center.y /= original->point_count;
+    center.x /= piece->point_count;
+    center.y /= piece->point_count;
+    return center;
+}
+
+Piece rotate_piece_about(Piece* original, int angle, Point center) {
+    PROFILE_COUNT(PROF_ROTATE_PIECE);
+    Piece rotated = *original;
+    rotated.points = malloc(sizeof(Point) * original->point_count);
 
     for (int i = 0; i < original->point_count; i++) {
         rotated.points[i] = rotate_point_fast(original->points[i], center, angle);
@@ -267,10 +787,15 @@ Piece rotate_piece(Piece* original, int angle) {
     calculate_bounding_box_cached(&rotated);
     rotated.width = rotated.max_x - rotated.min_x;
     rotated.height = rotated.max_y - rotated.min_y;
+    polygon_soa_build(&rotated.soa, rotated.points, rotated.point_count);
 
     return rotated;
 }
 
+Piece rotate_piece(Piece* original, int angle) {
+    return rotate_piece_about(original, angle, piece_vertex_mean(original));
+}
+
 double calculate_polygon_area(Point* points, int count) {
     double area = 0.0;
     for (int i = 0; i < count; i++) {
@@ -281,6 +806,123 @@ double calculate_polygon_area(Point* points, int count) {
     return fabs(area) * 0.5;
 }
 
+// ==================== TABELA DE ROTACOES ====================
+// Cada par (peca, allowed_angle) e rotacionado uma unica vez apos o parse.
+// A tabela e imutavel durante o AG e compartilhada (somente leitura) por
+// todas as threads: PlacedPiece aponta para suas entradas em vez de possuir
+// uma copia dos pontos, eliminando rotate_piece/malloc/free da avaliacao.
+
+typedef struct {
+    Point* points;          // Vertices em ordem anti-horaria (CCW)
+    int point_count;
+    double min_x, min_y, max_x, max_y;
+} ConvexPart;
+
+// Forma orientada: peca original rotacionada por um de seus allowed_angles
+typedef struct {
+    Piece piece;            // Geometria rotacionada (coordenadas locais) usada na busca
+    ConvexPart* parts;      // Decomposicao convexa para o NFP (NULL se indisponivel)
+    int part_count;
+    bool simplified;        // piece e o contorno simplificado; exact a geometria real
+    Piece exact;            // Mesmo referencial de piece (rotacao sobre o centro da exata)
+} OrientedShape;
+
+static OrientedShape* shape_table = NULL;
+static int shape_count = 0;
+static int* shape_offsets = NULL;      // shape_offsets[piece_id] = primeira forma do tipo da peca
+
+static inline int shape_index(int piece_id, int rotation_idx) {
+    return shape_offsets[piece_id] + rotation_idx;
+}
+
+// Geometria rotacionada pre-calculada de (piece_id, rotation_idx)
+static inline Piece* get_rotated_piece(int piece_id, int rotation_idx) {
+    return &shape_table[shape_offsets[piece_id] + rotation_idx].piece;
+}
+
+// Geometria exata da forma (saida e validacao final)
+static inline Piece* shape_exact_piece(int shape_id) {
+    OrientedShape* shape = &shape_table[shape_id];
+    return shape->simplified ? &shape->exact : &shape->piece;
+}
+
+static double simplify_tolerance = 0.0;   // --simplify-tolerance (0 = geometria exata)
+static int simplify_outline(const Piece* piece, double tolerance, Point** outline);
+
+// Uma entrada por (tipo, rotacao): instancias do mesmo tipo apontam para as
+// mesmas formas, entao NFPs e caches por par de formas sao por tipo
+void shape_table_init() {
+    int* type_offsets = malloc(sizeof(int) * input_data.type_count);
+    shape_count = 0;
+    for (int t = 0; t < input_data.type_count; t++) {
+        type_offsets[t] = shape_count;
+        shape_count += input_data.pieces[input_data.type_first[t]].angle_count;
+    }
+    shape_offsets = malloc(sizeof(int) * input_data.piece_count);
+    for (int i = 0; i < input_data.piece_count; i++) {
+        shape_offsets[i] = type_offsets[input_data.pieces[i].type_id];
+    }
+
+    shape_table = malloc(sizeof(OrientedShape) * shape_count);
+    int vertices_before = 0, vertices_after = 0, simplified_types = 0;
+    for (int t = 0; t < input_data.type_count; t++) {
+        Piece* original = &input_data.pieces[input_data.type_first[t]];
+        Point center = piece_vertex_mean(original);
+
+        // Contorno simplificado (contem a peca), rotacionado sobre o centro da
+        // exata: posicoes e angulos valem igualmente para as duas geometrias
+        Piece outline = *original;
+        Point* outline_points = NULL;
+        if (simplify_tolerance > 0) {
+            outline.point_count = simplify_outline(original, simplify_tolerance, &outline_points);
+            outline.points = outline_points;
+        }
+        bool simplified = outline_points != NULL;
+        simplified_types += simplified;
+        vertices_before += original->point_count;
+        vertices_after += simplified ? outline.point_count : original->point_count;
+
+        for (int r = 0; r < original->angle_count; r++) {
+            int s = type_offsets[t] + r;
+            OrientedShape* shape = &shape_table[s];
+            int angle = original->allowed_angles[r];
+            shape->piece = rotate_piece_about(simplified ? &outline : original, angle, center);
+            shape->piece.shape_id = s;
+            shape->parts = NULL;
+            shape->part_count = 0;
+            shape->simplified = simplified;
+            if (simplified) {
+                shape->exact = rotate_piece_about(original, angle, center);
+                shape->exact.shape_id = s;
+            }
+        }
+        free(outline_points);
+    }
+    free(type_offsets);
+
+    if (simplify_tolerance > 0) {
+        LOG_SUMMARY("Simplificacao (tolerancia %.2f): %d de %d tipos, vertices %d -> %d\n",
+                    simplify_tolerance, simplified_types, input_data.type_count,
+                    vertices_before, vertices_after);
+    }
+}
+
+void shape_table_free() {
+    for (int s = 0; s < shape_count; s++) {
+        free(shape_table[s].piece.points);
+        polygon_soa_free(&shape_table[s].piece.soa);
+        if (shape_table[s].simplified) {
+            free(shape_table[s].exact.points);
+            polygon_soa_free(&shape_table[s].exact.soa);
+        }
+    }
+    free(shape_table);
+    free(shape_offsets);
+    shape_table = NULL;
+    shape_offsets = NULL;
+    shape_count = 0;
+}
+
 bool point_in_polygon(Point test, Point* polygon, int count) {
     bool inside = false;
     for (int i = 0, j = count - 1; i < count; j = i++) {
@@ -292,20 +934,25 @@ bool point_in_polygon(Point test, Point* polygon, int count) {
     return inside;
 }
 
-double point_to_segment_distance(Point p, Point a, Point b) {
+// Distancia ao quadrado ponto-segmento (para comparacoes sem sqrt)
+static inline double point_to_segment_distance_sq(Point p, Point a, Point b) {
     double dx = b.x - a.x;
     double dy = b.y - a.y;
     double len_sq = dx * dx + dy * dy;
+    double t = 0.0;
 
-    if (len_sq < 1e-10) {
-        return calculate_distance(p, a);
+    if (len_sq >= 1e-10) {
+        t = ((p.x - a.x) * dx + (p.y - a.y) * dy) / len_sq;
+        t = (t < 0) ? 0 : ((t > 1) ? 1 : t);
     }
 
-    double t = ((p.x - a.x) * dx + (p.y - a.y) * dy) / len_sq;
-    t = (t < 0) ? 0 : ((t > 1) ? 1 : t);
+    double ex = p.x - (a.x + t * dx);
+    double ey = p.y - (a.y + t * dy);
+    return ex * ex + ey * ey;
+}
 
-    Point closest = {a.x + t * dx, a.y + t * dy};
-    return calculate_distance(p, closest);
+double point_to_segment_distance(Point p, Point a, Point b) {
+    return sqrt(point_to_segment_distance_sq(p, a, b));
 }
 
 static inline int get_orientation(Point p, Point q, Point r) {
@@ -334,1468 +981,5792 @@ bool segments_intersect(Point p1, Point q1, Point p2, Point q2) {
     return false;
 }
 
-// Otimização: Bounding box check antes de calcular distância exata
-static inline bool bounding_boxes_overlap(Piece* p1, Point pos1, Piece* p2, Point pos2, double min_distance) {
-    double p1_min_x = p1->min_x + pos1.x - min_distance;
-    double p1_max_x = p1->max_x + pos1.x + min_distance;
-    double p1_min_y = p1->min_y + pos1.y - min_distance;
-    double p1_max_y = p1->max_y + pos1.y + min_distance;
-
-    double p2_min_x = p2->min_x + pos2.x;
-    double p2_max_x = p2->max_x + pos2.x;
-    double p2_min_y = p2->min_y + pos2.y;
-    double p2_max_y = p2->max_y + pos2.y;
+// ==================== SIMPLIFICACAO DE POLIGONOS ====================
+// Pre-processamento opcional (--simplify-tolerance T) das pecas com muitos
+// vertices: o contorno usado na busca (AG, NFP e fase 3) e uma aproximacao
+// externa da peca. Douglas-Peucker com T/2 descarta vertices (cada um fica a
+// no maximo T/2 da aresta que o substitui) e um deslocamento de T/2 para fora
+// cobre essa diferenca, entao o contorno contem a peca e se afasta dela no
+// maximo ~T. Qualquer layout valido para o contorno tambem e valido para a
+// geometria exata, que e a usada na saida e em validate_exact_layout.
 
-    return !(p1_max_x < p2_min_x || p2_max_x < p1_min_x ||
-             p1_max_y < p2_min_y || p2_max_y < p1_min_y);
+static double signed_polygon_area(const Point* points, int count) {
+    double area = 0.0;
+    for (int i = 0; i < count; i++) {
+        int j = (i + 1) % count;
+        area += points[i].x * points[j].y - points[j].x * points[i].y;
+    }
+    return area * 0.5;
 }
 
-// Versão otimizada: usa stack allocation quando possível
-double calculate_min_polygon_distance(Piece* p1, Point pos1, Piece* p2, Point pos2) {
-    // Early exit: check bounding boxes primeiro
-    if (!bounding_boxes_overlap(p1, pos1, p2, pos2, 0)) {
-        double dx = max_double(p1->min_x + pos1.x, p2->min_x + pos2.x) -
-                    min_double(p1->max_x + pos1.x, p2->max_x + pos2.x);
-        double dy = max_double(p1->min_y + pos1.y, p2->min_y + pos2.y) -
-                    min_double(p1->max_y + pos1.y, p2->max_y + pos2.y);
-        if (dx > 0 && dy > 0) {
-            return sqrt(dx*dx + dy*dy);
-        } else if (dx > 0) {
-            return dx;
-        } else if (dy > 0) {
-            return dy;
+// Douglas-Peucker em poligono fechado: ancoras no vertice 0 e no mais distante
+// dele; marca em keep os vertices mantidos e retorna quantos
+static int douglas_peucker_closed(const Point* points, int n, double epsilon, bool* keep) {
+    int far = 0;
+    double far_dist = -1;
+    for (int i = 1; i < n; i++) {
+        double dx = points[i].x - points[0].x, dy = points[i].y - points[0].y;
+        if (dx * dx + dy * dy > far_dist) {
+            far_dist = dx * dx + dy * dy;
+            far = i;
         }
     }
+    memset(keep, 0, sizeof(bool) * n);
+    keep[0] = keep[far] = true;
+
+    // Intervalos [a, b] pendentes (b = n representa o vertice 0)
+    int* stack = malloc(sizeof(int) * 2 * (n + 2));
+    int top = 0;
+    stack[top++] = 0;
+    stack[top++] = far;
+    stack[top++] = far;
+    stack[top++] = n;
+    double epsilon_sq = epsilon * epsilon;
+    while (top > 0) {
+        int b = stack[--top];
+        int a = stack[--top];
+        int split = -1;
+        double split_dist = epsilon_sq;
+        for (int k = a + 1; k < b; k++) {
+            double d = point_to_segment_distance_sq(points[k], points[a], points[b % n]);
+            if (d > split_dist) {
+                split_dist = d;
+                split = k;
+            }
+        }
+        if (split < 0) continue;
+        keep[split] = true;
+        stack[top++] = a;
+        stack[top++] = split;
+        stack[top++] = split;
+        stack[top++] = b;
+    }
+    free(stack);
 
-    double min_distance = DBL_MAX;
-
-    // Usar stack allocation para arrays pequenos
-    Point poly1_stack[32], poly2_stack[32];
-    Point *poly1, *poly2;
-    bool use_heap1 = p1->point_count > 32;
-    bool use_heap2 = p2->point_count > 32;
-
-    poly1 = use_heap1 ? malloc(sizeof(Point) * p1->point_count) : poly1_stack;
-    poly2 = use_heap2 ? malloc(sizeof(Point) * p2->point_count) : poly2_stack;
+    int kept = 0;
+    for (int i = 0; i < n; i++) kept += keep[i];
+    return kept;
+}
 
-    // Transformar pontos apenas uma vez
-    for (int i = 0; i < p1->point_count; i++) {
-        poly1[i].x = p1->points[i].x + pos1.x;
-        poly1[i].y = p1->points[i].y + pos1.y;
+// Desloca o poligono 'offset' para fora (sign: +1 anti-horario, -1 horario).
+// Juncao em mitra; vertices convexos agudos (mitra > 2 * offset) recebem dois
+// pontos (juncao quadrada), que ainda cobrem o disco de raio offset em volta.
+// Retorna o numero de pontos em out (capacidade 2 * n) ou 0 se degenerado.
+static int offset_polygon_outward(const Point* points, int n, double offset, double sign, Point* out) {
+    int count = 0;
+    for (int i = 0; i < n; i++) {
+        Point prev = points[(i + n - 1) % n], cur = points[i], next = points[(i + 1) % n];
+        double l1 = sqrt((cur.x - prev.x) * (cur.x - prev.x) + (cur.y - prev.y) * (cur.y - prev.y));
+        double l2 = sqrt((next.x - cur.x) * (next.x - cur.x) + (next.y - cur.y) * (next.y - cur.y));
+        if (l1 < 1e-9 || l2 < 1e-9) return 0;
+        Point d1 = {(cur.x - prev.x) / l1, (cur.y - prev.y) / l1};
+        Point d2 = {(next.x - cur.x) / l2, (next.y - cur.y) / l2};
+        Point n1 = {sign * d1.y, -sign * d1.x};
+        Point n2 = {sign * d2.y, -sign * d2.x};
+        double cos_turn = n1.x * n2.x + n1.y * n2.y;
+        bool convex = sign * (d1.x * d2.y - d1.y * d2.x) > 0;
+
+        if (!convex || cos_turn > -0.5) {
+            if (1.0 + cos_turn < 1e-6) return 0;   // Reentrancia em agulha
+            double scale = offset / (1.0 + cos_turn);
+            out[count++] = (Point){cur.x + (n1.x + n2.x) * scale, cur.y + (n1.y + n2.y) * scale};
+        } else {
+            out[count++] = (Point){cur.x + (n1.x + d1.x) * offset, cur.y + (n1.y + d1.y) * offset};
+            out[count++] = (Point){cur.x + (n2.x - d2.x) * offset, cur.y + (n2.y - d2.y) * offset};
+        }
     }
+    return count;
+}
 
-    for (int i = 0; i < p2->point_count; i++) {
-        poly2[i].x = p2->points[i].x + pos2.x;
-        poly2[i].y = p2->points[i].y + pos2.y;
+// Remove os lacos locais ("rabo de andorinha") que o deslocamento cria em
+// reentrancias com arestas curtas: arestas i e j proximas que se cruzam sao
+// ligadas pelo ponto de cruzamento e os vertices entre elas descartados.
+// O laco fica dentro do contorno externo; retorna a nova contagem.
+#define OFFSET_LOOP_SPAN 8
+
+static int remove_offset_loops(Point* points, int count) {
+    for (int i = 0; i + 2 < count; i++) {
+        for (int j = i + 2; j < count - 1 && j <= i + OFFSET_LOOP_SPAN; j++) {
+            Point a = points[i], b = points[i + 1], c = points[j], d = points[j + 1];
+            double denom = (b.x - a.x) * (d.y - c.y) - (b.y - a.y) * (d.x - c.x);
+            if (fabs(denom) < 1e-12) continue;
+            double t = ((c.x - a.x) * (d.y - c.y) - (c.y - a.y) * (d.x - c.x)) / denom;
+            double u = ((c.x - a.x) * (b.y - a.y) - (c.y - a.y) * (b.x - a.x)) / denom;
+            if (t <= 0 || t >= 1 || u <= 0 || u >= 1) continue;
+
+            points[i + 1] = (Point){a.x + t * (b.x - a.x), a.y + t * (b.y - a.y)};
+            int removed = j - i - 1;
+            memmove(&points[i + 2], &points[j + 1], sizeof(Point) * (count - j - 1));
+            count -= removed;
+            j = i + 1;      // Reexaminar a aresta i encurtada
+        }
     }
+    return count;
+}
 
-    // Calcular distâncias
-    for (int i = 0; i < p1->point_count; i++) {
-        for (int j = 0; j < p2->point_count; j++) {
-            int next_j = (j + 1) % p2->point_count;
-            double dist = point_to_segment_distance(poly1[i], poly2[j], poly2[next_j]);
-            if (dist < min_distance) min_distance = dist;
+// Contorno simples que contem a peca? (sem auto-intersecao, vertices da peca
+// dentro e nenhuma aresta da peca cruzando o contorno)
+static bool outline_contains_piece(const Point* outline, int count, const Piece* piece) {
+    for (int i = 0; i < count; i++) {
+        for (int j = i + 1; j < count; j++) {
+            if (j == i + 1 || (i == 0 && j == count - 1)) continue;
+            if (segments_intersect(outline[i], outline[(i + 1) % count], outline[j], outline[(j + 1) % count])) {
+                return false;
+            }
+        }
+    }
+    for (int k = 0; k < piece->point_count; k++) {
+        if (!point_in_polygon(piece->points[k], (Point*)outline, count)) return false;
+        Point a = piece->points[k], b = piece->points[(k + 1) % piece->point_count];
+        for (int i = 0; i < count; i++) {
+            if (segments_intersect(a, b, outline[i], outline[(i + 1) % count])) return false;
         }
     }
+    return true;
+}
 
-    for (int i = 0; i < p2->point_count; i++) {
-        for (int j = 0; j < p1->point_count; j++) {
-            int next_j = (j + 1) % p1->point_count;
-            double dist = point_to_segment_distance(poly2[i], poly1[j], poly1[next_j]);
-            if (dist < min_distance) min_distance = dist;
+// Sutherland-Hodgman contra a bounding box da peca: o deslocamento nao deve
+// aumentar as dimensoes externas (pecas quase do tamanho da placa continuam
+// cabendo). out e scratch tem 16 * count pontos cada (cada lado no maximo
+// dobra a contagem); o resultado fica em scratch. Retorna a nova contagem.
+static int clip_outline_to_bbox(const Point* points, int count, const Piece* piece, Point* out, Point* scratch) {
+    // Folga minima: as arestas da peca sobre a bbox nao tocam o contorno
+    const double slack = 1e-6;
+    const double limits[4] = {piece->min_x - slack, piece->min_y - slack, -piece->max_x - slack, -piece->max_y - slack};
+    const Point* in = points;
+    Point* buffers[2] = {out, scratch};
+    for (int side = 0; side < 4; side++) {
+        // Lado: coordenada (x ou y, com sinal) >= limite
+        Point* dest = buffers[side & 1];
+        double sign = side < 2 ? 1.0 : -1.0;
+        int n = 0;
+        for (int i = 0; i < count; i++) {
+            Point a = in[i], b = in[(i + 1) % count];
+            double va = sign * ((side & 1) ? a.y : a.x) - limits[side];
+            double vb = sign * ((side & 1) ? b.y : b.x) - limits[side];
+            if (va >= 0) dest[n++] = a;
+            if ((va >= 0) != (vb >= 0)) {
+                double t = va / (va - vb);
+                dest[n++] = (Point){a.x + t * (b.x - a.x), a.y + t * (b.y - a.y)};
+            }
         }
+        // Vertices repetidos (cortes sobre um vertice)
+        int unique = 0;
+        for (int i = 0; i < n; i++) {
+            Point prev = unique > 0 ? dest[unique - 1] : dest[n - 1];
+            if (fabs(dest[i].x - prev.x) > 1e-9 || fabs(dest[i].y - prev.y) > 1e-9) dest[unique++] = dest[i];
+        }
+        in = dest;
+        count = unique;
+        if (count < 3) return 0;
     }
+    return count;
+}
 
-    if (use_heap1) free(poly1);
-    if (use_heap2) free(poly2);
+// Contorno simplificado da peca em *outline (malloc); retorna o numero de
+// vertices, ou 0 (outline = NULL) se nao houver reducao valida
+static int simplify_outline(const Piece* piece, double tolerance, Point** outline) {
+    int n = piece->point_count;
+    *outline = NULL;
+    double area = signed_polygon_area(piece->points, n);
+    if (n <= 4 || fabs(area) < 1e-9) return 0;
+
+    bool* keep = malloc(sizeof(bool) * n);
+    Point* reduced = malloc(sizeof(Point) * n);
+    Point* offset = malloc(sizeof(Point) * 2 * n);
+    Point* clipped = malloc(sizeof(Point) * 64 * n);   // 2 x 16 x (ate 2n pontos deslocados)
+    Point* result = NULL;
+    int count = 0;
+    if (douglas_peucker_closed(piece->points, n, tolerance * 0.5, keep) >= 3) {
+        int kept = 0;
+        for (int i = 0; i < n; i++) {
+            if (keep[i]) reduced[kept++] = piece->points[i];
+        }
+        count = offset_polygon_outward(reduced, kept, tolerance * 0.5, area > 0 ? 1.0 : -1.0, offset);
+        count = remove_offset_loops(offset, count);
+
+        // Preferir o contorno recortado na bbox; sem ele, o deslocamento puro
+        int clipped_count = count >= 3 ? clip_outline_to_bbox(offset, count, piece, clipped, clipped + 32 * n) : 0;
+        if (clipped_count >= 3 && clipped_count < n && outline_contains_piece(clipped + 32 * n, clipped_count, piece)) {
+            result = clipped + 32 * n;
+            count = clipped_count;
+        } else if (count >= 3 && count < n && outline_contains_piece(offset, count, piece)) {
+            result = offset;
+        }
+    }
+    if (result) {
+        *outline = malloc(sizeof(Point) * count);
+        memcpy(*outline, result, sizeof(Point) * count);
+    }
+    free(keep);
+    free(reduced);
+    free(offset);
+    free(clipped);
+    return result ? count : 0;
+}
 
-    return min_distance;
+// ==================== SIMD KERNELS ====================
+// Kernels sobre o layout SoA (PolygonSoA) em coordenadas locais da peca:
+// a translacao relativa e aplicada ao ponto de consulta, sem copias
+// transladadas dos poligonos. A implementacao e escolhida em tempo de
+// execucao (AVX-512 / AVX2 / escalar), entao binarios -march=x86-64-v2
+// continuam rodando em qualquer CPU.
+
+// Os kernels de distancia percorrem apenas os blocos [block_begin, block_end)
+typedef double (*SegmentsMinDistSqFn)(const PolygonSoA* poly, int block_begin, int block_end, double px, double py);
+typedef int (*PolygonCrossingsFn)(const PolygonSoA* poly, double px, double py);
+typedef bool (*SegmentsWithinFn)(const PolygonSoA* poly, int block_begin, int block_end,
+                                 double px, double py, double limit);
+
+// Bloco de arestas b longe demais de (px, py)? (bbox do bloco inflada por limit)
+static inline bool soa_block_far(const PolygonSoA* poly, int b, double px, double py, double limit) {
+    const double* box = &poly->block_bbox[4 * b];
+    return px < box[0] - limit || px > box[2] + limit ||
+           py < box[1] - limit || py > box[3] + limit;
 }
 
-// Versão otimizada: SAT com stack allocation
-bool polygons_overlap_sat(Piece* p1, Point pos1, Piece* p2, Point pos2) {
-    // Early rejection com bounding boxes
-    if (!bounding_boxes_overlap(p1, pos1, p2, pos2, 0)) {
-        return false;
+// Menor distancia ao quadrado de (px, py) as arestas do poligono (sem sqrt)
+static double segments_min_dist_sq_scalar(const PolygonSoA* poly, int block_begin, int block_end,
+                                          double px, double py) {
+    double best = DBL_MAX;
+    int end = block_end * SIMD_PAD < poly->count ? block_end * SIMD_PAD : poly->count;
+    for (int k = block_begin * SIMD_PAD; k < end; k++) {
+        double wx = px - poly->x[k];
+        double wy = py - poly->y[k];
+        double t = (wx * poly->ex[k] + wy * poly->ey[k]) * poly->inv_len_sq[k];
+        t = (t < 0) ? 0 : ((t > 1) ? 1 : t);
+        double dx = wx - t * poly->ex[k];
+        double dy = wy - t * poly->ey[k];
+        double d = dx * dx + dy * dy;
+        if (d < best) best = d;
     }
+    return best;
+}
 
-    Point poly1_stack[32], poly2_stack[32];
-    Point *poly1, *poly2;
-    bool use_heap1 = p1->point_count > 32;
-    bool use_heap2 = p2->point_count > 32;
-
-    poly1 = use_heap1 ? malloc(sizeof(Point) * p1->point_count) : poly1_stack;
-    poly2 = use_heap2 ? malloc(sizeof(Point) * p2->point_count) : poly2_stack;
+// Alguma aresta a distancia < limit de (px, py)? Para no primeiro bloco que
+// encontrar uma; blocos cuja bbox inflada nao contem o ponto sao ignorados
+static bool segments_within_scalar(const PolygonSoA* poly, int block_begin, int block_end,
+                                   double px, double py, double limit) {
+    double limit_sq = limit * limit;
+    for (int b = block_begin; b < block_end; b++) {
+        if (soa_block_far(poly, b, px, py, limit)) continue;
+        int end = (b + 1) * SIMD_PAD < poly->count ? (b + 1) * SIMD_PAD : poly->count;
+        for (int k = b * SIMD_PAD; k < end; k++) {
+            double wx = px - poly->x[k];
+            double wy = py - poly->y[k];
+            double t = (wx * poly->ex[k] + wy * poly->ey[k]) * poly->inv_len_sq[k];
+            t = (t < 0) ? 0 : ((t > 1) ? 1 : t);
+            double dx = wx - t * poly->ex[k];
+            double dy = wy - t * poly->ey[k];
+            if (dx * dx + dy * dy < limit_sq) return true;
+        }
+    }
+    return false;
+}
 
-    for (int i = 0; i < p1->point_count; i++) {
-        poly1[i].x = p1->points[i].x + pos1.x;
-        poly1[i].y = p1->points[i].y + pos1.y;
+// Contagem de cruzamentos do raio horizontal (regra par-impar), sem divisao
+static int polygon_crossings_scalar(const PolygonSoA* poly, double px, double py) {
+    int crossings = 0;
+    for (int k = 0; k < poly->count; k++) {
+        double yi = poly->y[k];
+        int straddle = (yi > py) != (poly->y[k + 1] > py);
+        double lhs = (px - poly->x[k]) * poly->ey[k];
+        double rhs = poly->ex[k] * (py - yi);
+        int left = (poly->ey[k] > 0) ? (lhs < rhs) : (lhs > rhs);
+        crossings += straddle & left;
     }
+    return crossings;
+}
 
-    for (int i = 0; i < p2->point_count; i++) {
-        poly2[i].x = p2->points[i].x + pos2.x;
-        poly2[i].y = p2->points[i].y + pos2.y;
+#if SIMD_X86
+
+__attribute__((target("avx2,fma")))
+static double segments_min_dist_sq_avx2(const PolygonSoA* poly, int block_begin, int block_end,
+                                        double px, double py) {
+    const __m256d vpx = _mm256_set1_pd(px);
+    const __m256d vpy = _mm256_set1_pd(py);
+    const __m256d zero = _mm256_setzero_pd();
+    const __m256d one = _mm256_set1_pd(1.0);
+    __m256d best = _mm256_set1_pd(DBL_MAX);
+
+    int end = block_end * SIMD_PAD < poly->count ? block_end * SIMD_PAD : poly->count;
+    for (int k = block_begin * SIMD_PAD; k < end; k += 4) {
+        __m256d ex = _mm256_load_pd(poly->ex + k);
+        __m256d ey = _mm256_load_pd(poly->ey + k);
+        __m256d wx = _mm256_sub_pd(vpx, _mm256_load_pd(poly->x + k));
+        __m256d wy = _mm256_sub_pd(vpy, _mm256_load_pd(poly->y + k));
+        __m256d dot = _mm256_fmadd_pd(wx, ex, _mm256_mul_pd(wy, ey));
+        __m256d t = _mm256_mul_pd(dot, _mm256_load_pd(poly->inv_len_sq + k));
+        t = _mm256_min_pd(_mm256_max_pd(t, zero), one);
+        __m256d dx = _mm256_fnmadd_pd(t, ex, wx);
+        __m256d dy = _mm256_fnmadd_pd(t, ey, wy);
+        best = _mm256_min_pd(best, _mm256_fmadd_pd(dx, dx, _mm256_mul_pd(dy, dy)));
     }
 
-    bool overlaps = false;
+    __m128d m = _mm_min_pd(_mm256_castpd256_pd128(best), _mm256_extractf128_pd(best, 1));
+    m = _mm_min_sd(m, _mm_unpackhi_pd(m, m));
+    return _mm_cvtsd_f64(m);
+}
 
-    // Point in polygon tests
-    for (int i = 0; i < p1->point_count; i++) {
-        if (point_in_polygon(poly1[i], poly2, p2->point_count)) {
-            overlaps = true;
-            goto cleanup;
+__attribute__((target("avx2,fma")))
+static bool segments_within_avx2(const PolygonSoA* poly, int block_begin, int block_end,
+                                 double px, double py, double limit) {
+    const __m256d vpx = _mm256_set1_pd(px);
+    const __m256d vpy = _mm256_set1_pd(py);
+    const __m256d zero = _mm256_setzero_pd();
+    const __m256d one = _mm256_set1_pd(1.0);
+    const __m256d vlimit_sq = _mm256_set1_pd(limit * limit);
+
+    for (int b = block_begin; b < block_end; b++) {
+        if (soa_block_far(poly, b, px, py, limit)) continue;
+        for (int k = b * SIMD_PAD; k < (b + 1) * SIMD_PAD; k += 4) {
+            __m256d ex = _mm256_load_pd(poly->ex + k);
+            __m256d ey = _mm256_load_pd(poly->ey + k);
+            __m256d wx = _mm256_sub_pd(vpx, _mm256_load_pd(poly->x + k));
+            __m256d wy = _mm256_sub_pd(vpy, _mm256_load_pd(poly->y + k));
+            __m256d dot = _mm256_fmadd_pd(wx, ex, _mm256_mul_pd(wy, ey));
+            __m256d t = _mm256_mul_pd(dot, _mm256_load_pd(poly->inv_len_sq + k));
+            t = _mm256_min_pd(_mm256_max_pd(t, zero), one);
+            __m256d dx = _mm256_fnmadd_pd(t, ex, wx);
+            __m256d dy = _mm256_fnmadd_pd(t, ey, wy);
+            __m256d d_sq = _mm256_fmadd_pd(dx, dx, _mm256_mul_pd(dy, dy));
+            if (_mm256_movemask_pd(_mm256_cmp_pd(d_sq, vlimit_sq, _CMP_LT_OQ))) return true;
         }
     }
+    return false;
+}
 
-    for (int i = 0; i < p2->point_count; i++) {
-        if (point_in_polygon(poly2[i], poly1, p1->point_count)) {
-            overlaps = true;
-            goto cleanup;
-        }
+__attribute__((target("avx2,fma")))
+static int polygon_crossings_avx2(const PolygonSoA* poly, double px, double py) {
+    const __m256d vpx = _mm256_set1_pd(px);
+    const __m256d vpy = _mm256_set1_pd(py);
+    const __m256d zero = _mm256_setzero_pd();
+    int crossings = 0;
+
+    for (int k = 0; k < poly->count; k += 4) {
+        __m256d yi = _mm256_load_pd(poly->y + k);
+        __m256d ex = _mm256_load_pd(poly->ex + k);
+        __m256d ey = _mm256_load_pd(poly->ey + k);
+        __m256d straddle = _mm256_xor_pd(_mm256_cmp_pd(yi, vpy, _CMP_GT_OQ),
+                                         _mm256_cmp_pd(_mm256_loadu_pd(poly->y + k + 1), vpy, _CMP_GT_OQ));
+        __m256d lhs = _mm256_mul_pd(_mm256_sub_pd(vpx, _mm256_load_pd(poly->x + k)), ey);
+        __m256d rhs = _mm256_mul_pd(ex, _mm256_sub_pd(vpy, yi));
+        __m256d left = _mm256_blendv_pd(_mm256_cmp_pd(lhs, rhs, _CMP_GT_OQ),
+                                        _mm256_cmp_pd(lhs, rhs, _CMP_LT_OQ),
+                                        _mm256_cmp_pd(ey, zero, _CMP_GT_OQ));
+        crossings += __builtin_popcount(_mm256_movemask_pd(_mm256_and_pd(straddle, left)));
     }
+    return crossings;
+}
 
-    // Segment intersection tests
-    for (int i = 0; i < p1->point_count; i++) {
-        int next_i = (i + 1) % p1->point_count;
-        for (int j = 0; j < p2->point_count; j++) {
-            int next_j = (j + 1) % p2->point_count;
-            if (segments_intersect(poly1[i], poly1[next_i], poly2[j], poly2[next_j])) {
-                overlaps = true;
-                goto cleanup;
-            }
-        }
+__attribute__((target("avx512f")))
+static double segments_min_dist_sq_avx512(const PolygonSoA* poly, int block_begin, int block_end,
+                                          double px, double py) {
+    const __m512d vpx = _mm512_set1_pd(px);
+    const __m512d vpy = _mm512_set1_pd(py);
+    const __m512d zero = _mm512_setzero_pd();
+    const __m512d one = _mm512_set1_pd(1.0);
+    __m512d best = _mm512_set1_pd(DBL_MAX);
+
+    int end = block_end * SIMD_PAD < poly->count ? block_end * SIMD_PAD : poly->count;
+    for (int k = block_begin * SIMD_PAD; k < end; k += 8) {
+        __m512d ex = _mm512_load_pd(poly->ex + k);
+        __m512d ey = _mm512_load_pd(poly->ey + k);
+        __m512d wx = _mm512_sub_pd(vpx, _mm512_load_pd(poly->x + k));
+        __m512d wy = _mm512_sub_pd(vpy, _mm512_load_pd(poly->y + k));
+        __m512d dot = _mm512_fmadd_pd(wx, ex, _mm512_mul_pd(wy, ey));
+        __m512d t = _mm512_mul_pd(dot, _mm512_load_pd(poly->inv_len_sq + k));
+        t = _mm512_min_pd(_mm512_max_pd(t, zero), one);
+        __m512d dx = _mm512_fnmadd_pd(t, ex, wx);
+        __m512d dy = _mm512_fnmadd_pd(t, ey, wy);
+        best = _mm512_min_pd(best, _mm512_fmadd_pd(dx, dx, _mm512_mul_pd(dy, dy)));
     }
-
-cleanup:
-    if (use_heap1) free(poly1);
-    if (use_heap2) free(poly2);
-
-    return overlaps;
+    return _mm512_reduce_min_pd(best);
 }
 
-bool polygons_collide(Piece* p1, Point pos1, Piece* p2, Point pos2, double min_distance) {
-    // Early rejection: check bounding boxes primeiro
-    if (!bounding_boxes_overlap(p1, pos1, p2, pos2, min_distance)) {
-        return false;
+__attribute__((target("avx512f")))
+static bool segments_within_avx512(const PolygonSoA* poly, int block_begin, int block_end,
+                                   double px, double py, double limit) {
+    const __m512d vpx = _mm512_set1_pd(px);
+    const __m512d vpy = _mm512_set1_pd(py);
+    const __m512d zero = _mm512_setzero_pd();
+    const __m512d one = _mm512_set1_pd(1.0);
+    const __m512d vlimit_sq = _mm512_set1_pd(limit * limit);
+
+    for (int b = block_begin; b < block_end; b++) {
+        if (soa_block_far(poly, b, px, py, limit)) continue;
+        int k = b * SIMD_PAD;
+        __m512d ex = _mm512_load_pd(poly->ex + k);
+        __m512d ey = _mm512_load_pd(poly->ey + k);
+        __m512d wx = _mm512_sub_pd(vpx, _mm512_load_pd(poly->x + k));
+        __m512d wy = _mm512_sub_pd(vpy, _mm512_load_pd(poly->y + k));
+        __m512d dot = _mm512_fmadd_pd(wx, ex, _mm512_mul_pd(wy, ey));
+        __m512d t = _mm512_mul_pd(dot, _mm512_load_pd(poly->inv_len_sq + k));
+        t = _mm512_min_pd(_mm512_max_pd(t, zero), one);
+        __m512d dx = _mm512_fnmadd_pd(t, ex, wx);
+        __m512d dy = _mm512_fnmadd_pd(t, ey, wy);
+        __m512d d_sq = _mm512_fmadd_pd(dx, dx, _mm512_mul_pd(dy, dy));
+        if (_mm512_cmp_pd_mask(d_sq, vlimit_sq, _CMP_LT_OQ)) return true;
     }
+    return false;
+}
 
-    if (polygons_overlap_sat(p1, pos1, p2, pos2)) {
-        return true;
+__attribute__((target("avx512f")))
+static int polygon_crossings_avx512(const PolygonSoA* poly, double px, double py) {
+    const __m512d vpx = _mm512_set1_pd(px);
+    const __m512d vpy = _mm512_set1_pd(py);
+    const __m512d zero = _mm512_setzero_pd();
+    int crossings = 0;
+
+    for (int k = 0; k < poly->count; k += 8) {
+        __m512d yi = _mm512_load_pd(poly->y + k);
+        __m512d ex = _mm512_load_pd(poly->ex + k);
+        __m512d ey = _mm512_load_pd(poly->ey + k);
+        __mmask8 straddle = _mm512_cmp_pd_mask(yi, vpy, _CMP_GT_OQ) ^
+                            _mm512_cmp_pd_mask(_mm512_loadu_pd(poly->y + k + 1), vpy, _CMP_GT_OQ);
+        __m512d lhs = _mm512_mul_pd(_mm512_sub_pd(vpx, _mm512_load_pd(poly->x + k)), ey);
+        __m512d rhs = _mm512_mul_pd(ex, _mm512_sub_pd(vpy, yi));
+        __mmask8 up = _mm512_cmp_pd_mask(ey, zero, _CMP_GT_OQ);
+        __mmask8 left = (up & _mm512_cmp_pd_mask(lhs, rhs, _CMP_LT_OQ)) |
+                        (~up & _mm512_cmp_pd_mask(lhs, rhs, _CMP_GT_OQ));
+        crossings += __builtin_popcount((unsigned int)(straddle & left));
     }
+    return crossings;
+}
 
-    double actual_distance = calculate_min_polygon_distance(p1, pos1, p2, pos2);
-    return actual_distance < min_distance;
+#endif // SIMD_X86
+
+static SegmentsMinDistSqFn segments_min_dist_sq = segments_min_dist_sq_scalar;
+static PolygonCrossingsFn polygon_crossings = polygon_crossings_scalar;
+static SegmentsWithinFn segments_within = segments_within_scalar;
+static const char* simd_level = "escalar";
+
+// Seleciona os kernels conforme a CPU (chamado uma vez no inicio)
+void simd_init() {
+    #if SIMD_X86
+        __builtin_cpu_init();
+        if (__builtin_cpu_supports("avx512f")) {
+            segments_min_dist_sq = segments_min_dist_sq_avx512;
+            polygon_crossings = polygon_crossings_avx512;
+            segments_within = segments_within_avx512;
+            simd_level = "AVX-512";
+        } else if (__builtin_cpu_supports("avx2") && __builtin_cpu_supports("fma")) {
+            segments_min_dist_sq = segments_min_dist_sq_avx2;
+            polygon_crossings = polygon_crossings_avx2;
+            segments_within = segments_within_avx2;
+            simd_level = "AVX2";
+        }
+    #endif
 }
 
-bool piece_fits_in_board(Piece* piece, Point position, Board* board) {
-    const double EPSILON = 2.0;
-    double margin = input_data.distance_between_boards;
+static inline bool point_in_polygon_soa(const PolygonSoA* poly, double px, double py) {
+    return polygon_crossings(poly, px, py) & 1;
+}
 
-    double left_boundary = margin - EPSILON;
-    double bottom_boundary = margin - EPSILON;
-    double right_boundary = board->width - margin + EPSILON;
-    double top_boundary = board->height - margin + EPSILON;
+// ==================== HIERARQUIA DE BBOXES ====================
+// Testes peca x peca percorrem as hierarquias das duas pecas aos pares (s1
+// transladada por (off_x, off_y) para o referencial de s2) e so descem nos
+// pares de nos cujas bboxes estao a no maximo sqrt(*bound_sq); os blocos de
+// arestas folha sao entregues a 'leaf'. Em pecas em L e em C encaixadas as
+// bboxes inteiras sempre se sobrepoem, mas so os trechos de contorno
+// realmente proximos chegam aos kernels.
 
-    if ((position.x + piece->min_x) < left_boundary ||
-        (position.y + piece->min_y) < bottom_boundary ||
-        (position.x + piece->max_x) > right_boundary ||
-        (position.y + piece->max_y) > top_boundary) {
-        return false;
-    }
+typedef bool (*SoaLeafPairFn)(const PolygonSoA* s1, int b1, const PolygonSoA* s2, int b2,
+                              double off_x, double off_y, void* context);
 
-    for (int i = 0; i < board->piece_count; i++) {
-        if (polygons_collide(piece, position, &board->placed_pieces[i].rotated_piece,
-                           board->placed_pieces[i].position, input_data.distance_between_pieces)) {
-            return false;
-        }
-    }
+#define SOA_TRAVERSAL_STACK 128   // Pares pendentes (profundidade das duas arvores, com folga)
 
-    return true;
+// Distancia ao quadrado entre a bbox a (transladada) e a bbox b; vazia = infinita
+static inline double soa_box_dist_sq(const double* a, double off_x, double off_y, const double* b) {
+    double dx = max_double(max_double(b[0] - (a[2] + off_x), (a[0] + off_x) - b[2]), 0.0);
+    double dy = max_double(max_double(b[1] - (a[3] + off_y), (a[1] + off_y) - b[3]), 0.0);
+    return dx * dx + dy * dy;
 }
 
-// Versão otimizada da busca de posição
-Point find_best_position_fast(Piece* piece, Board* board) {
-    Point best_pos = {-1, -1};
-    double best_score = DBL_MAX;
-
-    double min_x = input_data.distance_between_boards;
-    double min_y = input_data.distance_between_boards;
+// Retorna true assim que 'leaf' retornar true. *bound_sq pode ser reduzido
+// pela propria 'leaf' (busca da distancia minima).
+static bool soa_pair_traverse(const PolygonSoA* s1, double off_x, double off_y, const PolygonSoA* s2,
+                              const double* bound_sq, SoaLeafPairFn leaf, void* context) {
+    int stack[2 * SOA_TRAVERSAL_STACK];
+    int top = 0;
+    stack[top++] = 1;
+    stack[top++] = 1;
+    while (top > 0) {
+        int n2 = stack[--top];
+        int n1 = stack[--top];
+        const double* box1 = &s1->tree_bbox[4 * n1];
+        const double* box2 = &s2->tree_bbox[4 * n2];
+        if (soa_box_dist_sq(box1, off_x, off_y, box2) > *bound_sq) continue;
+
+        bool leaf1 = n1 >= s1->leaf_count, leaf2 = n2 >= s2->leaf_count;
+        if (leaf1 && leaf2) {
+            if (leaf(s1, n1 - s1->leaf_count, s2, n2 - s2->leaf_count, off_x, off_y, context)) return true;
+            continue;
+        }
+        // Desce no no com a maior bbox (ou no unico que nao e folha)
+        bool split1 = leaf2 || (!leaf1 && (box1[2] - box1[0]) + (box1[3] - box1[1]) >=
+                                          (box2[2] - box2[0]) + (box2[3] - box2[1]));
+        if (split1) {
+            stack[top++] = 2 * n1 + 1;
+            stack[top++] = n2;
+            stack[top++] = 2 * n1;
+            stack[top++] = n2;
+        } else {
+            stack[top++] = n1;
+            stack[top++] = 2 * n2 + 1;
+            stack[top++] = n1;
+            stack[top++] = 2 * n2;
+        }
+    }
+    return false;
+}
 
-    double usable_width = board->width - 2 * input_data.distance_between_boards;
-    double usable_height = board->height - 2 * input_data.distance_between_boards;
+// Vertices do bloco b em [*first, *end)
+static inline void soa_block_vertices(const PolygonSoA* poly, int b, int* first, int* end) {
+    *first = b * SIMD_PAD;
+    *end = (b + 1) * SIMD_PAD < poly->count ? (b + 1) * SIMD_PAD : poly->count;
+}
 
-    if (piece->width > usable_width || piece->height > usable_height) {
-        return best_pos;
+// Folha de polygons_within: vertice de um bloco a distancia < limit das arestas do outro
+static bool soa_leaf_within(const PolygonSoA* s1, int b1, const PolygonSoA* s2, int b2,
+                            double off_x, double off_y, void* context) {
+    double limit = *(const double*)context;
+    int first, end;
+    soa_block_vertices(s1, b1, &first, &end);
+    for (int i = first; i < end; i++) {
+        if (segments_within(s2, b2, b2 + 1, s1->x[i] + off_x, s1->y[i] + off_y, limit)) return true;
     }
-
-    // Primeira peça - canto inferior esquerdo
-    if (board->piece_count == 0) {
-        Point first_pos = {min_x, min_y};
-        if (piece_fits_in_board(piece, first_pos, board)) {
-            return first_pos;
-        }
-        return best_pos;
+    soa_block_vertices(s2, b2, &first, &end);
+    for (int i = first; i < end; i++) {
+        if (segments_within(s1, b1, b1 + 1, s2->x[i] - off_x, s2->y[i] - off_y, limit)) return true;
     }
+    return false;
+}
 
-    // Buscar posições de contato com peças existentes
-    for (int i = 0; i < board->piece_count; i++) {
-        PlacedPiece* existing = &board->placed_pieces[i];
-
-        double ex_min_x = existing->rotated_piece.min_x + existing->position.x;
-        double ex_min_y = existing->rotated_piece.min_y + existing->position.y;
-        double ex_max_x = existing->rotated_piece.max_x + existing->position.x;
-        double ex_max_y = existing->rotated_piece.max_y + existing->position.y;
-
-        Point contact_positions[6] = {
-            {ex_max_x + input_data.distance_between_pieces, ex_min_y},
-            {ex_max_x + input_data.distance_between_pieces, ex_max_y - piece->height},
-            {ex_min_x, ex_max_y + input_data.distance_between_pieces},
-            {ex_max_x - piece->width, ex_max_y + input_data.distance_between_pieces},
-            {ex_min_x - piece->width - input_data.distance_between_pieces, ex_min_y},
-            {ex_min_x, ex_min_y - piece->height - input_data.distance_between_pieces}
-        };
-
-        for (int j = 0; j < 6; j++) {
-            Point pos = contact_positions[j];
-
-            if (piece_fits_in_board(piece, pos, board)) {
-                // MODIFICADO: Empilhamento esquerda-direita
-                // Peso alto em X (3.0) prioriza posicionamento à esquerda
-                // Peso baixo em Y (0.5) permite empilhamento vertical
-                // Resultado: peças se acumulam à esquerda, deixando espaço livre à direita
-                double score = pos.x * 3.0 + pos.y * 0.5;
-                if (score < best_score) {
-                    best_score = score;
-                    best_pos = pos;
-                }
-            }
+// Folha de polygons_overlap_sat: alguma aresta de um bloco cruza/toca uma do outro
+static bool soa_leaf_edges_cross(const PolygonSoA* s1, int b1, const PolygonSoA* s2, int b2,
+                                 double off_x, double off_y, void* context) {
+    (void)context;
+    int first1, end1, first2, end2;
+    soa_block_vertices(s1, b1, &first1, &end1);
+    soa_block_vertices(s2, b2, &first2, &end2);
+    for (int i = first1; i < end1; i++) {
+        Point a = {s1->x[i] + off_x, s1->y[i] + off_y};
+        Point b = {s1->x[i + 1] + off_x, s1->y[i + 1] + off_y};
+        for (int j = first2; j < end2; j++) {
+            Point c = {s2->x[j], s2->y[j]}, d = {s2->x[j + 1], s2->y[j + 1]};
+            if (segments_intersect(a, b, c, d)) return true;
         }
     }
+    return false;
+}
 
-    // Se não encontrou posição de contato, busca em grid
-    if (best_pos.x < 0) {
-        double max_x = board->width - piece->width - input_data.distance_between_boards;
-        double max_y = board->height - piece->height - input_data.distance_between_boards;
-
-        double step = max_double(piece->width, piece->height) * 0.3;
-        if (step < 10.0) step = 10.0;
-        if (step > 40.0) step = 40.0;
-
-        int attempts = 0;
-        const int max_attempts = 1000;
+// Folha da distancia minima: reduz *context (melhor distancia ao quadrado)
+static bool soa_leaf_min_dist(const PolygonSoA* s1, int b1, const PolygonSoA* s2, int b2,
+                              double off_x, double off_y, void* context) {
+    double* best_sq = context;
+    int first, end;
+    soa_block_vertices(s1, b1, &first, &end);
+    for (int i = first; i < end; i++) {
+        double dist_sq = segments_min_dist_sq(s2, b2, b2 + 1, s1->x[i] + off_x, s1->y[i] + off_y);
+        if (dist_sq < *best_sq) *best_sq = dist_sq;
+    }
+    soa_block_vertices(s2, b2, &first, &end);
+    for (int i = first; i < end; i++) {
+        double dist_sq = segments_min_dist_sq(s1, b1, b1 + 1, s2->x[i] - off_x, s2->y[i] - off_y);
+        if (dist_sq < *best_sq) *best_sq = dist_sq;
+    }
+    return false;
+}
 
-        for (double x = min_x; x <= max_x && attempts < max_attempts; x += step) {
-            for (double y = min_y; y <= max_y && attempts < max_attempts; y += step) {
-                attempts++;
-                Point pos = {x, y};
+// Otimização: Bounding box check antes de calcular distância exata
+static inline bool bounding_boxes_overlap(Piece* p1, Point pos1, Piece* p2, Point pos2, double min_distance) {
+    double p1_min_x = p1->min_x + pos1.x - min_distance;
+    double p1_max_x = p1->max_x + pos1.x + min_distance;
+    double p1_min_y = p1->min_y + pos1.y - min_distance;
+    double p1_max_y = p1->max_y + pos1.y + min_distance;
 
-                if (piece_fits_in_board(piece, pos, board)) {
-                    // MODIFICADO: Empilhamento esquerda-direita (consistente com busca de contato)
-                    // Mesma heurística: prioriza X (esquerda) com peso 2.5, Y com peso 0.5
-                    double score = x * 2.5 + y * 0.5;
-                    if (score < best_score) {
-                        best_score = score;
-                        best_pos = pos;
-                    }
-                }
-            }
-        }
-    }
+    double p2_min_x = p2->min_x + pos2.x;
+    double p2_max_x = p2->max_x + pos2.x;
+    double p2_min_y = p2->min_y + pos2.y;
+    double p2_max_y = p2->max_y + pos2.y;
 
-    return best_pos;
+    return !(p1_max_x < p2_min_x || p2_max_x < p1_min_x ||
+             p1_max_y < p2_min_y || p2_max_y < p1_min_y);
 }
 
-bool place_piece_on_board_fast(int piece_id, int rotation_idx, Board* board) {
-    Piece* original_piece = &input_data.pieces[piece_id];
+// Menor distancia vertice-aresta entre os contornos (sem atalho de bounding box).
+// Branch-and-bound na hierarquia: pares de blocos mais distantes que a melhor
+// distancia ja encontrada sao descartados.
+static double polygon_boundary_distance(Piece* p1, Point pos1, Piece* p2, Point pos2) {
+    double off_x = pos1.x - pos2.x;     // p1 no referencial local de p2
+    double off_y = pos1.y - pos2.y;
 
-    int angle = original_piece->allowed_angles[rotation_idx];
-    Piece rotated = rotate_piece(original_piece, angle);
+    // Limite inicial: distancia entre os primeiros vertices
+    double dx = p1->soa.x[0] + off_x - p2->soa.x[0], dy = p1->soa.y[0] + off_y - p2->soa.y[0];
+    double min_distance_sq = dx * dx + dy * dy;
+    soa_pair_traverse(&p1->soa, off_x, off_y, &p2->soa, &min_distance_sq, soa_leaf_min_dist, &min_distance_sq);
 
-    Point best_pos = find_best_position_fast(&rotated, board);
+    // Distâncias ao quadrado; sqrt apenas no final
+    return sqrt(min_distance_sq);
+}
 
-    // CORRIGIDO: NÃO tentar outras rotações! Respeitar o genoma!
-    // Se a rotação sugerida não cabe, falha e tenta nova placa.
-    // Isso força o GA a encontrar boas combinações de sequência + rotação.
-    if (best_pos.x < 0) {
-        free(rotated.points);
+// Versão otimizada: teste de sobreposicao sobre o layout SoA, sem copias
+bool polygons_overlap_sat(Piece* p1, Point pos1, Piece* p2, Point pos2) {
+    // Early rejection com bounding boxes
+    if (!bounding_boxes_overlap(p1, pos1, p2, pos2, 0)) {
         return false;
     }
 
-    PlacedPiece* placed = &board->placed_pieces[board->piece_count];
-    placed->position = best_pos;
-    placed->angle = angle;
-    placed->piece_id = piece_id;
-    placed->rotated_piece = rotated;
+    const PolygonSoA* s1 = &p1->soa;
+    const PolygonSoA* s2 = &p2->soa;
+    double off_x = pos1.x - pos2.x;     // p1 no referencial local de p2
+    double off_y = pos1.y - pos2.y;
 
-    board->used_area += original_piece->area;
-    board->piece_count++;
+    // Sem contornos se cruzando, uma peca so pode estar inteira dentro da
+    // outra: basta testar um vertice de cada (kernel SIMD de cruzamentos)
+    if (point_in_polygon_soa(s2, s1->x[0] + off_x, s1->y[0] + off_y)) return true;
+    if (point_in_polygon_soa(s1, s2->x[0] - off_x, s2->y[0] - off_y)) return true;
 
-    return true;
+    // Cruzamento de arestas apenas entre blocos com bboxes em contato (folga
+    // minima: segments_intersect aceita colinearidade com tolerancia)
+    const double touching = 1e-18;
+    return soa_pair_traverse(s1, off_x, off_y, s2, &touching, soa_leaf_edges_cross, NULL);
 }
 
-// ==================== GENETIC ALGORITHM FUNCTIONS ====================
+// Predicado de limiar: distancia entre os poligonos < min_distance?
+// Com bboxes disjuntas usa o gap entre elas; caso contrario equivale a
+// polygon_boundary_distance(...) < min_distance, mas para no primeiro par
+// proximo, visita apenas pares de blocos de arestas proximos (hierarquia de
+// bboxes) e compara apenas distancias ao quadrado.
+bool polygons_within(Piece* p1, Point pos1, Piece* p2, Point pos2, double min_distance) {
+    double off_x = pos1.x - pos2.x;     // p1 no referencial local de p2
+    double off_y = pos1.y - pos2.y;
 
-// Implementacao thread-safe de gerador de numeros aleatorios cross-platform
-// Windows nao tem rand_r(), entao implementamos um LCG (Linear Congruential Generator)
-static inline int thread_safe_rand(unsigned int* seed_ptr) {
-    #ifdef _OPENMP
-        #ifdef _WIN32
-            // Windows: Implementar LCG thread-safe (algoritmo do glibc)
-            // Formula: next = (seed * 1103515245 + 12345) & 0x7fffffff
-            // Este algoritmo garante thread-safety sem locks
-            unsigned int next = *seed_ptr;
-            next = next * 1103515245 + 12345;
-            *seed_ptr = next;
-            return (int)((next >> 16) & 0x7fff);  // Retorna 15 bits (0-32767)
-        #else
-            // Linux/POSIX: usar rand_r() nativo
-            return rand_r(seed_ptr);
-        #endif
-    #else
-        // Modo serial: usar rand() padrao
-        (void)seed_ptr;  // Evitar warning de parametro nao usado
-        return rand();
-    #endif
-}
+    // Bboxes disjuntas: mesma estimativa (gap das bboxes) da distancia completa
+    if (!bounding_boxes_overlap(p1, pos1, p2, pos2, 0)) {
+        double dx = max_double(p1->min_x + off_x, p2->min_x) - min_double(p1->max_x + off_x, p2->max_x);
+        double dy = max_double(p1->min_y + off_y, p2->min_y) - min_double(p1->max_y + off_y, p2->max_y);
+        if (dx > 0 && dy > 0) return dx * dx + dy * dy < min_distance * min_distance;
+        if (dx > 0) return dx < min_distance;
+        if (dy > 0) return dy < min_distance;
+    }
 
-// Obter ponteiro para seed da thread atual
-static inline unsigned int* get_thread_seed() {
-    #ifdef _OPENMP
-        int tid = omp_get_thread_num();
-        if (tid < max_threads && thread_seeds != NULL) {
-            return &thread_seeds[tid];
-        }
-        // Fallback: usar seed estatica (nao deveria acontecer)
-        static unsigned int fallback_seed = 0;
-        return &fallback_seed;
-    #else
-        // Modo serial: seed dummy
-        static unsigned int dummy_seed = 0;
-        return &dummy_seed;
-    #endif
+    // Vertices de cada bloco contra as arestas dos blocos proximos da outra peca
+    double limit_sq = min_distance * min_distance;
+    return soa_pair_traverse(&p1->soa, off_x, off_y, &p2->soa, &limit_sq, soa_leaf_within, &min_distance);
 }
 
-Genome create_random_genome() {
-    Genome genome;
-    genome.piece_sequence = malloc(sizeof(int) * input_data.piece_count);
-    genome.rotation_choices = malloc(sizeof(int) * input_data.piece_count);
-    genome.fitness = 0.0;
-    genome.board_count = 0;
-    genome.total_efficiency = 0.0;
-
-    unsigned int* seed = get_thread_seed();
-
-    for (int i = 0; i < input_data.piece_count; i++) {
-        genome.piece_sequence[i] = i;
-    }
-
-    // Fisher-Yates shuffle otimizado - THREAD-SAFE
-    for (int i = input_data.piece_count - 1; i > 0; i--) {
-        int j = thread_safe_rand(seed) % (i + 1);
-        int temp = genome.piece_sequence[i];
-        genome.piece_sequence[i] = genome.piece_sequence[j];
-        genome.piece_sequence[j] = temp;
+bool polygons_collide(Piece* p1, Point pos1, Piece* p2, Point pos2, double min_distance) {
+    // Early rejection: check bounding boxes primeiro
+    if (!bounding_boxes_overlap(p1, pos1, p2, pos2, min_distance)) {
+        PROFILE_COUNT(PROF_BBOX_REJECTS);
+        return false;
     }
 
-    // CORRIGIDO: rotation_choices indexado por piece_id - THREAD-SAFE
-    for (int piece_id = 0; piece_id < input_data.piece_count; piece_id++) {
-        int angle_count = input_data.pieces[piece_id].angle_count;
-        genome.rotation_choices[piece_id] = thread_safe_rand(seed) % angle_count;
+    if (polygons_overlap_sat(p1, pos1, p2, pos2)) {
+        PROFILE_COUNT(PROF_SAT_HITS);
+        return true;
     }
 
-    return genome;
+    PROFILE_COUNT(PROF_DISTANCE_EVALS);
+    return polygons_within(p1, pos1, p2, pos2, min_distance);
 }
 
-Genome create_greedy_genome() {
-    Genome genome;
-    genome.piece_sequence = malloc(sizeof(int) * input_data.piece_count);
-    genome.rotation_choices = malloc(sizeof(int) * input_data.piece_count);
-    genome.fitness = 0.0;
-    genome.board_count = 0;
-    genome.total_efficiency = 0.0;
-
-    typedef struct { int id; double area; } PieceArea;
-    PieceArea* pieces_by_area = malloc(sizeof(PieceArea) * input_data.piece_count);
-
-    for (int i = 0; i < input_data.piece_count; i++) {
-        pieces_by_area[i].id = i;
-        pieces_by_area[i].area = input_data.pieces[i].area;
-    }
+// Revalida o layout final com a geometria exata das pecas (a busca usou os
+// contornos simplificados). Retorna o numero de violacoes de distancia/limite.
+int validate_exact_layout(Result* result) {
+    const double EPSILON = 2.0;     // Mesma folga de piece_fits_in_board_excluding
+    double margin = input_data.distance_between_boards;
+    double min_distance = input_data.distance_between_pieces;
+    double closest = DBL_MAX;
+    int violations = 0;
 
-    // Quicksort seria melhor, mas mantendo bubble sort por simplicidade
-    for (int i = 0; i < input_data.piece_count - 1; i++) {
-        for (int j = 0; j < input_data.piece_count - i - 1; j++) {
-            if (pieces_by_area[j].area < pieces_by_area[j + 1].area) {
-                PieceArea temp = pieces_by_area[j];
-                pieces_by_area[j] = pieces_by_area[j + 1];
-                pieces_by_area[j + 1] = temp;
+    for (int b = 0; b < result->board_count; b++) {
+        Board* board = &result->boards[b];
+        for (int i = 0; i < board->piece_count; i++) {
+            PlacedPiece* placed = &board->placed_pieces[i];
+            Piece* piece = shape_exact_piece(placed->rotated_piece->shape_id);
+            if (placed->position.x + piece->min_x < margin - EPSILON ||
+                placed->position.y + piece->min_y < margin - EPSILON ||
+                placed->position.x + piece->max_x > board->width - margin + EPSILON ||
+                placed->position.y + piece->max_y > board->height - margin + EPSILON) {
+                LOG_SUMMARY("AVISO: Placa %d: peca %d fora dos limites na geometria exata\n", b + 1, placed->piece_id);
+                violations++;
+            }
+            for (int j = i + 1; j < board->piece_count; j++) {
+                PlacedPiece* other = &board->placed_pieces[j];
+                Piece* other_piece = shape_exact_piece(other->rotated_piece->shape_id);
+                if (!bounding_boxes_overlap(piece, placed->position, other_piece, other->position, min_distance)) continue;
+                double distance = polygons_overlap_sat(piece, placed->position, other_piece, other->position)
+                                  ? 0.0
+                                  : polygon_boundary_distance(piece, placed->position, other_piece, other->position);
+                if (distance < closest) closest = distance;
+                if (distance < min_distance - 1e-6) {
+                    LOG_SUMMARY("AVISO: Placa %d: pecas %d e %d a %.3f (minimo %.3f) na geometria exata\n",
+                                b + 1, placed->piece_id, other->piece_id, distance, min_distance);
+                    violations++;
+                }
             }
         }
     }
-
-    for (int i = 0; i < input_data.piece_count; i++) {
-        genome.piece_sequence[i] = pieces_by_area[i].id;
+    if (closest < DBL_MAX) {
+        LOG_SUMMARY("Validacao exata: %d violacoes, menor distancia entre pecas vizinhas %.3f\n", violations, closest);
+    } else {
+        LOG_SUMMARY("Validacao exata: %d violacoes\n", violations);
     }
+    return violations;
+}
 
-    free(pieces_by_area);
+// ==================== NO-FIT POLYGON (NFP) ====================
+// Para cada par de formas orientadas (peca fixa A, peca movel B) o NFP e
+// A (+) -B: o conjunto de deslocamentos q = pos_B - pos_A em que as pecas
+// se sobrepoem. A colisao com distancia minima d vira "dist(q, NFP) < d".
+// Pecas concavas sao decompostas em partes convexas (ear clipping +
+// Hertel-Mehlhorn), e o NFP e a uniao das somas de Minkowski convexas
+// A_i (+) -B_j, agrupadas por parte de A para descarte hierarquico.
 
-    // CORRIGIDO: rotation_choices indexado por piece_id
-    for (int piece_id = 0; piece_id < input_data.piece_count; piece_id++) {
-        genome.rotation_choices[piece_id] = 0;
-    }
+#define NFP_MEMORY_BUDGET (512.0 * 1024.0 * 1024.0)  // Limite de memoria para a tabela de NFPs
+#define NFP_EPSILON 1e-9
+#define NFP_SLIDE_EPSILON 1e-6  // Recuo apos o deslizamento para evitar toque exato
 
-    return genome;
-}
+// Grupo de somas A_i (+) -B_j para uma parte fixa A_i
+typedef struct {
+    double min_x, min_y, max_x, max_y;
+    int first, count;       // Faixa em NfpPair.parts
+} NfpGroup;
 
-void evaluate_genome(Genome* genome) {
-    // Thread-safe: cada thread usa sua própria estrutura Result local
-    Result local_result;
-    local_result.boards = malloc(sizeof(Board) * MAX_BOARDS);
-    local_result.board_count = 0;
+typedef struct {
+    double min_x, min_y, max_x, max_y;
+    NfpGroup* groups;
+    int group_count;
+    ConvexPart* parts;
+    int part_count;
+    void* block;            // Bloco unico com grupos, partes e vertices
+} NfpPair;
+
+static NfpPair* nfp_pairs = NULL;      // Triangular: apenas pares (a <= b)
+static bool nfp_enabled = false;
+
+static inline double cross_product(Point o, Point a, Point b) {
+    return (a.x - o.x) * (b.y - o.y) - (a.y - o.y) * (b.x - o.x);
+}
 
-    bool* placed = calloc(input_data.piece_count, sizeof(bool));
-    int placed_count = 0;
+static inline size_t nfp_pair_index(int a, int b) {
+    // Indice triangular para a <= b
+    return (size_t)a * shape_count - ((size_t)a * (a - 1)) / 2 + (size_t)(b - a);
+}
 
-    for (int seq_idx = 0; seq_idx < input_data.piece_count; seq_idx++) {
-        int piece_id = genome->piece_sequence[seq_idx];
-        int rotation_idx = genome->rotation_choices[piece_id];  // CORRIGIDO: usar piece_id como índice!
+static void convex_part_update_bbox(ConvexPart* part) {
+    part->min_x = part->max_x = part->points[0].x;
+    part->min_y = part->max_y = part->points[0].y;
+    for (int i = 1; i < part->point_count; i++) {
+        if (part->points[i].x < part->min_x) part->min_x = part->points[i].x;
+        if (part->points[i].x > part->max_x) part->max_x = part->points[i].x;
+        if (part->points[i].y < part->min_y) part->min_y = part->points[i].y;
+        if (part->points[i].y > part->max_y) part->max_y = part->points[i].y;
+    }
+}
 
-        if (placed[piece_id]) continue;
+static bool polygon_is_convex_ccw(Point* pts, const int* idx, int count) {
+    for (int i = 0; i < count; i++) {
+        Point a = pts[idx[i]];
+        Point b = pts[idx[(i + 1) % count]];
+        Point c = pts[idx[(i + 2) % count]];
+        if (cross_product(a, b, c) < -NFP_EPSILON) return false;
+    }
+    return true;
+}
 
-        bool piece_placed = false;
+static bool point_in_triangle_inclusive(Point p, Point a, Point b, Point c) {
+    return cross_product(a, b, p) >= -NFP_EPSILON &&
+           cross_product(b, c, p) >= -NFP_EPSILON &&
+           cross_product(c, a, p) >= -NFP_EPSILON;
+}
 
-        for (int board_idx = 0; board_idx < local_result.board_count; board_idx++) {
-            if (place_piece_on_board_fast(piece_id, rotation_idx, &local_result.boards[board_idx])) {
-                placed[piece_id] = true;
-                placed_count++;
-                piece_placed = true;
-                break;
+/**
+ * Decompoe um poligono simples em partes convexas.
+ * Ear clipping gera triangulos; Hertel-Mehlhorn funde triangulos adjacentes
+ * enquanto o resultado permanece convexo. Retorna false se o poligono nao
+ * e simples (auto-intersecao, espinhos) ou se a area das partes nao confere;
+ * nesse caso a forma usa o teste de colisao par-a-par.
+ */
+static bool decompose_convex(Piece* piece, ConvexPart** out_parts, int* out_count) {
+    int n = piece->point_count;
+    if (n < 3) return false;
+
+    // Limpar pontos duplicados e colineares (apenas continuacao reta, nunca espinhos)
+    Point* pts = malloc(sizeof(Point) * n);
+    int m = 0;
+    for (int i = 0; i < n; i++) {
+        Point p = piece->points[i];
+        if (m > 0 && calculate_distance_squared(p, pts[m - 1]) < 1e-12) continue;
+        pts[m++] = p;
+    }
+    while (m > 1 && calculate_distance_squared(pts[0], pts[m - 1]) < 1e-12) m--;
+
+    bool changed = true;
+    while (changed && m >= 3) {
+        changed = false;
+        for (int i = 0; i < m && m >= 3; i++) {
+            Point a = pts[(i + m - 1) % m], b = pts[i], c = pts[(i + 1) % m];
+            double cr = cross_product(a, b, c);
+            double dot = (b.x - a.x) * (c.x - b.x) + (b.y - a.y) * (c.y - b.y);
+            if (fabs(cr) <= NFP_EPSILON * (1.0 + fabs(dot)) && dot > 0) {
+                memmove(&pts[i], &pts[i + 1], sizeof(Point) * (m - i - 1));
+                m--;
+                changed = true;
             }
         }
+    }
+    if (m < 3) { free(pts); return false; }
 
-        if (!piece_placed && local_result.board_count < MAX_BOARDS) {
-            Board* new_board = &local_result.boards[local_result.board_count];
-            new_board->width = input_data.board_x;
-            new_board->height = input_data.board_y;
-            new_board->placed_pieces = malloc(sizeof(PlacedPiece) * MAX_PIECES);
-            new_board->piece_count = 0;
-            new_board->used_area = 0;
-
-            if (place_piece_on_board_fast(piece_id, rotation_idx, new_board)) {
-                placed[piece_id] = true;
-                placed_count++;
-                piece_placed = true;
-                local_result.board_count++;
-            }
+    // Garantir orientacao anti-horaria
+    double signed_area = 0.0;
+    for (int i = 0; i < m; i++) {
+        int j = (i + 1) % m;
+        signed_area += pts[i].x * pts[j].y - pts[j].x * pts[i].y;
+    }
+    if (signed_area < 0) {
+        for (int i = 0, j = m - 1; i < j; i++, j--) {
+            Point t = pts[i]; pts[i] = pts[j]; pts[j] = t;
         }
     }
-
-    double total_used_area = 0;
-    for (int i = 0; i < local_result.board_count; i++) {
-        double board_area = local_result.boards[i].width * local_result.boards[i].height;
-        local_result.boards[i].efficiency = (local_result.boards[i].used_area / board_area) * 100.0;
-        total_used_area += local_result.boards[i].used_area;
+    double area = fabs(signed_area) * 0.5;
+
+    // Ear clipping sobre lista circular de indices
+    int* prev = malloc(sizeof(int) * m);
+    int* next = malloc(sizeof(int) * m);
+    int* polys = malloc(sizeof(int) * 3 * (m - 2) * 2);   // Triangulos e poligonos fundidos
+    int* poly_start = malloc(sizeof(int) * (m - 2));
+    int* poly_len = malloc(sizeof(int) * (m - 2));
+    for (int i = 0; i < m; i++) {
+        prev[i] = (i + m - 1) % m;
+        next[i] = (i + 1) % m;
     }
 
-    double total_board_area = local_result.board_count * input_data.board_x * input_data.board_y;
-    local_result.total_efficiency = total_board_area > 0 ? (total_used_area / total_board_area) * 100.0 : 0.0;
+    int tri_count = 0;
+    int remaining = m;
+    int current = 0;
+    int guard = 0;
+    bool ok = true;
+
+    while (remaining > 3) {
+        int a = prev[current], b = current, c = next[current];
+        bool is_ear = cross_product(pts[a], pts[b], pts[c]) > NFP_EPSILON;
+
+        if (is_ear) {
+            for (int k = next[c]; k != a; k = next[k]) {
+                if (point_in_triangle_inclusive(pts[k], pts[a], pts[b], pts[c]) &&
+                    calculate_distance_squared(pts[k], pts[a]) > 1e-12 &&
+                    calculate_distance_squared(pts[k], pts[c]) > 1e-12) {
+                    is_ear = false;
+                    break;
+                }
+            }
+        }
 
-    genome->fitness = local_result.total_efficiency * 2.0 - local_result.board_count * 5.0;
-    genome->board_count = local_result.board_count;
-    genome->total_efficiency = local_result.total_efficiency;
+        if (is_ear) {
+            poly_start[tri_count] = tri_count * 3;
+            poly_len[tri_count] = 3;
+            polys[tri_count * 3] = a;
+            polys[tri_count * 3 + 1] = b;
+            polys[tri_count * 3 + 2] = c;
+            tri_count++;
+            next[a] = c;
+            prev[c] = a;
+            remaining--;
+            current = c;
+            guard = 0;
+        } else {
+            current = next[current];
+            if (++guard > remaining) {
+                ok = false;   // Nenhuma orelha: poligono nao e simples
+                break;
+            }
+        }
+    }
 
-    if (placed_count < input_data.piece_count) {
-        genome->fitness -= (input_data.piece_count - placed_count) * 1000.0;
+    if (ok) {
+        int a = prev[current], b = current, c = next[current];
+        poly_start[tri_count] = tri_count * 3;
+        poly_len[tri_count] = 3;
+        polys[tri_count * 3] = a;
+        polys[tri_count * 3 + 1] = b;
+        polys[tri_count * 3 + 2] = c;
+        tri_count++;
+    }
 
-        #ifdef _OPENMP
-            #pragma omp critical
-        #endif
-        {
-            static bool logged = false;
-            if (!logged) {
-                printf("\n[AVISO] Pecas nao colocadas: ");
-                for (int i = 0; i < input_data.piece_count; i++) {
-                    if (!placed[i]) {
-                        printf("%d ", i);
+    free(prev);
+    free(next);
+
+    int poly_count = tri_count;
+    if (ok) {
+        // Hertel-Mehlhorn: fundir poligonos que compartilham uma diagonal
+        int* scratch = malloc(sizeof(int) * m);
+        int used = tri_count * 3;
+        int capacity = 3 * (m - 2) * 2;
+        for (int p = 0; p < poly_count; p++) {
+            bool grew = true;
+            while (grew) {
+                grew = false;
+                for (int q = 0; q < poly_count && !grew; q++) {
+                    if (q == p) continue;
+                    int* P = &polys[poly_start[p]];
+                    int pl = poly_len[p];
+                    int* Q = &polys[poly_start[q]];
+                    int ql = poly_len[q];
+
+                    for (int k = 0; k < pl && !grew; k++) {
+                        int u = P[k], v = P[(k + 1) % pl];
+                        for (int l = 0; l < ql; l++) {
+                            if (Q[l] != v || Q[(l + 1) % ql] != u) continue;
+
+                            // Resultado: v ... u (de P), depois Q apos u ate antes de v
+                            int len = 0;
+                            for (int t = 0; t < pl; t++) scratch[len++] = P[(k + 1 + t) % pl];
+                            for (int t = 2; t < ql; t++) scratch[len++] = Q[(l + t) % ql];
+
+                            if (polygon_is_convex_ccw(pts, scratch, len)) {
+                                if (used + len > capacity) {
+                                    // Compactar armazenamento
+                                    int off = 0;
+                                    int* compact = malloc(sizeof(int) * capacity);
+                                    for (int r = 0; r < poly_count; r++) {
+                                        memcpy(&compact[off], &polys[poly_start[r]], sizeof(int) * poly_len[r]);
+                                        poly_start[r] = off;
+                                        off += poly_len[r];
+                                    }
+                                    free(polys);
+                                    polys = compact;
+                                    used = off;
+                                }
+                                memcpy(&polys[used], scratch, sizeof(int) * len);
+                                poly_start[p] = used;
+                                poly_len[p] = len;
+                                used += len;
+
+                                // Remover q movendo o ultimo poligono para sua posicao
+                                poly_start[q] = poly_start[poly_count - 1];
+                                poly_len[q] = poly_len[poly_count - 1];
+                                if (p == poly_count - 1) p = q;
+                                poly_count--;
+                                grew = true;
+                            }
+                            break;
+                        }
                     }
                 }
-                printf("(total: %d)\n\n", input_data.piece_count - placed_count);
-                logged = true;
             }
         }
+        free(scratch);
     }
 
-    // Limpar resultado local
-    for (int i = 0; i < local_result.board_count; i++) {
-        for (int j = 0; j < local_result.boards[i].piece_count; j++) {
-            free(local_result.boards[i].placed_pieces[j].rotated_piece.points);
+    ConvexPart* parts = NULL;
+    if (ok) {
+        parts = malloc(sizeof(ConvexPart) * poly_count);
+        double parts_area = 0.0;
+        for (int p = 0; p < poly_count; p++) {
+            parts[p].point_count = poly_len[p];
+            parts[p].points = malloc(sizeof(Point) * poly_len[p]);
+            for (int k = 0; k < poly_len[p]; k++) {
+                parts[p].points[k] = pts[polys[poly_start[p] + k]];
+            }
+            convex_part_update_bbox(&parts[p]);
+            parts_area += calculate_polygon_area(parts[p].points, parts[p].point_count);
+        }
+        // Validacao: a particao deve cobrir exatamente a area do poligono
+        if (fabs(parts_area - area) > 1e-6 * (1.0 + area)) {
+            for (int p = 0; p < poly_count; p++) free(parts[p].points);
+            free(parts);
+            parts = NULL;
+            ok = false;
         }
-        free(local_result.boards[i].placed_pieces);
     }
-    free(local_result.boards);
-    free(placed);
-}
 
-int tournament_selection(Genome* population, int pop_size) {
-    unsigned int* seed = get_thread_seed();
+    free(polys);
+    free(poly_start);
+    free(poly_len);
+    free(pts);
 
-    int best_idx = thread_safe_rand(seed) % pop_size;
-    double best_fitness = population[best_idx].fitness;
+    if (!ok) return false;
+    *out_parts = parts;
+    *out_count = poly_count;
+    return true;
+}
 
-    for (int i = 1; i < TOURNAMENT_SIZE; i++) {
-        int candidate_idx = thread_safe_rand(seed) % pop_size;
-        if (population[candidate_idx].fitness > best_fitness) {
-            best_idx = candidate_idx;
-            best_fitness = population[candidate_idx].fitness;
-        }
-    }
+// Soma de Minkowski de dois poligonos convexos CCW: P (+) -Q. Retorna numero de vertices.
+static int minkowski_sum_convex(const ConvexPart* P, const ConvexPart* Q, Point* out) {
+    int n = P->point_count, m = Q->point_count;
 
-    return best_idx;
-}
-
-Genome order_crossover(Genome* parent1, Genome* parent2) {
-    Genome child;
-    child.piece_sequence = malloc(sizeof(int) * input_data.piece_count);
-    child.rotation_choices = malloc(sizeof(int) * input_data.piece_count);
-    child.fitness = 0.0;
-    child.board_count = 0;
-    child.total_efficiency = 0.0;
-
-    unsigned int* seed = get_thread_seed();
-
-    for (int i = 0; i < input_data.piece_count; i++) {
-        child.piece_sequence[i] = -1;
+    int i0 = 0, j0 = 0;
+    for (int i = 1; i < n; i++) {
+        if (P->points[i].y < P->points[i0].y ||
+            (P->points[i].y == P->points[i0].y && P->points[i].x < P->points[i0].x)) i0 = i;
     }
-
-    int cut1 = thread_safe_rand(seed) % input_data.piece_count;
-    int cut2 = thread_safe_rand(seed) % input_data.piece_count;
-    if (cut1 > cut2) {
-        int temp = cut1;
-        cut1 = cut2;
-        cut2 = temp;
+    // -Q: o vertice mais baixo de -Q e o mais alto de Q
+    for (int j = 1; j < m; j++) {
+        if (Q->points[j].y > Q->points[j0].y ||
+            (Q->points[j].y == Q->points[j0].y && Q->points[j].x > Q->points[j0].x)) j0 = j;
     }
 
-    for (int i = cut1; i <= cut2; i++) {
-        child.piece_sequence[i] = parent1->piece_sequence[i];
+    int count = 0, i = 0, j = 0;
+    while (i < n || j < m) {
+        Point p = P->points[(i0 + i) % n];
+        Point q = Q->points[(j0 + j) % m];
+        out[count].x = p.x - q.x;
+        out[count].y = p.y - q.y;
+        count++;
+
+        Point pn = P->points[(i0 + i + 1) % n];
+        Point qn = Q->points[(j0 + j + 1) % m];
+        double e1x = pn.x - p.x, e1y = pn.y - p.y;
+        double e2x = q.x - qn.x, e2y = q.y - qn.y;   // Aresta de -Q
+        double cr = e1x * e2y - e1y * e2x;
+
+        if (j == m || (i < n && cr > 0)) i++;
+        else if (i == n || cr < 0) j++;
+        else { i++; j++; }
     }
+    return count;
+}
 
-    int child_idx = (cut2 + 1) % input_data.piece_count;
-    for (int parent2_idx = 0; parent2_idx < input_data.piece_count; parent2_idx++) {
-        int gene = parent2->piece_sequence[(cut2 + 1 + parent2_idx) % input_data.piece_count];
-
-        bool already_in = false;
-        for (int i = cut1; i <= cut2; i++) {
-            if (child.piece_sequence[i] == gene) {
-                already_in = true;
-                break;
-            }
+static void nfp_build_pair(int a, int b) {
+    NfpPair* pair = &nfp_pairs[nfp_pair_index(a, b)];
+    OrientedShape* A = &shape_table[a];
+    OrientedShape* B = &shape_table[b];
+
+    int total_parts = A->part_count * B->part_count;
+    size_t sum_a = 0, sum_b = 0;
+    for (int i = 0; i < A->part_count; i++) sum_a += A->parts[i].point_count;
+    for (int j = 0; j < B->part_count; j++) sum_b += B->parts[j].point_count;
+    size_t total_points = sum_a * B->part_count + sum_b * A->part_count;
+
+    size_t bytes = sizeof(NfpGroup) * A->part_count + sizeof(ConvexPart) * total_parts +
+                   sizeof(Point) * total_points;
+    char* block = malloc(bytes);
+    pair->block = block;
+    pair->groups = (NfpGroup*)block;
+    pair->group_count = A->part_count;
+    pair->parts = (ConvexPart*)(block + sizeof(NfpGroup) * A->part_count);
+    pair->part_count = total_parts;
+    Point* point_pool_nfp = (Point*)(block + sizeof(NfpGroup) * A->part_count + sizeof(ConvexPart) * total_parts);
+
+    pair->min_x = pair->min_y = DBL_MAX;
+    pair->max_x = pair->max_y = -DBL_MAX;
+
+    int part_idx = 0;
+    for (int i = 0; i < A->part_count; i++) {
+        NfpGroup* group = &pair->groups[i];
+        group->first = part_idx;
+        group->count = B->part_count;
+        group->min_x = group->min_y = DBL_MAX;
+        group->max_x = group->max_y = -DBL_MAX;
+
+        for (int j = 0; j < B->part_count; j++) {
+            ConvexPart* part = &pair->parts[part_idx++];
+            part->points = point_pool_nfp;
+            part->point_count = minkowski_sum_convex(&A->parts[i], &B->parts[j], point_pool_nfp);
+            point_pool_nfp += part->point_count;
+            convex_part_update_bbox(part);
+
+            group->min_x = min_double(group->min_x, part->min_x);
+            group->min_y = min_double(group->min_y, part->min_y);
+            group->max_x = max_double(group->max_x, part->max_x);
+            group->max_y = max_double(group->max_y, part->max_y);
         }
 
-        if (!already_in) {
-            child.piece_sequence[child_idx] = gene;
-            child_idx = (child_idx + 1) % input_data.piece_count;
-        }
+        pair->min_x = min_double(pair->min_x, group->min_x);
+        pair->min_y = min_double(pair->min_y, group->min_y);
+        pair->max_x = max_double(pair->max_x, group->max_x);
+        pair->max_y = max_double(pair->max_y, group->max_y);
     }
+}
 
-    // CORRIGIDO: rotation_choices é indexado por piece_id, então herda diretamente dos pais - THREAD-SAFE
-    for (int piece_id = 0; piece_id < input_data.piece_count; piece_id++) {
-        if (thread_safe_rand(seed) % 2 == 0) {
-            child.rotation_choices[piece_id] = parent1->rotation_choices[piece_id];
-        } else {
-            child.rotation_choices[piece_id] = parent2->rotation_choices[piece_id];
+/**
+ * Decompoe as formas da tabela de rotacoes e constroi os NFPs de todos os pares.
+ * Executado uma unica vez apos shape_table_init; os NFPs sao somente-leitura
+ * durante o AG e compartilhados por todas as threads.
+ */
+void nfp_init() {
+    int decomposed = 0;
+    double parts_total = 0, points_total = 0;
+
+    for (int s = 0; s < shape_count; s++) {
+        OrientedShape* shape = &shape_table[s];
+        if (decompose_convex(&shape->piece, &shape->parts, &shape->part_count)) {
+            decomposed++;
+            parts_total += shape->part_count;
+            for (int k = 0; k < shape->part_count; k++) points_total += shape->parts[k].point_count;
         }
     }
 
-    return child;
-}
-
-void mutate_genome(Genome* genome) {
-    unsigned int* seed = get_thread_seed();
+    // Estimativa de memoria: cada soma tem |A_i| + |B_j| vertices
+    double estimated = (parts_total * points_total * sizeof(Point) +
+                        parts_total * parts_total * sizeof(ConvexPart)) * 0.5;
 
-    // OTIMIZADO: Mutação MUITO mais agressiva para exploração profunda - THREAD-SAFE
-    // Swap mutation: AUMENTADO para 4-8 swaps (era 2-4)
-    int num_swaps = 4 + thread_safe_rand(seed) % 5;  // 4-8 swaps
-    for (int m = 0; m < num_swaps; m++) {
-        if ((double)thread_safe_rand(seed) / RAND_MAX < MUTATION_RATE) {
-            int pos1 = thread_safe_rand(seed) % input_data.piece_count;
-            int pos2 = thread_safe_rand(seed) % input_data.piece_count;
+    LOG_SUMMARY("Formas orientadas: %d (%d decompostas em %.0f partes convexas)\n",
+                shape_count, decomposed, parts_total);
 
-            int temp = genome->piece_sequence[pos1];
-            genome->piece_sequence[pos1] = genome->piece_sequence[pos2];
-            genome->piece_sequence[pos2] = temp;
-        }
+    if (estimated > NFP_MEMORY_BUDGET) {
+        LOG_SUMMARY("NFP DESATIVADO: memoria estimada %.0f MB excede o limite de %.0f MB\n\n",
+                    estimated / (1024.0 * 1024.0), NFP_MEMORY_BUDGET / (1024.0 * 1024.0));
+        return;
     }
 
-    // Rotation mutation: AUMENTADO para 6-10 rotações (era 3-6)
-    int num_rotations = 6 + thread_safe_rand(seed) % 5;  // 6-10 rotações
-    for (int m = 0; m < num_rotations; m++) {
-        if ((double)thread_safe_rand(seed) / RAND_MAX < MUTATION_RATE) {
-            int piece_id = thread_safe_rand(seed) % input_data.piece_count;
-            int angle_count = input_data.pieces[piece_id].angle_count;
-            if (angle_count > 1) {
-                genome->rotation_choices[piece_id] = thread_safe_rand(seed) % angle_count;
-            }
+    size_t pair_count = (size_t)shape_count * (shape_count + 1) / 2;
+    nfp_pairs = calloc(pair_count, sizeof(NfpPair));
+
+    #ifdef _OPENMP
+        #pragma omp parallel for schedule(dynamic)
+    #endif
+    for (int a = 0; a < shape_count; a++) {
+        if (!shape_table[a].parts) continue;
+        for (int b = a; b < shape_count; b++) {
+            if (!shape_table[b].parts) continue;
+            nfp_build_pair(a, b);
         }
     }
 
-    // NOVO: Block swap mutation - troca blocos inteiros de peças (20% de chance)
-    if ((double)thread_safe_rand(seed) / RAND_MAX < 0.2) {
-        int block_size = 2 + thread_safe_rand(seed) % 4;  // blocos de 2-5 peças
-        int pos1 = thread_safe_rand(seed) % (input_data.piece_count - block_size);
-        int pos2 = thread_safe_rand(seed) % (input_data.piece_count - block_size);
+    nfp_enabled = true;
+    LOG_SUMMARY("NFPs pre-calculados: %zu pares (%.1f MB)\n\n", pair_count, estimated / (1024.0 * 1024.0));
+}
 
-        for (int i = 0; i < block_size; i++) {
-            int temp = genome->piece_sequence[pos1 + i];
-            genome->piece_sequence[pos1 + i] = genome->piece_sequence[pos2 + i];
-            genome->piece_sequence[pos2 + i] = temp;
-        }
+void nfp_free() {
+    if (nfp_pairs) {
+        size_t pair_count = (size_t)shape_count * (shape_count + 1) / 2;
+        for (size_t i = 0; i < pair_count; i++) free(nfp_pairs[i].block);
+        free(nfp_pairs);
+        nfp_pairs = NULL;
     }
+    for (int s = 0; s < shape_count; s++) {
+        for (int k = 0; k < shape_table[s].part_count; k++) free(shape_table[s].parts[k].points);
+        free(shape_table[s].parts);
+        shape_table[s].parts = NULL;
+        shape_table[s].part_count = 0;
+    }
+    nfp_enabled = false;
 }
 
-Genome copy_genome(Genome* source) {
-    Genome copy;
-    copy.piece_sequence = malloc(sizeof(int) * input_data.piece_count);
-    copy.rotation_choices = malloc(sizeof(int) * input_data.piece_count);
-
-    memcpy(copy.piece_sequence, source->piece_sequence, sizeof(int) * input_data.piece_count);
-    memcpy(copy.rotation_choices, source->rotation_choices, sizeof(int) * input_data.piece_count);
+// Retorna o par (a <= b) e se o deslocamento deve ser negado: NFP(B, A) = -NFP(A, B)
+static inline NfpPair* nfp_lookup(int fixed_shape, int moving_shape, bool* flip) {
+    if (!nfp_enabled || fixed_shape < 0 || moving_shape < 0) return NULL;
+    NfpPair* pair;
+    if (fixed_shape <= moving_shape) {
+        pair = &nfp_pairs[nfp_pair_index(fixed_shape, moving_shape)];
+        *flip = false;
+    } else {
+        pair = &nfp_pairs[nfp_pair_index(moving_shape, fixed_shape)];
+        *flip = true;
+    }
+    return pair->block ? pair : NULL;
+}
 
-    copy.fitness = source->fitness;
-    copy.board_count = source->board_count;
-    copy.total_efficiency = source->total_efficiency;
+// Distancia de q a um poligono convexo CCW menor que min_distance (ou q dentro)
+static bool point_near_convex(const ConvexPart* part, Point q, double min_distance) {
+    bool inside = true;
+    for (int k = 0, l = part->point_count - 1; k < part->point_count; l = k++) {
+        if (cross_product(part->points[l], part->points[k], q) < 0) {
+            inside = false;
+            break;
+        }
+    }
+    if (inside) return true;
 
-    return copy;
+    double limit_sq = min_distance * min_distance;
+    for (int k = 0, l = part->point_count - 1; k < part->point_count; l = k++) {
+        if (point_to_segment_distance_sq(q, part->points[l], part->points[k]) < limit_sq) return true;
+    }
+    return false;
 }
 
-void free_genome(Genome* genome) {
-    free(genome->piece_sequence);
-    free(genome->rotation_choices);
-}
+// Consulta ponto-no-NFP: true se as pecas colidem com o deslocamento q
+static bool nfp_query(const NfpPair* pair, Point q, double min_distance) {
+    if (q.x < pair->min_x - min_distance || q.x > pair->max_x + min_distance ||
+        q.y < pair->min_y - min_distance || q.y > pair->max_y + min_distance) {
+        return false;
+    }
 
-// Avalia um genoma e salva o resultado na estrutura global 'result'
-void evaluate_genome_to_global(Genome* genome) {
-    if (result.boards) {
-        for (int i = 0; i < result.board_count; i++) {
-            for (int j = 0; j < result.boards[i].piece_count; j++) {
-                free(result.boards[i].placed_pieces[j].rotated_piece.points);
+    for (int g = 0; g < pair->group_count; g++) {
+        const NfpGroup* group = &pair->groups[g];
+        if (q.x < group->min_x - min_distance || q.x > group->max_x + min_distance ||
+            q.y < group->min_y - min_distance || q.y > group->max_y + min_distance) {
+            continue;
+        }
+        for (int k = 0; k < group->count; k++) {
+            const ConvexPart* part = &pair->parts[group->first + k];
+            if (q.x < part->min_x - min_distance || q.x > part->max_x + min_distance ||
+                q.y < part->min_y - min_distance || q.y > part->max_y + min_distance) {
+                continue;
             }
-            free(result.boards[i].placed_pieces);
+            if (point_near_convex(part, q, min_distance)) return true;
         }
-        free(result.boards);
     }
+    return false;
+}
 
-    result.boards = malloc(sizeof(Board) * MAX_BOARDS);
-    result.board_count = 0;
-
-    bool* placed = calloc(input_data.piece_count, sizeof(bool));
-    int placed_count = 0;
-
-    for (int seq_idx = 0; seq_idx < input_data.piece_count; seq_idx++) {
-        int piece_id = genome->piece_sequence[seq_idx];
-        int rotation_idx = genome->rotation_choices[piece_id];
-
-        if (placed[piece_id]) continue;
+// Intervalo [t_in, t_out] do raio q + t*u dentro de [min, max] em um eixo (slab test)
+static inline bool ray_slab(double q, double u, double lo, double hi, double* t_in, double* t_out) {
+    if (fabs(u) < 1e-15) return q >= lo && q <= hi;
+    double t0 = (lo - q) / u, t1 = (hi - q) / u;
+    if (t0 > t1) { double t = t0; t0 = t1; t1 = t; }
+    if (t0 > *t_in) *t_in = t0;
+    if (t1 < *t_out) *t_out = t1;
+    return *t_in <= *t_out;
+}
 
-        bool piece_placed = false;
+/**
+ * Deslizamento ate o contato: menor t >= 0 tal que q + t*u entra no NFP
+ * inflado por min_distance (offset com quinas em esquadria, que contem o
+ * offset arredondado, logo o ponto de contato nunca viola a distancia).
+ * Retorna -1 se o raio nao encontra o NFP.
+ */
+static double nfp_slide(const NfpPair* pair, Point q, Point u, double min_distance) {
+    double t_in = 0, t_out = DBL_MAX;
+    if (!ray_slab(q.x, u.x, pair->min_x - min_distance, pair->max_x + min_distance, &t_in, &t_out) ||
+        !ray_slab(q.y, u.y, pair->min_y - min_distance, pair->max_y + min_distance, &t_in, &t_out)) {
+        return -1;
+    }
 
-        for (int board_idx = 0; board_idx < result.board_count; board_idx++) {
-            if (place_piece_on_board_fast(piece_id, rotation_idx, &result.boards[board_idx])) {
-                placed[piece_id] = true;
-                placed_count++;
-                piece_placed = true;
-                break;
-            }
+    double best = DBL_MAX;
+    for (int g = 0; g < pair->group_count; g++) {
+        const NfpGroup* group = &pair->groups[g];
+        double g_in = 0, g_out = best;
+        if (!ray_slab(q.x, u.x, group->min_x - min_distance, group->max_x + min_distance, &g_in, &g_out) ||
+            !ray_slab(q.y, u.y, group->min_y - min_distance, group->max_y + min_distance, &g_in, &g_out)) {
+            continue;
         }
 
-        if (!piece_placed && result.board_count < MAX_BOARDS) {
-            Board* new_board = &result.boards[result.board_count];
-            new_board->width = input_data.board_x;
-            new_board->height = input_data.board_y;
-            new_board->placed_pieces = malloc(sizeof(PlacedPiece) * MAX_PIECES);
-            new_board->piece_count = 0;
-            new_board->used_area = 0;
+        for (int k = 0; k < group->count; k++) {
+            const ConvexPart* part = &pair->parts[group->first + k];
+            double p_in = 0, p_out = best;
+            if (!ray_slab(q.x, u.x, part->min_x - min_distance, part->max_x + min_distance, &p_in, &p_out) ||
+                !ray_slab(q.y, u.y, part->min_y - min_distance, part->max_y + min_distance, &p_in, &p_out)) {
+                continue;
+            }
 
-            if (place_piece_on_board_fast(piece_id, rotation_idx, new_board)) {
-                placed[piece_id] = true;
-                placed_count++;
-                piece_placed = true;
-                result.board_count++;
+            // Cyrus-Beck contra os semiplanos das arestas deslocadas por min_distance
+            bool hit = true;
+            for (int e = 0, l = part->point_count - 1; e < part->point_count && hit; l = e++) {
+                Point v0 = part->points[l], v1 = part->points[e];
+                double ex = v1.x - v0.x, ey = v1.y - v0.y;
+                double len = sqrt(ex * ex + ey * ey);
+                if (len < 1e-12) continue;
+                double nx = ey / len, ny = -ex / len;   // Normal externa (CCW)
+                double num = min_distance - (nx * (q.x - v0.x) + ny * (q.y - v0.y));
+                double den = nx * u.x + ny * u.y;
+                if (fabs(den) < 1e-15) {
+                    if (num < 0) hit = false;
+                } else if (den > 0) {
+                    double t = num / den;
+                    if (t < p_out) p_out = t;
+                } else {
+                    double t = num / den;
+                    if (t > p_in) p_in = t;
+                }
+                if (p_in > p_out) hit = false;
             }
+            if (hit && p_in < best) best = p_in;
         }
     }
+    return best < DBL_MAX ? best : -1;
+}
 
-    double total_used_area = 0;
-    for (int i = 0; i < result.board_count; i++) {
-        double board_area = result.boards[i].width * result.boards[i].height;
-        result.boards[i].efficiency = (result.boards[i].used_area / board_area) * 100.0;
-        total_used_area += result.boards[i].used_area;
+// Colisao entre peca movel (em pos) e peca ja posicionada; usa NFP quando disponivel
+static inline bool pieces_collide(Piece* moving, Point pos, Piece* fixed, Point fixed_pos, double min_distance) {
+    PROFILE_COUNT(PROF_COLLISION_CALLS);
+    bool flip;
+    NfpPair* pair = nfp_lookup(fixed->shape_id, moving->shape_id, &flip);
+    if (!pair) {
+        return polygons_collide(moving, pos, fixed, fixed_pos, min_distance);
     }
+    PROFILE_COUNT(PROF_NFP_QUERIES);
+    Point q = {pos.x - fixed_pos.x, pos.y - fixed_pos.y};
+    if (flip) { q.x = -q.x; q.y = -q.y; }
+    return nfp_query(pair, q, min_distance);
+}
 
-    double total_board_area = result.board_count * input_data.board_x * input_data.board_y;
-    result.total_efficiency = total_board_area > 0 ? (total_used_area / total_board_area) * 100.0 : 0.0;
+// ==================== SPATIAL INDEX ====================
+// Grade uniforme por placa: cada peca posicionada e registrada nas celulas
+// cobertas por sua bounding box. Os testes de colisao consultam apenas as
+// celulas cobertas pela bounding box do candidato inflada pela distancia
+// minima, em vez de percorrer todas as pecas da placa.
 
-    genome->fitness = result.total_efficiency * 2.0 - result.board_count * 5.0;
-    genome->board_count = result.board_count;
-    genome->total_efficiency = result.total_efficiency;
+#define SPATIAL_GRID_MAX_CELLS 64   // Limite de celulas por eixo
+#define DEAD_SHAPE_WAYS 4           // Formas lembradas por peca (potencia de 2)
 
-    free(placed);
-}
+static int spatial_grid_cols = 1;
+static int spatial_grid_rows = 1;
 
-void save_best_result() {
-    if (best_result.boards) {
-        for (int i = 0; i < best_result.board_count; i++) {
-            for (int j = 0; j < best_result.boards[i].piece_count; j++) {
-                free(best_result.boards[i].placed_pieces[j].rotated_piece.points);
-            }
-            free(best_result.boards[i].placed_pieces);
-        }
-        free(best_result.boards);
+// Dimensiona a grade pelo tamanho medio das formas (celula ~ uma peca media)
+void spatial_index_setup() {
+    double avg_dim = 0;
+    for (int s = 0; s < shape_count; s++) {
+        avg_dim += max_double(shape_table[s].piece.width, shape_table[s].piece.height);
     }
+    avg_dim = shape_count > 0 ? avg_dim / shape_count : 1.0;
+    if (avg_dim < 1.0) avg_dim = 1.0;
+
+    spatial_grid_cols = (int)ceil(input_data.board_x / avg_dim);
+    spatial_grid_rows = (int)ceil(input_data.board_y / avg_dim);
+    if (spatial_grid_cols < 1) spatial_grid_cols = 1;
+    if (spatial_grid_rows < 1) spatial_grid_rows = 1;
+    if (spatial_grid_cols > SPATIAL_GRID_MAX_CELLS) spatial_grid_cols = SPATIAL_GRID_MAX_CELLS;
+    if (spatial_grid_rows > SPATIAL_GRID_MAX_CELLS) spatial_grid_rows = SPATIAL_GRID_MAX_CELLS;
+}
 
-    best_result.board_count = result.board_count;
-    best_result.total_efficiency = result.total_efficiency;
-    best_result.boards = malloc(sizeof(Board) * result.board_count);
-
-    for (int i = 0; i < result.board_count; i++) {
-        best_result.boards[i].width = result.boards[i].width;
-        best_result.boards[i].height = result.boards[i].height;
-        best_result.boards[i].used_area = result.boards[i].used_area;
-        best_result.boards[i].efficiency = result.boards[i].efficiency;
-        best_result.boards[i].piece_count = result.boards[i].piece_count;
-        best_result.boards[i].placed_pieces = malloc(sizeof(PlacedPiece) * result.boards[i].piece_count);
+// Inicializa uma placa vazia com sua grade, tudo alocado na arena
+void board_init(Board* board, Arena* arena) {
+    board->width = input_data.board_x;
+    board->height = input_data.board_y;
+    board->placed_pieces = arena_alloc(arena, sizeof(PlacedPiece) * input_data.piece_count);
+    board->piece_count = 0;
+    board->used_area = 0;
+    board->efficiency = 0;
+
+    SpatialGrid* grid = &board->grid;
+    grid->cols = spatial_grid_cols;
+    grid->rows = spatial_grid_rows;
+    grid->cell_w = board->width / grid->cols;
+    grid->cell_h = board->height / grid->rows;
+    grid->cell_head = arena_alloc(arena, sizeof(int) * grid->cols * grid->rows);
+    memset(grid->cell_head, 0xff, sizeof(int) * grid->cols * grid->rows);   // -1
+    grid->entry_capacity = input_data.piece_count;
+    grid->entry_piece = arena_alloc(arena, sizeof(int) * grid->entry_capacity);
+    grid->entry_next = arena_alloc(arena, sizeof(int) * grid->entry_capacity);
+    grid->entry_count = 0;
+    grid->first_cell = arena_alloc(arena, sizeof(int) * input_data.piece_count);
+    grid->dead_shape = arena_alloc(arena, sizeof(int) * DEAD_SHAPE_WAYS * input_data.piece_count);
+    grid->arena = arena;
+}
 
-        for (int j = 0; j < result.boards[i].piece_count; j++) {
-            best_result.boards[i].placed_pieces[j] = result.boards[i].placed_pieces[j];
+// Faixa de celulas coberta por um retangulo em coordenadas da placa
+static inline void grid_cell_range(const SpatialGrid* grid, double min_x, double min_y,
+                                   double max_x, double max_y,
+                                   int* c0, int* r0, int* c1, int* r1) {
+    *c0 = (int)floor(min_x / grid->cell_w);
+    *r0 = (int)floor(min_y / grid->cell_h);
+    *c1 = (int)floor(max_x / grid->cell_w);
+    *r1 = (int)floor(max_y / grid->cell_h);
+    if (*c0 < 0) *c0 = 0;
+    if (*r0 < 0) *r0 = 0;
+    if (*c1 >= grid->cols) *c1 = grid->cols - 1;
+    if (*r1 >= grid->rows) *r1 = grid->rows - 1;
+}
 
-            PlacedPiece* src = &result.boards[i].placed_pieces[j];
-            PlacedPiece* dst = &best_result.boards[i].placed_pieces[j];
+void grid_insert(Board* board, int piece_idx) {
+    SpatialGrid* grid = &board->grid;
+    PlacedPiece* placed = &board->placed_pieces[piece_idx];
+    int c0, r0, c1, r1;
+    grid_cell_range(grid,
+                    placed->rotated_piece->min_x + placed->position.x,
+                    placed->rotated_piece->min_y + placed->position.y,
+                    placed->rotated_piece->max_x + placed->position.x,
+                    placed->rotated_piece->max_y + placed->position.y,
+                    &c0, &r0, &c1, &r1);
+
+    int needed = grid->entry_count + (c1 - c0 + 1) * (r1 - r0 + 1);
+    if (needed > grid->entry_capacity) {
+        int capacity = grid->entry_capacity * 2;
+        if (capacity < needed) capacity = needed;
+        int* pieces = arena_alloc(grid->arena, sizeof(int) * capacity);
+        int* next = arena_alloc(grid->arena, sizeof(int) * capacity);
+        memcpy(pieces, grid->entry_piece, sizeof(int) * grid->entry_count);
+        memcpy(next, grid->entry_next, sizeof(int) * grid->entry_count);
+        grid->entry_piece = pieces;
+        grid->entry_next = next;
+        grid->entry_capacity = capacity;
+    }
 
-            dst->rotated_piece.points = malloc(sizeof(Point) * src->rotated_piece.point_count);
-            memcpy(dst->rotated_piece.points, src->rotated_piece.points,
-                   sizeof(Point) * src->rotated_piece.point_count);
+    grid->first_cell[piece_idx] = r0 * grid->cols + c0;
+    memset(&grid->dead_shape[piece_idx * DEAD_SHAPE_WAYS], 0xff, sizeof(int) * DEAD_SHAPE_WAYS);
+    for (int r = r0; r <= r1; r++) {
+        for (int c = c0; c <= c1; c++) {
+            int cell = r * grid->cols + c;
+            int e = grid->entry_count++;
+            grid->entry_piece[e] = piece_idx;
+            grid->entry_next[e] = grid->cell_head[cell];
+            grid->cell_head[cell] = e;
         }
     }
 }
 
-#if ENABLE_CONCAVE_NESTING
-// ==================== CONCAVE NESTING OPTIMIZATION (PHASE 3) ====================
-
-/**
- * Calculate concavity ratio for a piece.
- * Returns ratio of empty space in bounding box (1.0 - polygon_area/bbox_area)
- * Higher values indicate more concavity.
- */
-double calculate_concavity_ratio(Piece* piece) {
-    double bbox_area = piece->width * piece->height;
-    if (bbox_area < 1e-10) return 0.0;
+// Remove a peca das celulas de sua posicao atual (antes de move-la)
+void grid_remove(Board* board, int piece_idx) {
+    SpatialGrid* grid = &board->grid;
+    PlacedPiece* placed = &board->placed_pieces[piece_idx];
+    int c0, r0, c1, r1;
+    grid_cell_range(grid,
+                    placed->rotated_piece->min_x + placed->position.x,
+                    placed->rotated_piece->min_y + placed->position.y,
+                    placed->rotated_piece->max_x + placed->position.x,
+                    placed->rotated_piece->max_y + placed->position.y,
+                    &c0, &r0, &c1, &r1);
+
+    for (int r = r0; r <= r1; r++) {
+        for (int c = c0; c <= c1; c++) {
+            int* link = &grid->cell_head[r * grid->cols + c];
+            while (*link >= 0) {
+                if (grid->entry_piece[*link] == piece_idx) {
+                    *link = grid->entry_next[*link];
+                } else {
+                    link = &grid->entry_next[*link];
+                }
+            }
+        }
+    }
+}
 
-    double polygon_area = piece->area;
-    double ratio = 1.0 - (polygon_area / bbox_area);
+// Move uma peca ja posicionada, mantendo a grade consistente
+void board_move_piece(Board* board, int piece_idx, Point position, int angle, Piece* rotated) {
+    grid_remove(board, piece_idx);
+    PlacedPiece* placed = &board->placed_pieces[piece_idx];
+    placed->position = position;
+    placed->angle = angle;
+    placed->rotated_piece = rotated;
+    grid_insert(board, piece_idx);
 
-    return (ratio < 0.0) ? 0.0 : ratio;
+    // O espaco liberado pode acomodar contatos que antes falhavam
+    memset(board->grid.dead_shape, 0xff, sizeof(int) * DEAD_SHAPE_WAYS * board->piece_count);
 }
 
-/**
- * Sample concave regions using grid-based approach.
- * Finds points inside bounding box but outside polygon (concavity).
- * Returns ConcavityInfo with candidate points or NULL if no significant concavity.
- */
-ConcavityInfo* sample_concave_regions(Piece* piece, PlacedPiece* placed, int grid_res) {
-    double concavity_ratio = calculate_concavity_ratio(piece);
-
-    // Early exit if concavity below threshold
-    if (concavity_ratio < CONCAVITY_THRESHOLD) {
-        return NULL;
+// Reconstroi a grade a partir de placed_pieces (apos copia da placa)
+void grid_rebuild(Board* board) {
+    SpatialGrid* grid = &board->grid;
+    memset(grid->cell_head, 0xff, sizeof(int) * grid->cols * grid->rows);
+    grid->entry_count = 0;
+    for (int i = 0; i < board->piece_count; i++) {
+        grid_insert(board, i);
     }
+}
 
-    ConcavityInfo* info = malloc(sizeof(ConcavityInfo));
-    if (!info) return NULL;
+// Verifica limites da placa e colisao com as pecas vizinhas (exceto exclude_idx, -1 = nenhuma).
+// Somente leitura sobre a placa: threads podem testar posicoes na mesma placa.
+bool piece_fits_in_board_excluding(Piece* piece, Point position, Board* board, int exclude_idx) {
+    const double EPSILON = 2.0;
+    double margin = input_data.distance_between_boards;
 
-    info->concavity_ratio = concavity_ratio;
+    double left_boundary = margin - EPSILON;
+    double bottom_boundary = margin - EPSILON;
+    double right_boundary = board->width - margin + EPSILON;
+    double top_boundary = board->height - margin + EPSILON;
 
-    // Allocate for worst case (all grid points)
-    info->points = malloc(sizeof(ConcavePoint) * grid_res * grid_res);
-    if (!info->points) {
-        free(info);
-        return NULL;
+    if ((position.x + piece->min_x) < left_boundary ||
+        (position.y + piece->min_y) < bottom_boundary ||
+        (position.x + piece->max_x) > right_boundary ||
+        (position.y + piece->max_y) > top_boundary) {
+        return false;
     }
-    info->num_points = 0;
-
-    // Grid sampling: check each grid point
-    double step_x = piece->width / (grid_res - 1);
-    double step_y = piece->height / (grid_res - 1);
 
-    for (int iy = 0; iy < grid_res; iy++) {
-        for (int ix = 0; ix < grid_res; ix++) {
-            // Local coordinates relative to piece
-            double local_x = piece->min_x + ix * step_x;
-            double local_y = piece->min_y + iy * step_y;
+    double min_distance = input_data.distance_between_pieces;
+    SpatialGrid* grid = &board->grid;
+    int c0, r0, c1, r1;
+    grid_cell_range(grid,
+                    position.x + piece->min_x - min_distance,
+                    position.y + piece->min_y - min_distance,
+                    position.x + piece->max_x + min_distance,
+                    position.y + piece->max_y + min_distance,
+                    &c0, &r0, &c1, &r1);
+
+    for (int r = r0; r <= r1; r++) {
+        for (int c = c0; c <= c1; c++) {
+            for (int e = grid->cell_head[r * grid->cols + c]; e >= 0; e = grid->entry_next[e]) {
+                int i = grid->entry_piece[e];
+                if (i == exclude_idx) continue;
+
+                // Peca em varias celulas: testar apenas na primeira celula comum
+                // (canto inferior esquerdo da intersecao das faixas)
+                int first = grid->first_cell[i];
+                int pr0 = first / grid->cols, pc0 = first % grid->cols;
+                if (r != (pr0 > r0 ? pr0 : r0) || c != (pc0 > c0 ? pc0 : c0)) continue;
+
+                if (pieces_collide(piece, position, board->placed_pieces[i].rotated_piece,
+                                   board->placed_pieces[i].position, min_distance)) {
+                    return false;
+                }
+            }
+        }
+    }
 
-            Point test_point = {local_x, local_y};
+    return true;
+}
 
-            // Check if point is in bbox but NOT in polygon
-            bool in_bbox = (local_x >= piece->min_x && local_x <= piece->max_x &&
-                           local_y >= piece->min_y && local_y <= piece->max_y);
+bool piece_fits_in_board(Piece* piece, Point position, Board* board) {
+    return piece_fits_in_board_excluding(piece, position, board, -1);
+}
 
-            bool in_polygon = point_in_polygon(test_point, piece->points, piece->point_count);
+// Versão otimizada da busca de posição. Retorna false se a peca nao cabe;
+// a posicao vai em *out (pode ter coordenada negativa quando a bbox da peca
+// rotacionada comeca antes da origem, entao nao ha valor sentinela).
+bool find_best_position_fast(Piece* piece, Board* board, Point* out) {
+    Point best_pos = {0, 0};
+    double best_score = DBL_MAX;
+    bool found = false;
 
-            // This is a concave point (in bbox but outside polygon)
-            if (in_bbox && !in_polygon) {
-                // Convert to world coordinates
-                info->points[info->num_points].x = local_x + placed->position.x;
-                info->points[info->num_points].y = local_y + placed->position.y;
-                info->num_points++;
-            }
-        }
-    }
+    double min_x = input_data.distance_between_boards;
+    double min_y = input_data.distance_between_boards;
 
-    // If no concave points found, free and return NULL
-    if (info->num_points == 0) {
-        free(info->points);
-        free(info);
-        return NULL;
-    }
+    double usable_width = board->width - 2 * input_data.distance_between_boards;
+    double usable_height = board->height - 2 * input_data.distance_between_boards;
 
-    // Shrink allocation to actual size
-    ConcavePoint* resized = realloc(info->points, sizeof(ConcavePoint) * info->num_points);
-    if (resized) {
-        info->points = resized;
+    if (piece->width > usable_width || piece->height > usable_height) {
+        return false;
+    }
+
+    // Primeira peça - canto inferior esquerdo
+    if (board->piece_count == 0) {
+        Point first_pos = {min_x, min_y};
+        if (piece_fits_in_board(piece, first_pos, board)) {
+            *out = first_pos;
+            return true;
+        }
+        // A rotacao e feita em torno do centroide dos vertices, entao a bbox da
+        // peca rotacionada pode comecar antes da origem: alinhar a bbox ao canto
+        Point aligned_pos = {min_x - piece->min_x, min_y - piece->min_y};
+        if (piece_fits_in_board(piece, aligned_pos, board)) {
+            *out = aligned_pos;
+            return true;
+        }
+        return false;
+    }
+
+    // Buscar posições de contato com peças existentes. As fontes de contato
+    // saem da grade coluna a coluna, da esquerda para a direita: todo candidato
+    // gerado por uma peca (inclusive deslizado pelo NFP, que para dentro da
+    // bbox do NFP inflada) fica a no maximo reach + distancia a esquerda da
+    // bbox dela, e um candidato valido tem y >= y_floor. Quando nem a borda
+    // esquerda da coluna pode bater (ou empatar com) best_score, as colunas
+    // seguintes tambem nao podem e a varredura para; pecas longe da frente
+    // livre nao sao visitadas.
+    SpatialGrid* grid = &board->grid;
+    double reach = max_double(piece->width, piece->max_x) + input_data.distance_between_pieces;
+    double y_floor = min_y - 2.0 - piece->min_y;     // EPSILON de piece_fits_in_board_excluding
+
+    for (int c = 0; c < grid->cols; c++) {
+        if (c > 0 && found && (c * grid->cell_w - reach) * 3.0 + y_floor * 0.5 > best_score + 1e-6) {
+            break;
+        }
+        for (int r = 0; r < grid->rows; r++) {
+            int cell = r * grid->cols + c;
+            for (int e = grid->cell_head[cell]; e >= 0; e = grid->entry_next[e]) {
+                int i = grid->entry_piece[e];
+                if (grid->first_cell[i] != cell) continue;      // Peca em varias linhas: uma visita
+                int* dead = &grid->dead_shape[i * DEAD_SHAPE_WAYS + (piece->shape_id & (DEAD_SHAPE_WAYS - 1))];
+                if (*dead == piece->shape_id) continue;
+                PlacedPiece* existing = &board->placed_pieces[i];
+
+                double ex_min_x = existing->rotated_piece->min_x + existing->position.x;
+                if (found && (ex_min_x - reach) * 3.0 + y_floor * 0.5 > best_score) continue;
+                double ex_min_y = existing->rotated_piece->min_y + existing->position.y;
+                double ex_max_x = existing->rotated_piece->max_x + existing->position.x;
+                double ex_max_y = existing->rotated_piece->max_y + existing->position.y;
+
+                Point contact_positions[6] = {
+                    {ex_max_x + input_data.distance_between_pieces, ex_min_y},
+                    {ex_max_x + input_data.distance_between_pieces, ex_max_y - piece->height},
+                    {ex_min_x, ex_max_y + input_data.distance_between_pieces},
+                    {ex_max_x - piece->width, ex_max_y + input_data.distance_between_pieces},
+                    {ex_min_x - piece->width - input_data.distance_between_pieces, ex_min_y},
+                    {ex_min_x, ex_min_y - piece->height - input_data.distance_between_pieces}
+                };
+
+                // Direcao de aproximacao de cada contato em relacao a peca existente
+                static const Point approach[6] = {
+                    {-1, 0}, {-1, 0}, {0, -1}, {0, -1}, {1, 0}, {0, 1}
+                };
+
+                Point candidates[12];
+                int candidate_count = 0;
+                for (int j = 0; j < 6; j++) {
+                    candidates[candidate_count++] = contact_positions[j];
+                }
+
+                // NFP: deslizar cada contato ate a posicao exata de toque
+                bool flip;
+                NfpPair* pair = nfp_lookup(existing->rotated_piece->shape_id, piece->shape_id, &flip);
+                if (pair) {
+                    for (int j = 0; j < 6; j++) {
+                        Point q = {contact_positions[j].x - existing->position.x,
+                                   contact_positions[j].y - existing->position.y};
+                        Point u = approach[j];
+                        if (flip) {
+                            q.x = -q.x; q.y = -q.y;
+                            u.x = -u.x; u.y = -u.y;
+                        }
+                        double t = nfp_slide(pair, q, u, input_data.distance_between_pieces);
+                        if (t > NFP_SLIDE_EPSILON) {
+                            t -= NFP_SLIDE_EPSILON;
+                            candidates[candidate_count].x = contact_positions[j].x + t * approach[j].x;
+                            candidates[candidate_count].y = contact_positions[j].y + t * approach[j].y;
+                            candidate_count++;
+                        }
+                    }
+                }
+
+                PROFILE_ADD(PROF_CONTACT_CANDIDATES, candidate_count);
+                bool any_fit = false;
+                for (int j = 0; j < candidate_count; j++) {
+                    Point pos = candidates[j];
+
+                    if (piece_fits_in_board(piece, pos, board)) {
+                        any_fit = true;
+                        // MODIFICADO: Empilhamento esquerda-direita
+                        // Peso alto em X (3.0) prioriza posicionamento à esquerda
+                        // Peso baixo em Y (0.5) permite empilhamento vertical
+                        // Resultado: peças se acumulam à esquerda, deixando espaço livre à direita
+                        // Empate: menor x, depois menor y (independe da ordem de visita)
+                        double score = pos.x * 3.0 + pos.y * 0.5;
+                        if (score < best_score ||
+                            (score == best_score &&
+                             (pos.x < best_pos.x || (pos.x == best_pos.x && pos.y < best_pos.y)))) {
+                            best_score = score;
+                            best_pos = pos;
+                            found = true;
+                        }
+                    }
+                }
+                if (!any_fit) *dead = piece->shape_id;
+            }
+        }
+    }
+
+    // Se não encontrou posição de contato, busca em grid
+    if (!found) {
+        double max_x = board->width - piece->width - input_data.distance_between_boards;
+        double max_y = board->height - piece->height - input_data.distance_between_boards;
+
+        double step = max_double(piece->width, piece->height) * 0.3;
+        if (step < 10.0) step = 10.0;
+        if (step > 40.0) step = 40.0;
+
+        int attempts = 0;
+        const int max_attempts = 1000;
+
+        for (double x = min_x; x <= max_x && attempts < max_attempts; x += step) {
+            for (double y = min_y; y <= max_y && attempts < max_attempts; y += step) {
+                attempts++;
+                PROFILE_COUNT(PROF_GRID_CANDIDATES);
+                Point pos = {x, y};
+
+                if (piece_fits_in_board(piece, pos, board)) {
+                    // MODIFICADO: Empilhamento esquerda-direita (consistente com busca de contato)
+                    // Mesma heurística: prioriza X (esquerda) com peso 2.5, Y com peso 0.5
+                    double score = x * 2.5 + y * 0.5;
+                    if (score < best_score) {
+                        best_score = score;
+                        best_pos = pos;
+                        found = true;
+                    }
+                }
+            }
+        }
+    }
+
+    if (found) *out = best_pos;
+    return found;
+}
+
+bool place_piece_on_board_fast(int piece_id, int rotation_idx, Board* board) {
+    Piece* original_piece = &input_data.pieces[piece_id];
+
+    int angle = original_piece->allowed_angles[rotation_idx];
+    Piece* rotated = get_rotated_piece(piece_id, rotation_idx);
+
+    Point best_pos;
+
+    // CORRIGIDO: NÃO tentar outras rotações! Respeitar o genoma!
+    // Se a rotação sugerida não cabe, falha e tenta nova placa.
+    // Isso força o GA a encontrar boas combinações de sequência + rotação.
+    if (!find_best_position_fast(rotated, board, &best_pos)) {
+        return false;
+    }
+
+    PlacedPiece* placed = &board->placed_pieces[board->piece_count];
+    placed->position = best_pos;
+    placed->angle = angle;
+    placed->piece_id = piece_id;
+    placed->rotated_piece = rotated;
+
+    board->used_area += original_piece->area;
+    grid_insert(board, board->piece_count);
+    board->piece_count++;
+
+    return true;
+}
+
+// ==================== GENETIC ALGORITHM FUNCTIONS ====================
+
+// Gerador baseado em contador: cada fluxo e derivado de (seed, tipo, geracao,
+// individuo) e avancado com SplitMix64. Nenhum estado e compartilhado entre
+// threads, entao o resultado e identico para qualquer OMP_NUM_THREADS, para
+// schedule(dynamic) e para builds seriais.
+
+enum {
+    RNG_STREAM_INIT = 1,         // Populacao inicial
+    RNG_STREAM_RESTART,          // Individuos recriados na estagnacao
+    RNG_STREAM_SELECTION,        // Torneios (pares de pais)
+    RNG_STREAM_REPRODUCTION,     // Crossover + mutacao de um filho
+    RNG_STREAM_BENCH             // Instancias e casos sinteticos (ENABLE_BENCHMARKS)
+};
+
+typedef struct {
+    uint64_t state;
+} Rng;
+
+static uint64_t rng_seed = 0;
+
+static inline uint64_t splitmix64_mix(uint64_t z) {
+    z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ULL;
+    z = (z ^ (z >> 27)) * 0x94D049BB133111EBULL;
+    return z ^ (z >> 31);
+}
+
+static inline uint64_t rng_next(Rng* rng) {
+    rng->state += 0x9E3779B97F4A7C15ULL;
+    return splitmix64_mix(rng->state);
+}
+
+// Fluxo independente para (tipo, geracao, individuo)
+static inline Rng rng_stream(int kind, int generation, int individual) {
+    Rng rng;
+    rng.state = splitmix64_mix(rng_seed ^ splitmix64_mix(((uint64_t)kind << 56) ^
+                                                         ((uint64_t)(unsigned int)generation << 28) ^
+                                                         (uint64_t)(unsigned int)individual));
+    return rng;
+}
+
+// Inteiro uniforme em [0, n) (multiplicacao de 32 bits, sem modulo)
+static inline int rng_int(Rng* rng, int n) {
+    return (int)(((rng_next(rng) >> 32) * (uint64_t)n) >> 32);
+}
+
+// Double uniforme em [0, 1) com 53 bits
+static inline double rng_uniform(Rng* rng) {
+    return (rng_next(rng) >> 11) * (1.0 / 9007199254740992.0);
+}
+
+Genome create_random_genome(Rng* rng) {
+    Genome genome;
+    genome.piece_sequence = malloc(sizeof(int) * input_data.piece_count);
+    genome.rotation_choices = malloc(sizeof(int) * input_data.piece_count);
+    genome.placements = NULL;
+    genome.fitness = 0.0;
+    genome.board_count = 0;
+    genome.total_efficiency = 0.0;
+
+    for (int i = 0; i < input_data.piece_count; i++) {
+        genome.piece_sequence[i] = i;
+    }
+
+    // Fisher-Yates shuffle otimizado - THREAD-SAFE
+    for (int i = input_data.piece_count - 1; i > 0; i--) {
+        int j = rng_int(rng, i + 1);
+        int temp = genome.piece_sequence[i];
+        genome.piece_sequence[i] = genome.piece_sequence[j];
+        genome.piece_sequence[j] = temp;
+    }
+
+    // CORRIGIDO: rotation_choices indexado por piece_id - THREAD-SAFE
+    for (int piece_id = 0; piece_id < input_data.piece_count; piece_id++) {
+        int angle_count = input_data.pieces[piece_id].angle_count;
+        genome.rotation_choices[piece_id] = rng_int(rng, angle_count);
+    }
+
+    return genome;
+}
+
+Genome create_greedy_genome() {
+    Genome genome;
+    genome.piece_sequence = malloc(sizeof(int) * input_data.piece_count);
+    genome.rotation_choices = malloc(sizeof(int) * input_data.piece_count);
+    genome.placements = NULL;
+    genome.fitness = 0.0;
+    genome.board_count = 0;
+    genome.total_efficiency = 0.0;
+
+    typedef struct { int id; double area; } PieceArea;
+    PieceArea* pieces_by_area = malloc(sizeof(PieceArea) * input_data.piece_count);
+
+    for (int i = 0; i < input_data.piece_count; i++) {
+        pieces_by_area[i].id = i;
+        pieces_by_area[i].area = input_data.pieces[i].area;
+    }
+
+    // Quicksort seria melhor, mas mantendo bubble sort por simplicidade
+    for (int i = 0; i < input_data.piece_count - 1; i++) {
+        for (int j = 0; j < input_data.piece_count - i - 1; j++) {
+            if (pieces_by_area[j].area < pieces_by_area[j + 1].area) {
+                PieceArea temp = pieces_by_area[j];
+                pieces_by_area[j] = pieces_by_area[j + 1];
+                pieces_by_area[j + 1] = temp;
+            }
+        }
+    }
+
+    for (int i = 0; i < input_data.piece_count; i++) {
+        genome.piece_sequence[i] = pieces_by_area[i].id;
+    }
+
+    free(pieces_by_area);
+
+    // CORRIGIDO: rotation_choices indexado por piece_id
+    for (int piece_id = 0; piece_id < input_data.piece_count; piece_id++) {
+        genome.rotation_choices[piece_id] = 0;
+    }
+
+    return genome;
+}
+
+// ==================== AVALIACAO INCREMENTAL ====================
+// A colocacao da peca i depende apenas do prefixo (sequencia, rotacoes) ate i.
+// Cada genoma avaliado guarda seu log de colocacoes; antes de avaliar os
+// filhos, os pais sao indexados pelo hash do prefixo em checkpoints a cada
+// PREFIX_CHECKPOINT_INTERVAL posicoes. Um filho procura o maior checkpoint
+// comum, estende a comparacao posicao a posicao, reconstroi as placas a
+// partir do log (sem busca de posicao) e so entao continua a colocacao.
+// O indice e somente leitura durante a avaliacao paralela.
+
+#define PREFIX_CHECKPOINT_INTERVAL 1   // Indice pequeno (pop * pecas); prefixos curtos sao os mais comuns
+
+typedef struct {
+    uint64_t key;                    // Hash do prefixo (0 = vazio)
+    const PlacementRecord* log;      // Log de um genoma com esse prefixo
+} PrefixEntry;
+
+// Indice de prefixos de uma populacao (uma por ilha)
+typedef struct {
+    PrefixEntry* entries;
+    int mask;
+} PrefixIndex;
+
+static long long prefix_placements_reused = 0;
+static long long prefix_placements_total = 0;
+
+static inline uint64_t prefix_hash_step(uint64_t h, int piece_id, int rotation_idx) {
+    h ^= ((uint64_t)(unsigned int)piece_id << 32) | (unsigned int)rotation_idx;
+    h += 0x9E3779B97F4A7C15ULL;
+    h = (h ^ (h >> 30)) * 0xBF58476D1CE4E5B9ULL;
+    h = (h ^ (h >> 27)) * 0x94D049BB133111EBULL;
+    h ^= h >> 31;
+    return h ? h : 1;
+}
+
+static void prefix_index_insert(PrefixIndex* index, uint64_t key, const PlacementRecord* log) {
+    for (int slot = (int)(key & index->mask);; slot = (slot + 1) & index->mask) {
+        if (index->entries[slot].key == key) return;   // Mesmo prefixo, mesmas colocacoes
+        if (index->entries[slot].key == 0) {
+            index->entries[slot].key = key;
+            index->entries[slot].log = log;
+            return;
+        }
+    }
+}
+
+static const PlacementRecord* prefix_index_find(const PrefixIndex* index, uint64_t key) {
+    for (int slot = (int)(key & index->mask);; slot = (slot + 1) & index->mask) {
+        if (index->entries[slot].key == key) return index->entries[slot].log;
+        if (index->entries[slot].key == 0) return NULL;
+    }
+}
+
+// Indexa os checkpoints dos genomas avaliados (chamar antes de avaliar os filhos)
+void prefix_index_build(PrefixIndex* index, Genome* population, int pop_size) {
+    int checkpoints = input_data.piece_count / PREFIX_CHECKPOINT_INTERVAL;
+    int needed = 2 * pop_size * (checkpoints > 0 ? checkpoints : 1);
+    int size = 64;
+    while (size < needed) size <<= 1;
+
+    free(index->entries);
+    index->entries = calloc(size, sizeof(PrefixEntry));
+    index->mask = size - 1;
+
+    for (int g = 0; g < pop_size; g++) {
+        const PlacementRecord* log = population[g].placements;
+        if (!log) continue;
+        uint64_t h = 0;
+        for (int i = 0; i < input_data.piece_count; i++) {
+            h = prefix_hash_step(h, log[i].piece_id, log[i].rotation_idx);
+            if ((i + 1) % PREFIX_CHECKPOINT_INTERVAL == 0) prefix_index_insert(index, h, log);
+        }
+    }
+}
+
+// Invalida o indice (os logs indexados pertencem a populacao que sera liberada)
+void prefix_index_clear(PrefixIndex* index) {
+    free(index->entries);
+    index->entries = NULL;
+    index->mask = 0;
+}
+
+// Maior prefixo do genoma ja avaliado em algum pai; retorna o tamanho e o log
+static int prefix_longest_match(const PrefixIndex* index, const Genome* genome,
+                                const PlacementRecord** source) {
+    *source = NULL;
+    if (!index || !index->entries) return 0;
+
+    int best_len = 0;
+    uint64_t h = 0;
+    for (int i = 0; i < input_data.piece_count; i++) {
+        int piece_id = genome->piece_sequence[i];
+        h = prefix_hash_step(h, piece_id, genome->rotation_choices[piece_id]);
+        if ((i + 1) % PREFIX_CHECKPOINT_INTERVAL != 0) continue;
+
+        const PlacementRecord* log = prefix_index_find(index, h);
+        if (!log) break;   // Prefixos mais longos tambem nao existem
+        *source = log;
+        best_len = i + 1;
+    }
+
+    if (!*source) return 0;
+
+    // Confirmar (colisao de hash) e estender alem do ultimo checkpoint
+    int len = 0;
+    while (len < input_data.piece_count) {
+        int piece_id = genome->piece_sequence[len];
+        if ((*source)[len].piece_id != piece_id ||
+            (*source)[len].rotation_idx != genome->rotation_choices[piece_id]) break;
+        len++;
+    }
+    if (len < best_len) {
+        *source = NULL;
+        return 0;
+    }
+    return len;
+}
+
+// ==================== CACHE DE FITNESS ====================
+// Genomas identicos (copias da elite, filhos iguais a um pai, mutacoes nulas)
+// sao avaliados uma unica vez. Tabela associativa por conjuntos de
+// FITNESS_CACHE_WAYS entradas, com substituicao clock (bit de referencia)
+// dentro de cada conjunto e um lock por conjunto.
+
+#define FITNESS_CACHE_SETS 8192     // Potencia de 2
+#define FITNESS_CACHE_WAYS 8
+
+typedef struct {
+    uint64_t key;           // Hash do genoma (0 = vazio)
+    double fitness;
+    double total_efficiency;
+    int board_count;
+    int referenced;         // Bit do algoritmo clock
+} FitnessCacheEntry;
+
+typedef struct {
+    FitnessCacheEntry ways[FITNESS_CACHE_WAYS];
+    int hand;               // Ponteiro do clock
+    #ifdef _OPENMP
+        omp_lock_t lock;
+    #endif
+} FitnessCacheSet;
+
+static FitnessCacheSet* fitness_cache = NULL;
+static long long fitness_cache_hits = 0;
+static long long fitness_cache_misses = 0;
+
+void fitness_cache_init() {
+    fitness_cache = calloc(FITNESS_CACHE_SETS, sizeof(FitnessCacheSet));
+    #ifdef _OPENMP
+        for (int i = 0; i < FITNESS_CACHE_SETS; i++) omp_init_lock(&fitness_cache[i].lock);
+    #endif
+}
+
+void fitness_cache_free() {
+    if (!fitness_cache) return;
+    #ifdef _OPENMP
+        for (int i = 0; i < FITNESS_CACHE_SETS; i++) omp_destroy_lock(&fitness_cache[i].lock);
+    #endif
+    free(fitness_cache);
+    fitness_cache = NULL;
+}
+
+// Hash de 64 bits de piece_sequence + rotation_choices
+static uint64_t genome_hash(const Genome* genome) {
+    uint64_t h = 0;
+    for (int i = 0; i < input_data.piece_count; i++) {
+        h = prefix_hash_step(h, genome->piece_sequence[i], genome->rotation_choices[i]);
+    }
+    return h;
+}
+
+static bool fitness_cache_lookup(uint64_t key, Genome* genome) {
+    FitnessCacheSet* set = &fitness_cache[key & (FITNESS_CACHE_SETS - 1)];
+    bool hit = false;
+
+    #ifdef _OPENMP
+        omp_set_lock(&set->lock);
+    #endif
+    for (int w = 0; w < FITNESS_CACHE_WAYS; w++) {
+        FitnessCacheEntry* entry = &set->ways[w];
+        if (entry->key == key) {
+            genome->fitness = entry->fitness;
+            genome->board_count = entry->board_count;
+            genome->total_efficiency = entry->total_efficiency;
+            entry->referenced = 1;
+            hit = true;
+            break;
+        }
+    }
+    #ifdef _OPENMP
+        omp_unset_lock(&set->lock);
+    #endif
+
+    long long* counter = hit ? &fitness_cache_hits : &fitness_cache_misses;
+    #ifdef _OPENMP
+        #pragma omp atomic
+    #endif
+    (*counter)++;
+
+    return hit;
+}
+
+static void fitness_cache_store(uint64_t key, const Genome* genome) {
+    FitnessCacheSet* set = &fitness_cache[key & (FITNESS_CACHE_SETS - 1)];
+
+    #ifdef _OPENMP
+        omp_set_lock(&set->lock);
+    #endif
+    int victim = -1;
+    for (int w = 0; w < FITNESS_CACHE_WAYS; w++) {
+        if (set->ways[w].key == key) {
+            victim = w;     // Outra thread ja inseriu o mesmo genoma
+            break;
+        }
+    }
+    while (victim < 0) {
+        FitnessCacheEntry* entry = &set->ways[set->hand];
+        if (entry->key == 0 || !entry->referenced) {
+            victim = set->hand;
+        } else {
+            entry->referenced = 0;
+        }
+        set->hand = (set->hand + 1) % FITNESS_CACHE_WAYS;
+    }
+    FitnessCacheEntry* entry = &set->ways[victim];
+    entry->key = key;
+    entry->fitness = genome->fitness;
+    entry->total_efficiency = genome->total_efficiency;
+    entry->board_count = genome->board_count;
+    entry->referenced = 1;
+    #ifdef _OPENMP
+        omp_unset_lock(&set->lock);
+    #endif
+}
+
+// Instancias do mesmo tipo sao intercambiaveis: a k-esima ocorrencia do tipo t
+// na sequencia passa a ser a instancia type_first[t] + k, levando consigo a
+// rotacao escolhida. Permutacoes equivalentes viram o mesmo genoma e caem no
+// cache de fitness e no indice de prefixos em vez de serem reavaliadas.
+static void genome_canonicalize(Genome* genome, Arena* arena) {
+    if (input_data.type_count == input_data.piece_count) return;
+    int* next_instance = arena_alloc(arena, sizeof(int) * input_data.type_count);
+    int* rotations = arena_alloc(arena, sizeof(int) * input_data.piece_count);
+    memcpy(next_instance, input_data.type_first, sizeof(int) * input_data.type_count);
+    memcpy(rotations, genome->rotation_choices, sizeof(int) * input_data.piece_count);
+    for (int i = 0; i < input_data.piece_count; i++) {
+        int piece_id = genome->piece_sequence[i];
+        int instance = next_instance[input_data.pieces[piece_id].type_id]++;
+        genome->piece_sequence[i] = instance;
+        genome->rotation_choices[instance] = rotations[piece_id];
+    }
+}
+
+// Avalia o genoma; 'prefix' (pode ser NULL) indexa os pais ja avaliados
+void evaluate_genome(Genome* genome, const PrefixIndex* prefix) {
+    // Thread-safe: cada thread usa sua própria estrutura Result local,
+    // alocada na arena da thread (reiniciada a cada genoma)
+    Arena* arena = get_thread_arena();
+    arena_reset(arena);
+    genome_canonicalize(genome, arena);
+
+    // Genoma ja avaliado antes: nenhuma colocacao necessaria
+    uint64_t cache_key = genome_hash(genome);
+    if (fitness_cache_lookup(cache_key, genome)) return;
+    arena_reset(arena);
+
+    Result local_result;
+    local_result.boards = arena_alloc(arena, sizeof(Board) * input_data.piece_count);
+    local_result.board_count = 0;
+
+    bool* placed = arena_calloc(arena, input_data.piece_count, sizeof(bool));
+    int placed_count = 0;
+
+    if (!genome->placements) {
+        genome->placements = malloc(sizeof(PlacementRecord) * input_data.piece_count);
+    }
+    PlacementRecord* log = genome->placements;
+
+    // Retomar do maior prefixo ja avaliado: reinserir as colocacoes do log
+    const PlacementRecord* source;
+    int resume_len = prefix_longest_match(prefix, genome, &source);
+    if (resume_len > 0 && source != log) {
+        memcpy(log, source, sizeof(PlacementRecord) * resume_len);
+    }
+    for (int seq_idx = 0; seq_idx < resume_len; seq_idx++) {
+        const PlacementRecord* rec = &log[seq_idx];
+        if (rec->board_idx < 0) continue;
+        if (rec->board_idx == local_result.board_count) {
+            board_init(&local_result.boards[local_result.board_count++], arena);
+        }
+        Board* board = &local_result.boards[rec->board_idx];
+        PlacedPiece* placed_piece = &board->placed_pieces[board->piece_count];
+        placed_piece->position = rec->position;
+        placed_piece->angle = input_data.pieces[rec->piece_id].allowed_angles[rec->rotation_idx];
+        placed_piece->piece_id = rec->piece_id;
+        placed_piece->rotated_piece = get_rotated_piece(rec->piece_id, rec->rotation_idx);
+        board->used_area += input_data.pieces[rec->piece_id].area;
+        grid_insert(board, board->piece_count);
+        board->piece_count++;
+        placed[rec->piece_id] = true;
+        placed_count++;
+    }
+
+    for (int seq_idx = resume_len; seq_idx < input_data.piece_count; seq_idx++) {
+        int piece_id = genome->piece_sequence[seq_idx];
+        int rotation_idx = genome->rotation_choices[piece_id];  // CORRIGIDO: usar piece_id como índice!
+
+        log[seq_idx].piece_id = piece_id;
+        log[seq_idx].rotation_idx = rotation_idx;
+        log[seq_idx].board_idx = -1;
+
+        if (placed[piece_id]) continue;
+
+        bool piece_placed = false;
+
+        for (int board_idx = 0; board_idx < local_result.board_count; board_idx++) {
+            if (place_piece_on_board_fast(piece_id, rotation_idx, &local_result.boards[board_idx])) {
+                placed[piece_id] = true;
+                placed_count++;
+                piece_placed = true;
+                log[seq_idx].board_idx = board_idx;
+                break;
+            }
+        }
+
+        if (!piece_placed && local_result.board_count < input_data.piece_count) {
+            Board* new_board = &local_result.boards[local_result.board_count];
+            board_init(new_board, arena);
+
+            if (place_piece_on_board_fast(piece_id, rotation_idx, new_board)) {
+                placed[piece_id] = true;
+                placed_count++;
+                piece_placed = true;
+                log[seq_idx].board_idx = local_result.board_count;
+                local_result.board_count++;
+            }
+        }
+
+        if (piece_placed) {
+            Board* board = &local_result.boards[log[seq_idx].board_idx];
+            log[seq_idx].position = board->placed_pieces[board->piece_count - 1].position;
+        }
+    }
+
+    #ifdef _OPENMP
+        #pragma omp atomic
+    #endif
+    prefix_placements_reused += resume_len;
+    #ifdef _OPENMP
+        #pragma omp atomic
+    #endif
+    prefix_placements_total += input_data.piece_count;
+
+    double total_used_area = 0;
+    for (int i = 0; i < local_result.board_count; i++) {
+        double board_area = local_result.boards[i].width * local_result.boards[i].height;
+        local_result.boards[i].efficiency = (local_result.boards[i].used_area / board_area) * 100.0;
+        total_used_area += local_result.boards[i].used_area;
+    }
+
+    double total_board_area = local_result.board_count * input_data.board_x * input_data.board_y;
+    local_result.total_efficiency = total_board_area > 0 ? (total_used_area / total_board_area) * 100.0 : 0.0;
+
+    genome->fitness = local_result.total_efficiency * 2.0 - local_result.board_count * 5.0;
+    genome->board_count = local_result.board_count;
+    genome->total_efficiency = local_result.total_efficiency;
+
+    if (placed_count < input_data.piece_count) {
+        genome->fitness -= (input_data.piece_count - placed_count) * 1000.0;
+
+        // Apenas a primeira thread a chegar aqui registra o aviso (sem secao critica)
+        static int unplaced_logged = 0;
+        int already_logged = 1;
+        if (log_level >= LOG_LEVEL_SUMMARY) {
+            #ifdef _OPENMP
+                #pragma omp atomic capture
+            #endif
+            { already_logged = unplaced_logged; unplaced_logged = 1; }
+        }
+
+        if (!already_logged) {
+            // Mensagem montada antes: uma unica entrada no buffer de log da thread
+            size_t size = 64 + (size_t)input_data.piece_count * 12;
+            char* message = arena_alloc(arena, size);
+            int len = snprintf(message, size, "\n[AVISO] Pecas nao colocadas: ");
+            for (int i = 0; i < input_data.piece_count; i++) {
+                if (!placed[i]) {
+                    len += snprintf(message + len, size - len, "%d ", i);
+                }
+            }
+            snprintf(message + len, size - len, "(total: %d)\n\n", input_data.piece_count - placed_count);
+            log_message("%s", message);
+        }
+    }
+
+    fitness_cache_store(cache_key, genome);
+
+    // Resultado local vive na arena: liberado no proximo arena_reset
+}
+
+int tournament_selection(Genome* population, int pop_size, Rng* rng) {
+    int best_idx = rng_int(rng, pop_size);
+    double best_fitness = population[best_idx].fitness;
+
+    for (int i = 1; i < tournament_size; i++) {
+        int candidate_idx = rng_int(rng, pop_size);
+        if (population[candidate_idx].fitness > best_fitness) {
+            best_idx = candidate_idx;
+            best_fitness = population[candidate_idx].fitness;
+        }
+    }
+
+    return best_idx;
+}
+
+Genome order_crossover(Genome* parent1, Genome* parent2, Rng* rng) {
+    Genome child;
+    child.piece_sequence = malloc(sizeof(int) * input_data.piece_count);
+    child.rotation_choices = malloc(sizeof(int) * input_data.piece_count);
+    child.placements = NULL;
+    child.fitness = 0.0;
+    child.board_count = 0;
+    child.total_efficiency = 0.0;
+
+    for (int i = 0; i < input_data.piece_count; i++) {
+        child.piece_sequence[i] = -1;
+    }
+
+    int cut1 = rng_int(rng, input_data.piece_count);
+    int cut2 = rng_int(rng, input_data.piece_count);
+    if (cut1 > cut2) {
+        int temp = cut1;
+        cut1 = cut2;
+        cut2 = temp;
+    }
+
+    for (int i = cut1; i <= cut2; i++) {
+        child.piece_sequence[i] = parent1->piece_sequence[i];
+    }
+
+    int child_idx = (cut2 + 1) % input_data.piece_count;
+    for (int parent2_idx = 0; parent2_idx < input_data.piece_count; parent2_idx++) {
+        int gene = parent2->piece_sequence[(cut2 + 1 + parent2_idx) % input_data.piece_count];
+
+        bool already_in = false;
+        for (int i = cut1; i <= cut2; i++) {
+            if (child.piece_sequence[i] == gene) {
+                already_in = true;
+                break;
+            }
+        }
+
+        if (!already_in) {
+            child.piece_sequence[child_idx] = gene;
+            child_idx = (child_idx + 1) % input_data.piece_count;
+        }
+    }
+
+    // CORRIGIDO: rotation_choices é indexado por piece_id, então herda diretamente dos pais - THREAD-SAFE
+    for (int piece_id = 0; piece_id < input_data.piece_count; piece_id++) {
+        if (rng_int(rng, 2) == 0) {
+            child.rotation_choices[piece_id] = parent1->rotation_choices[piece_id];
+        } else {
+            child.rotation_choices[piece_id] = parent2->rotation_choices[piece_id];
+        }
+    }
+
+    return child;
+}
+
+void mutate_genome(Genome* genome, Rng* rng) {
+    // OTIMIZADO: Mutação MUITO mais agressiva para exploração profunda - THREAD-SAFE
+    // Swap mutation: AUMENTADO para 4-8 swaps (era 2-4)
+    int num_swaps = 4 + rng_int(rng, 5);  // 4-8 swaps
+    for (int m = 0; m < num_swaps; m++) {
+        if (rng_uniform(rng) < mutation_rate) {
+            int pos1 = rng_int(rng, input_data.piece_count);
+            int pos2 = rng_int(rng, input_data.piece_count);
+
+            int temp = genome->piece_sequence[pos1];
+            genome->piece_sequence[pos1] = genome->piece_sequence[pos2];
+            genome->piece_sequence[pos2] = temp;
+        }
+    }
+
+    // Rotation mutation: AUMENTADO para 6-10 rotações (era 3-6)
+    int num_rotations = 6 + rng_int(rng, 5);  // 6-10 rotações
+    for (int m = 0; m < num_rotations; m++) {
+        if (rng_uniform(rng) < mutation_rate) {
+            int piece_id = rng_int(rng, input_data.piece_count);
+            int angle_count = input_data.pieces[piece_id].angle_count;
+            if (angle_count > 1) {
+                genome->rotation_choices[piece_id] = rng_int(rng, angle_count);
+            }
+        }
+    }
+
+    // NOVO: Block swap mutation - troca blocos inteiros de peças (20% de chance)
+    if (rng_uniform(rng) < 0.2) {
+        int block_size = 2 + rng_int(rng, 4);  // blocos de 2-5 peças
+        int pos1 = rng_int(rng, input_data.piece_count - block_size);
+        int pos2 = rng_int(rng, input_data.piece_count - block_size);
+
+        for (int i = 0; i < block_size; i++) {
+            int temp = genome->piece_sequence[pos1 + i];
+            genome->piece_sequence[pos1 + i] = genome->piece_sequence[pos2 + i];
+            genome->piece_sequence[pos2 + i] = temp;
+        }
+    }
+}
+
+Genome copy_genome(Genome* source) {
+    Genome copy;
+    copy.piece_sequence = malloc(sizeof(int) * input_data.piece_count);
+    copy.rotation_choices = malloc(sizeof(int) * input_data.piece_count);
+
+    memcpy(copy.piece_sequence, source->piece_sequence, sizeof(int) * input_data.piece_count);
+    memcpy(copy.rotation_choices, source->rotation_choices, sizeof(int) * input_data.piece_count);
+
+    copy.placements = NULL;
+    if (source->placements) {
+        copy.placements = malloc(sizeof(PlacementRecord) * input_data.piece_count);
+        memcpy(copy.placements, source->placements, sizeof(PlacementRecord) * input_data.piece_count);
+    }
+
+    copy.fitness = source->fitness;
+    copy.board_count = source->board_count;
+    copy.total_efficiency = source->total_efficiency;
+
+    return copy;
+}
+
+void free_genome(Genome* genome) {
+    free(genome->piece_sequence);
+    free(genome->rotation_choices);
+    free(genome->placements);
+}
+
+// Avalia um genoma e salva o resultado na estrutura global 'result'
+void evaluate_genome_to_global(Genome* genome) {
+    arena_reset(&result_arena);
+
+    result.boards = arena_alloc(&result_arena, sizeof(Board) * input_data.piece_count);
+    result.board_count = 0;
+
+    bool* placed = arena_calloc(&result_arena, input_data.piece_count, sizeof(bool));
+    int placed_count = 0;
+
+    for (int seq_idx = 0; seq_idx < input_data.piece_count; seq_idx++) {
+        int piece_id = genome->piece_sequence[seq_idx];
+        int rotation_idx = genome->rotation_choices[piece_id];
+
+        if (placed[piece_id]) continue;
+
+        bool piece_placed = false;
+
+        for (int board_idx = 0; board_idx < result.board_count; board_idx++) {
+            if (place_piece_on_board_fast(piece_id, rotation_idx, &result.boards[board_idx])) {
+                placed[piece_id] = true;
+                placed_count++;
+                piece_placed = true;
+                break;
+            }
+        }
+
+        if (!piece_placed && result.board_count < input_data.piece_count) {
+            Board* new_board = &result.boards[result.board_count];
+            board_init(new_board, &result_arena);
+
+            if (place_piece_on_board_fast(piece_id, rotation_idx, new_board)) {
+                placed[piece_id] = true;
+                placed_count++;
+                piece_placed = true;
+                result.board_count++;
+            }
+        }
+    }
+
+    double total_used_area = 0;
+    for (int i = 0; i < result.board_count; i++) {
+        double board_area = result.boards[i].width * result.boards[i].height;
+        result.boards[i].efficiency = (result.boards[i].used_area / board_area) * 100.0;
+        total_used_area += result.boards[i].used_area;
+    }
+
+    double total_board_area = result.board_count * input_data.board_x * input_data.board_y;
+    result.total_efficiency = total_board_area > 0 ? (total_used_area / total_board_area) * 100.0 : 0.0;
+
+    genome->fitness = result.total_efficiency * 2.0 - result.board_count * 5.0;
+    genome->board_count = result.board_count;
+    genome->total_efficiency = result.total_efficiency;
+}
+
+void save_best_result() {
+    arena_reset(&best_result_arena);
+
+    best_result.board_count = result.board_count;
+    best_result.total_efficiency = result.total_efficiency;
+    best_result.boards = arena_alloc(&best_result_arena, sizeof(Board) * result.board_count);
+
+    for (int i = 0; i < result.board_count; i++) {
+        Board* board = &best_result.boards[i];
+        board_init(board, &best_result_arena);
+        board->width = result.boards[i].width;
+        board->height = result.boards[i].height;
+        board->used_area = result.boards[i].used_area;
+        board->efficiency = result.boards[i].efficiency;
+        board->piece_count = result.boards[i].piece_count;
+
+        // Geometria e compartilhada via tabela de rotacoes: copia rasa basta
+        memcpy(board->placed_pieces, result.boards[i].placed_pieces,
+               sizeof(PlacedPiece) * result.boards[i].piece_count);
+        grid_rebuild(board);
+    }
+}
+
+// ==================== ORCAMENTO DE TEMPO ====================
+// --time-limit S encerra a evolucao S segundos (relogio monotonico de parede)
+// apos o inicio; --stall-seconds S encerra se o melhor global nao melhora ha
+// S segundos. Cada melhoria do melhor global e gravada imediatamente no
+// arquivo de resultado (escrita atomica), entao sempre ha uma resposta em disco.
+
+static double run_start_time = 0.0;
+static double time_limit_seconds = 0.0;      // 0 = sem limite
+static double stall_limit_seconds = 0.0;     // 0 = desativado
+static double last_improvement_time = 0.0;
+
+typedef enum {
+    STOP_NONE,          // Todas as geracoes executadas
+    STOP_TIME_LIMIT,
+    STOP_STALL
+} StopReason;
+
+static int evolution_stop_reason = STOP_NONE;   // Gravado no ponto de parada
+static char result_path[256] = "genetic_nesting_optimized_result.json";
+
+bool write_result(const char* filename);
+
+// Fluxo de progresso (--progress-json ARQUIVO, "-" = stdout) para monitoramento:
+// um objeto JSON por linha com "event" e "t" (segundos desde o inicio). Eventos:
+// start, generation (por ilha), improvement, concave e end. Cada linha e montada
+// antes e gravada numa unica escrita; no maximo uma por geracao e ilha.
+static char progress_json_path[256] = "";
+static FILE* progress_file = NULL;
+
+static bool progress_open() {
+    if (progress_json_path[0] == '\0') return true;
+    if (strcmp(progress_json_path, "-") == 0) {
+        progress_file = stdout;
+        return true;
+    }
+    progress_file = fopen(progress_json_path, "w");
+    if (!progress_file) {
+        printf("ERRO: Nao foi possivel criar %s: %s\n", progress_json_path, strerror(errno));
+        return false;
+    }
+    return true;
+}
+
+static void progress_close() {
+    if (progress_file && progress_file != stdout) fclose(progress_file);
+    progress_file = NULL;
+}
+
+// 'fields' continua o objeto: pares "chave": valor separados por virgula
+static void progress_event(const char* event, const char* fields, ...) {
+    if (!progress_file) return;
+    char line[512];
+    int len = snprintf(line, sizeof(line), "{\"event\": \"%s\", \"t\": %.3f, ",
+                       event, wall_time() - run_start_time);
+    va_list args;
+    va_start(args, fields);
+    len += vsnprintf(line + len, sizeof(line) - len, fields, args);
+    va_end(args);
+    if (len > (int)sizeof(line) - 3) len = (int)sizeof(line) - 3;
+    memcpy(line + len, "}\n", 3);
+    fputs(line, progress_file);
+    fflush(progress_file);
+}
+
+// Motivo de parada agora (STOP_NONE = continuar)
+static StopReason evolution_should_stop() {
+    double now = wall_time();
+    if (time_limit_seconds > 0 && now - run_start_time >= time_limit_seconds) return STOP_TIME_LIMIT;
+    if (stall_limit_seconds > 0) {
+        double last;
+        #ifdef _OPENMP
+            #pragma omp atomic read
+        #endif
+        last = last_improvement_time;
+        if (now - last >= stall_limit_seconds) return STOP_STALL;
+    }
+    return STOP_NONE;
+}
+
+// Chamar no ponto em que a evolucao e interrompida; true se deve parar
+static bool evolution_check_stop() {
+    StopReason reason = evolution_should_stop();
+    if (reason == STOP_NONE) return false;
+    #ifdef _OPENMP
+        #pragma omp atomic write
+    #endif
+    evolution_stop_reason = reason;
+    return true;
+}
+
+// Chamar apos save_best_result (dentro de critical(best_result) quando em paralelo)
+static void best_result_improved() {
+    double now = wall_time();
+    #ifdef _OPENMP
+        #pragma omp atomic write
+    #endif
+    last_improvement_time = now;
+
+    best_result.execution_time = now - run_start_time;
+    write_result(result_path);
+    progress_event("improvement", "\"boards\": %d, \"efficiency\": %.4f",
+                   best_result.board_count, best_result.total_efficiency);
+}
+
+#if ENABLE_BENCHMARKS
+// ==================== BENCHMARKS ====================
+// Compilado apenas com -DENABLE_BENCHMARKS=1 (make bench). Tres partes:
+//   --bench-generate ARQ   gera uma instancia sintetica (retangulos, L e C)
+//   --bench-micro ARQ      microbenchmarks dos kernels sobre --input (CSV)
+//   --bench-csv ARQ        CSV de progresso da execucao normal (fim a fim)
+
+#define BENCH_MICRO_MIN_SECONDS 0.5   // Tempo minimo medido por microbenchmark
+#define BENCH_CASES 1024              // Casos pre-sorteados por kernel
+
+static char bench_generate_path[256] = "";
+static char bench_micro_path[256] = "";
+static char bench_csv_path[256] = "";
+static int bench_pieces = 100;
+static int bench_vertices = 16;
+static const char* bench_shapes = "mix";   // mix | rect | l | c
+static FILE* bench_csv_file = NULL;
+
+// Contorno base (anti-horario) de uma peca w x h; 'kind' 0 = retangulo, 1 = L, 2 = C
+static int bench_base_shape(int kind, double w, double h, Point* out) {
+    double t = 0.35 * min_double(w, h);
+    if (kind == 1) {
+        Point l[6] = {{0, 0}, {w, 0}, {w, t}, {t, t}, {t, h}, {0, h}};
+        memcpy(out, l, sizeof(l));
+        return 6;
+    }
+    if (kind == 2) {
+        t = 0.3 * min_double(w, h);
+        Point c[8] = {{0, 0}, {w, 0}, {w, t}, {t, t}, {t, h - t}, {w, h - t}, {w, h}, {0, h}};
+        memcpy(out, c, sizeof(c));
+        return 8;
+    }
+    Point r[4] = {{0, 0}, {w, 0}, {w, h}, {0, h}};
+    memcpy(out, r, sizeof(r));
+    return 4;
+}
+
+// Escreve o contorno com exatamente 'vertices' pontos: os extras sao distribuidos
+// pelas arestas (proporcional ao comprimento) com um leve abaulamento para fora,
+// para que nao sejam colineares nem criem auto-intersecao
+static void bench_write_piece(FILE* file, const Point* base, int base_count, int vertices) {
+    double perimeter = 0;
+    for (int i = 0; i < base_count; i++) {
+        perimeter += calculate_distance(base[i], base[(i + 1) % base_count]);
+    }
+
+    int extra_total = vertices - base_count;
+    int assigned = 0;
+    double walked = 0;
+    bool first = true;
+    fprintf(file, "[");
+    for (int i = 0; i < base_count; i++) {
+        Point a = base[i], b = base[(i + 1) % base_count];
+        double len = calculate_distance(a, b);
+        walked += len;
+        int upto = i == base_count - 1 ? extra_total : (int)(extra_total * walked / perimeter);
+        int extra = upto - assigned;
+        assigned = upto;
+
+        fprintf(file, "%s[%.3f, %.3f]", first ? "" : ", ", a.x, a.y);
+        first = false;
+        double nx = (b.y - a.y) / len, ny = -(b.x - a.x) / len;   // Normal externa (anti-horario)
+        double amplitude = 0.02 * len;
+        for (int k = 1; k <= extra; k++) {
+            double s = (double)k / (extra + 1);
+            double bulge = amplitude * sin(PI * s);
+            fprintf(file, ", [%.3f, %.3f]", a.x + (b.x - a.x) * s + nx * bulge, a.y + (b.y - a.y) * s + ny * bulge);
+        }
+    }
+    fprintf(file, "]");
+}
+
+static bool bench_generate_instance(const char* filename) {
+    FILE* file = fopen(filename, "wb");
+    if (!file) {
+        printf("ERRO: Nao foi possivel criar %s: %s\n", filename, strerror(errno));
+        return false;
+    }
+
+    const double board_x = 2438.6, board_y = 1117.5;
+    fprintf(file, "{\n  \"board_x\": %.1f,\n  \"board_y\": %.1f,\n", board_x, board_y);
+    fprintf(file, "  \"distance_between_boards\": 30,\n  \"distance_between_peaces\": 20,\n");
+    fprintf(file, "  \"peaces\": [\n");
+
+    Rng rng = rng_stream(RNG_STREAM_BENCH, 0, 0);
+    Point base[8];
+    for (int i = 0; i < bench_pieces; i++) {
+        int kind;
+        if (strcmp(bench_shapes, "rect") == 0) kind = 0;
+        else if (strcmp(bench_shapes, "l") == 0) kind = 1;
+        else if (strcmp(bench_shapes, "c") == 0) kind = 2;
+        else kind = rng_int(&rng, 3);
+
+        double w = 80.0 + rng_uniform(&rng) * 420.0;
+        double h = 80.0 + rng_uniform(&rng) * 320.0;
+        int base_count = bench_base_shape(kind, w, h, base);
+        if (base_count > bench_vertices) base_count = bench_base_shape(0, w, h, base);
+
+        fprintf(file, "    {\"angle\": [0, 180], \"data\": ");
+        bench_write_piece(file, base, base_count, bench_vertices);
+        fprintf(file, "}%s\n", i == bench_pieces - 1 ? "" : ",");
+    }
+    fprintf(file, "  ]\n}\n");
+
+    bool ok = ferror(file) == 0;
+    if (fclose(file) != 0) ok = false;
+    if (ok) printf("Instancia sintetica: %d pecas x %d vertices (%s) -> %s\n",
+                   bench_pieces, bench_vertices, bench_shapes, filename);
+    return ok;
+}
+
+// Mede 'body' repetindo em lotes ate BENCH_MICRO_MIN_SECONDS; grava uma linha CSV
+#define BENCH_RUN(file, name, body)                                               \
+    do {                                                                          \
+        long long iterations = 0, batch = 1;                                      \
+        double begin = wall_time(), elapsed = 0;                                  \
+        while (elapsed < BENCH_MICRO_MIN_SECONDS) {                               \
+            for (long long it = 0; it < batch; it++, iterations++) { body; }      \
+            elapsed = wall_time() - begin;                                        \
+            batch *= 2;                                                           \
+        }                                                                         \
+        fprintf(file, "%s,%d,%s,%lld,%.6f,%.1f\n", input_path, input_data.piece_count, \
+                name, iterations, elapsed, elapsed * 1e9 / iterations);           \
+        printf("  %-26s %12.1f ns/op (%lld iteracoes)\n", name,                   \
+               elapsed * 1e9 / iterations, iterations);                           \
+    } while (0)
+
+static bool bench_run_micro(const char* filename) {
+    FILE* probe = fopen(filename, "rb");
+    bool write_header = true;
+    if (probe) {
+        write_header = fgetc(probe) == EOF;
+        fclose(probe);
+    }
+    FILE* file = fopen(filename, "ab");
+    if (!file) {
+        printf("ERRO: Nao foi possivel abrir %s: %s\n", filename, strerror(errno));
+        return false;
+    }
+    if (write_header) fprintf(file, "instance,pieces,benchmark,iterations,total_s,ns_per_op\n");
+
+    printf("Microbenchmarks (%s, %d pecas):\n", input_path, input_data.piece_count);
+    Rng rng = rng_stream(RNG_STREAM_BENCH, 1, 0);
+    volatile long long sink = 0;
+
+    // Pares de pecas rotacionadas com bboxes proximas (mistura de colisoes e folgas)
+    typedef struct { Piece* a; Piece* b; Point pa, pb; } CollideCase;
+    typedef struct { Piece* piece; Point point; } PointCase;
+    CollideCase* pairs = malloc(sizeof(CollideCase) * BENCH_CASES);
+    PointCase* points = malloc(sizeof(PointCase) * BENCH_CASES);
+    for (int i = 0; i < BENCH_CASES; i++) {
+        int ia = rng_int(&rng, input_data.piece_count), ib = rng_int(&rng, input_data.piece_count);
+        Piece* a = get_rotated_piece(ia, rng_int(&rng, input_data.pieces[ia].angle_count));
+        Piece* b = get_rotated_piece(ib, rng_int(&rng, input_data.pieces[ib].angle_count));
+        pairs[i].a = a;
+        pairs[i].b = b;
+        pairs[i].pa = (Point){0, 0};
+        pairs[i].pb = (Point){(rng_uniform(&rng) - 0.5) * 1.5 * (a->width + b->width),
+                              (rng_uniform(&rng) - 0.5) * 1.5 * (a->height + b->height)};
+
+        points[i].piece = a;
+        points[i].point = (Point){a->min_x + rng_uniform(&rng) * a->width,
+                                  a->min_y + rng_uniform(&rng) * a->height};
+    }
+
+    BENCH_RUN(file, "polygons_collide", {
+        CollideCase* c = &pairs[it & (BENCH_CASES - 1)];
+        sink += polygons_collide(c->a, c->pa, c->b, c->pb, input_data.distance_between_pieces);
+    });
+    BENCH_RUN(file, "point_in_polygon_soa", {
+        PointCase* c = &points[it & (BENCH_CASES - 1)];
+        sink += point_in_polygon_soa(&c->piece->soa, c->point.x, c->point.y);
+    });
+
+    // Busca de posicao sobre a primeira placa da solucao gulosa
+    Genome greedy = create_greedy_genome();
+    evaluate_genome_to_global(&greedy);
+    Board* board = &result.boards[0];
+    BENCH_RUN(file, "find_best_position_fast", {
+        int id = (int)(it % input_data.piece_count);
+        Point position;
+        sink += find_best_position_fast(get_rotated_piece(id, 0), board, &position);
+    });
+    free_genome(&greedy);
+
+    // Genomas novos a cada iteracao: a cache de fitness nunca acerta
+    BENCH_RUN(file, "evaluate_genome", {
+        Rng genome_rng = rng_stream(RNG_STREAM_BENCH, 2, (int)it);
+        Genome genome = create_random_genome(&genome_rng);
+        evaluate_genome(&genome, NULL);
+        sink += genome.board_count;
+        free_genome(&genome);
+    });
+
+    (void)sink;
+    free(pairs);
+    free(points);
+    bool ok = ferror(file) == 0;
+    if (fclose(file) != 0) ok = false;
+    return ok;
+}
+
+// Progresso fim a fim: uma linha por geracao
+static void bench_csv_write_row(long long generation) {
+    if (!bench_csv_file) {
+        bench_csv_file = fopen(bench_csv_path, "wb");
+        if (!bench_csv_file) {
+            printf("ERRO: Nao foi possivel criar %s: %s\n", bench_csv_path, strerror(errno));
+            bench_csv_path[0] = '\0';
+            return;
+        }
+        fprintf(bench_csv_file, "elapsed_s,generation,genomes,genomes_per_s,placements,placements_per_s,"
+                                "best_boards,best_efficiency\n");
+    }
+
+    long long hits, misses, total, reused;
+    #ifdef _OPENMP
+        #pragma omp atomic read
+    #endif
+    hits = fitness_cache_hits;
+    #ifdef _OPENMP
+        #pragma omp atomic read
+    #endif
+    misses = fitness_cache_misses;
+    #ifdef _OPENMP
+        #pragma omp atomic read
+    #endif
+    total = prefix_placements_total;
+    #ifdef _OPENMP
+        #pragma omp atomic read
+    #endif
+    reused = prefix_placements_reused;
+
+    double elapsed = wall_time() - run_start_time;
+    long long genomes = hits + misses;
+    long long placements = total - reused;   // Colocacoes de fato calculadas
+    fprintf(bench_csv_file, "%.3f,%lld,%lld,%.1f,%lld,%.1f,%d,%.4f\n",
+            elapsed, generation, genomes, elapsed > 0 ? genomes / elapsed : 0.0,
+            placements, elapsed > 0 ? placements / elapsed : 0.0,
+            best_result.board_count, best_result.total_efficiency);
+    fflush(bench_csv_file);
+}
+
+static void bench_csv_row(long long generation) {
+    if (!bench_csv_path[0]) return;
+    #ifdef _OPENMP
+        #pragma omp critical(best_result)
+    #endif
+    bench_csv_write_row(generation);
+}
+
+static void bench_csv_close() {
+    if (bench_csv_file) fclose(bench_csv_file);
+    bench_csv_file = NULL;
+}
+
+#endif // ENABLE_BENCHMARKS
+
+// ==================== MODELO DE ILHAS ====================
+// Subpopulacoes independentes (uma por thread) que trocam elites a cada
+// MIGRATION_INTERVAL geracoes em uma topologia anel ou toro 2D. Ilhas tambem
+// podem estar em processos distintos no mesmo host (--island-procs/--island-rank):
+// nesse caso os migrantes passam por memoria compartilhada POSIX.
+//
+// Nao ha barreira global: cada ilha publica seus elites da epoca e (slot e % 2)
+// e espera apenas pelas ilhas de origem publicarem a mesma epoca. Uma ilha so
+// sobrescreve um slot depois que seus destinos consumiram a epoca e - 2. Com
+// isso a troca e deterministica para uma seed fixa.
+
+#define DEFAULT_ISLAND_COUNT 1         // Ilhas por processo (1 = populacao unica)
+#define MIGRATION_INTERVAL 5           // Geracoes entre migracoes
+#define MIGRATION_SIZE 2               // Elites enviados por ilha a cada migracao
+#define MIGRATION_WAIT_TIMEOUT 300.0   // Segundos esperando vizinhos antes de desistir
+#define MIGRATION_MAGIC 0x4E455354     // "NEST"
+#define MIGRATION_MAX_NEIGHBORS 2
+#define STAGNATION_LIMIT 10            // Geracoes sem melhoria antes do restart (populacao unica)
+
+typedef enum {
+    TOPOLOGY_RING = 0,
+    TOPOLOGY_TORUS = 1
+} MigrationTopology;
+
+// Configuracao das ilhas (linha de comando ou arquivo, ver CONFIGURACAO)
+static int island_count = DEFAULT_ISLAND_COUNT;
+static int migration_interval = MIGRATION_INTERVAL;
+static int migration_size = MIGRATION_SIZE;
+static int stagnation_limit = STAGNATION_LIMIT;
+static MigrationTopology migration_topology = TOPOLOGY_RING;
+static int island_process_count = 1;
+static int island_process_rank = 0;
+static const char* island_shm_name = "/genetic_nesting_islands";
+
+typedef struct {
+    int magic;
+    unsigned int seed;
+    int island_total;
+    int piece_count;
+    int migration_size;         // Define o layout dos slots
+    int attached;               // Processos conectados
+} MigrationHeader;
+
+// Area de cada ilha no hub (contadores em linhas de cache proprias)
+typedef struct {
+    int published_epoch;        // Ultima epoca cujos elites estao no slot
+    char pad1[60];
+    int consumed_epoch;         // Ultima epoca lida de todas as origens
+    char pad2[60];
+} MigrationIslandState;
+
+typedef struct {
+    MigrationHeader* header;
+    char* memory;
+    size_t size;
+    size_t record_size;         // Um genoma migrante
+    size_t island_stride;       // Estado + 2 slots de migration_size registros
+    int island_total;
+    bool shared;
+} MigrationHub;
+
+static MigrationHub migration_hub;
+
+typedef struct {
+    int id;                     // Indice global da ilha
+    Genome* population;
+    PrefixIndex prefix;
+    double last_best_fitness;
+    int stagnation_count;
+    bool migration_enabled;
+} Island;
+
+#if defined(_MSC_VER)
+    #define ATOMIC_LOAD_INT(ptr) InterlockedCompareExchange((volatile LONG*)(ptr), 0, 0)
+    #define ATOMIC_STORE_INT(ptr, value) InterlockedExchange((volatile LONG*)(ptr), (value))
+    #define ATOMIC_ADD_INT(ptr, value) InterlockedExchangeAdd((volatile LONG*)(ptr), (value))
+#else
+    #define ATOMIC_LOAD_INT(ptr) __atomic_load_n((ptr), __ATOMIC_ACQUIRE)
+    #define ATOMIC_STORE_INT(ptr, value) __atomic_store_n((ptr), (value), __ATOMIC_RELEASE)
+    #define ATOMIC_ADD_INT(ptr, value) __atomic_fetch_add((ptr), (value), __ATOMIC_ACQ_REL)
+#endif
+
+static void migration_pause() {
+    #ifdef _WIN32
+        Sleep(1);
+    #else
+        struct timespec ts = {0, 1000000};
+        nanosleep(&ts, NULL);
+    #endif
+}
+
+// Espera *counter >= epoch; false em timeout
+static bool migration_wait(int* counter, int epoch) {
+    double deadline = wall_time() + MIGRATION_WAIT_TIMEOUT;
+    while (ATOMIC_LOAD_INT(counter) < epoch) {
+        if (wall_time() > deadline) return false;
+        migration_pause();
+    }
+    return true;
+}
+
+// Dimensoes do toro: maior divisor de n que nao passa de sqrt(n)
+static void torus_shape(int n, int* rows, int* cols) {
+    *rows = 1;
+    for (int r = 1; r * r <= n; r++) {
+        if (n % r == 0) *rows = r;
+    }
+    *cols = n / *rows;
+}
+
+// Vizinhos de uma ilha: origens (incoming = true) ou destinos dos migrantes
+static int migration_neighbors(int id, bool incoming, int* out) {
+    int n = migration_hub.island_total;
+    int step = incoming ? -1 : 1;
+    int count = 0;
+    int candidates[MIGRATION_MAX_NEIGHBORS];
+    int candidate_count = 0;
+
+    if (migration_topology == TOPOLOGY_TORUS) {
+        int rows, cols;
+        torus_shape(n, &rows, &cols);
+        int r = id / cols, c = id % cols;
+        candidates[candidate_count++] = r * cols + (c + step + cols) % cols;        // Horizontal
+        candidates[candidate_count++] = ((r + step + rows) % rows) * cols + c;      // Vertical
+    } else {
+        candidates[candidate_count++] = (id + step + n) % n;
+    }
+
+    for (int k = 0; k < candidate_count; k++) {
+        bool duplicate = candidates[k] == id;
+        for (int j = 0; j < count; j++) {
+            if (out[j] == candidates[k]) duplicate = true;
+        }
+        if (!duplicate) out[count++] = candidates[k];
+    }
+    return count;
+}
+
+static inline MigrationIslandState* migration_state(int id) {
+    return (MigrationIslandState*)(migration_hub.memory + sizeof(MigrationHeader) +
+                                   (size_t)id * migration_hub.island_stride);
+}
+
+static inline char* migration_record(int id, int slot, int k) {
+    return (char*)migration_state(id) + sizeof(MigrationIslandState) +
+           ((size_t)slot * migration_size + k) * migration_hub.record_size;
+}
+
+static void migration_layout(int island_total) {
+    migration_hub.island_total = island_total;
+    // fitness, total_efficiency, board_count, piece_sequence[n], rotation_choices[n]
+    size_t record = 2 * sizeof(double) + sizeof(int) * (1 + 2 * (size_t)input_data.piece_count);
+    migration_hub.record_size = (record + 7) & ~(size_t)7;
+    migration_hub.island_stride = sizeof(MigrationIslandState) + 2 * migration_size * migration_hub.record_size;
+    migration_hub.island_stride = (migration_hub.island_stride + 63) & ~(size_t)63;
+    migration_hub.size = sizeof(MigrationHeader) + (size_t)island_total * migration_hub.island_stride;
+}
+
+// Hub em memoria comum do processo (todas as ilhas sao threads)
+static bool migration_hub_create_local(int island_total) {
+    migration_layout(island_total);
+    migration_hub.memory = calloc(1, migration_hub.size);
+    migration_hub.shared = false;
+    if (!migration_hub.memory) return false;
+    migration_hub.header = (MigrationHeader*)migration_hub.memory;
+    return true;
+}
+
+// Hub em memoria compartilhada entre processos: o rank 0 cria, os demais conectam
+static bool migration_hub_attach_shared(int island_total, unsigned int seed) {
+    #ifdef _WIN32
+        (void)island_total;
+        (void)seed;
+        printf("ERRO: Ilhas em processos separados nao sao suportadas no Windows\n");
+        return false;
+    #else
+        migration_layout(island_total);
+        migration_hub.shared = true;
+
+        int fd = -1;
+        if (island_process_rank == 0) {
+            shm_unlink(island_shm_name);   // Segmento antigo de uma execucao interrompida
+            fd = shm_open(island_shm_name, O_CREAT | O_EXCL | O_RDWR, 0600);
+            if (fd < 0 || ftruncate(fd, (off_t)migration_hub.size) != 0) {
+                printf("ERRO: Falha ao criar memoria compartilhada %s: %s\n", island_shm_name, strerror(errno));
+                if (fd >= 0) close(fd);
+                return false;
+            }
+        } else {
+            double deadline = wall_time() + MIGRATION_WAIT_TIMEOUT;
+            while ((fd = shm_open(island_shm_name, O_RDWR, 0600)) < 0) {
+                if (wall_time() > deadline) {
+                    printf("ERRO: Memoria compartilhada %s nao encontrada (rank 0 iniciado?)\n", island_shm_name);
+                    return false;
+                }
+                migration_pause();
+            }
+            struct stat st;
+            while (fstat(fd, &st) == 0 && (size_t)st.st_size < migration_hub.size) {
+                if (wall_time() > deadline) break;
+                migration_pause();
+            }
+        }
+
+        void* memory = mmap(NULL, migration_hub.size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+        close(fd);
+        if (memory == MAP_FAILED) {
+            printf("ERRO: mmap da memoria compartilhada falhou: %s\n", strerror(errno));
+            return false;
+        }
+        migration_hub.memory = memory;
+        migration_hub.header = (MigrationHeader*)memory;
+        MigrationHeader* header = migration_hub.header;
+
+        if (island_process_rank == 0) {
+            header->seed = seed;
+            header->island_total = island_total;
+            header->piece_count = input_data.piece_count;
+            header->migration_size = migration_size;
+            ATOMIC_STORE_INT(&header->magic, MIGRATION_MAGIC);
+        } else {
+            if (!migration_wait(&header->magic, MIGRATION_MAGIC) || header->seed != seed ||
+                header->island_total != island_total || header->piece_count != input_data.piece_count || header->migration_size != migration_size) {
+                printf("ERRO: Memoria compartilhada %s incompativel (mesma seed, ilhas, pecas e migracao?)\n", island_shm_name);
+                munmap(memory, migration_hub.size);
+                return false;
+            }
+        }
+        ATOMIC_ADD_INT(&header->attached, 1);
+        return true;
+    #endif
+}
+
+void migration_hub_close() {
+    if (!migration_hub.memory) return;
+    #ifndef _WIN32
+        if (migration_hub.shared) {
+            // O nome so pode sumir depois que todos os processos conectaram
+            if (island_process_rank == 0) {
+                migration_wait(&migration_hub.header->attached, island_process_count);
+                shm_unlink(island_shm_name);
+            }
+            munmap(migration_hub.memory, migration_hub.size);
+            migration_hub.memory = NULL;
+            return;
+        }
+    #endif
+    free(migration_hub.memory);
+    migration_hub.memory = NULL;
+}
+
+static void migration_write_record(char* record, const Genome* genome) {
+    int n = input_data.piece_count;
+    double* values = (double*)record;
+    int* ints = (int*)(record + 2 * sizeof(double));
+    values[0] = genome->fitness;
+    values[1] = genome->total_efficiency;
+    ints[0] = genome->board_count;
+    memcpy(ints + 1, genome->piece_sequence, sizeof(int) * n);
+    memcpy(ints + 1 + n, genome->rotation_choices, sizeof(int) * n);
+}
+
+static void migration_read_record(const char* record, Genome* genome) {
+    int n = input_data.piece_count;
+    const double* values = (const double*)record;
+    const int* ints = (const int*)(record + 2 * sizeof(double));
+    genome->fitness = values[0];
+    genome->total_efficiency = values[1];
+    genome->board_count = ints[0];
+    memcpy(genome->piece_sequence, ints + 1, sizeof(int) * n);
+    memcpy(genome->rotation_choices, ints + 1 + n, sizeof(int) * n);
+    free(genome->placements);
+    genome->placements = NULL;
+}
+
+static void sort_population(Genome* population, int pop_size) {
+    // Ordenar populacao por fitness (decrescente) - bubble sort
+    for (int i = 0; i < pop_size - 1; i++) {
+        for (int j = 0; j < pop_size - i - 1; j++) {
+            if (population[j].fitness < population[j + 1].fitness) {
+                Genome temp = population[j];
+                population[j] = population[j + 1];
+                population[j + 1] = temp;
+            }
+        }
+    }
+}
+
+// Tira a ilha da migracao sem bloquear os vizinhos (timeout ou fim antecipado)
+static void island_retire(Island* island) {
+    if (!island->migration_enabled) return;
+    island->migration_enabled = false;
+    MigrationIslandState* self = migration_state(island->id);
+    ATOMIC_STORE_INT(&self->published_epoch, INT_MAX);
+    ATOMIC_STORE_INT(&self->consumed_epoch, INT_MAX);
+}
+
+// Publica os elites da epoca e substitui os piores pelos migrantes das origens
+// (populacao ordenada na entrada e na saida)
+static void island_migrate(Island* island, int epoch) {
+    if (!island->migration_enabled) return;
+
+    int targets[MIGRATION_MAX_NEIGHBORS], sources[MIGRATION_MAX_NEIGHBORS];
+    int target_count = migration_neighbors(island->id, false, targets);
+    int source_count = migration_neighbors(island->id, true, sources);
+    MigrationIslandState* self = migration_state(island->id);
+    int slot = epoch % 2;
+
+    // Slot so pode ser reescrito depois que os destinos leram a epoca anterior nele
+    for (int k = 0; k < target_count; k++) {
+        if (!migration_wait(&migration_state(targets[k])->consumed_epoch, epoch - 2)) goto timeout;
+    }
+    for (int k = 0; k < migration_size; k++) {
+        migration_write_record(migration_record(island->id, slot, k), &island->population[k]);
+    }
+    ATOMIC_STORE_INT(&self->published_epoch, epoch);
+
+    int replaced = 0;
+    for (int k = 0; k < source_count; k++) {
+        int* published = &migration_state(sources[k])->published_epoch;
+        if (!migration_wait(published, epoch)) goto timeout;
+        if (ATOMIC_LOAD_INT(published) == INT_MAX) continue;   // Origem desativada
+        for (int m = 0; m < migration_size && replaced < population_size - elite_size; m++) {
+            Genome* worst = &island->population[population_size - 1 - replaced++];
+            migration_read_record(migration_record(sources[k], slot, m), worst);
+        }
+    }
+    ATOMIC_STORE_INT(&self->consumed_epoch, epoch);
+    LOG_VERBOSE("  [ILHA %d] Migracao (epoca %d): %d migrantes recebidos\n", island->id, epoch, replaced);
+
+    sort_population(island->population, population_size);
+    return;
+
+timeout:
+    LOG_SUMMARY("  [ILHA %d] Vizinho sem resposta ha %.0fs: migracao desativada\n",
+           island->id, MIGRATION_WAIT_TIMEOUT);
+    island_retire(island);
+}
+
+// Cria e avalia a populacao inicial da ilha
+static void island_init(Island* island, int id, bool parallel) {
+    island->id = id;
+    island->prefix.entries = NULL;
+    island->prefix.mask = 0;
+    island->last_best_fitness = -DBL_MAX;
+    island->stagnation_count = 0;
+    island->migration_enabled = migration_hub.island_total > 1;
+    island->population = malloc(sizeof(Genome) * population_size);
+
+    Genome* population = island->population;
+    int greedy_count = population_size / 10;
+    for (int i = 0; i < greedy_count; i++) {
+        population[i] = create_greedy_genome();
+    }
+    for (int i = greedy_count; i < population_size; i++) {
+        Rng rng = rng_stream(RNG_STREAM_INIT, 0, id * population_size + i);
+        population[i] = create_random_genome(&rng);
+    }
+
+    if (parallel) {
+        #ifdef _OPENMP
+            #pragma omp parallel for schedule(dynamic)
+        #endif
+        for (int i = 0; i < population_size; i++) {
+            evaluate_genome(&population[i], NULL);
+        }
+    } else {
+        for (int i = 0; i < population_size; i++) {
+            evaluate_genome(&population[i], NULL);
+        }
+    }
+
+    // Depois da avaliacao, em ordem: nada de E/S dentro do laco paralelo
+    if (log_level >= LOG_LEVEL_VERBOSE) {
+        for (int i = 0; i < population_size; i++) {
+            LOG_VERBOSE("  [ILHA %d] Individuo %d/%d: %d placas, %.2f%% eff, fitness=%.2f\n",
+                        id, i + 1, population_size, population[i].board_count,
+                        population[i].total_efficiency, population[i].fitness);
+        }
+        log_flush();
+    }
+}
+
+static void island_free(Island* island) {
+    for (int i = 0; i < population_size; i++) {
+        free_genome(&island->population[i]);
+    }
+    free(island->population);
+    prefix_index_clear(&island->prefix);
+}
+
+// Crossover + mutacao + avaliacao do filho i da proxima geracao
+static inline void island_breed_child(Island* island, int gen, const int* parent_pairs,
+                                      Genome* new_population, int i) {
+    // Fluxo do filho depende apenas de (seed, geracao, ilha, indice)
+    Rng rng = rng_stream(RNG_STREAM_REPRODUCTION, gen, island->id * population_size + i);
+    Genome child = order_crossover(&island->population[parent_pairs[2 * i]],
+                                   &island->population[parent_pairs[2 * i + 1]], &rng);
+    mutate_genome(&child, &rng);
+    evaluate_genome(&child, &island->prefix);
+    new_population[i] = child;
+}
+
+// Uma geracao da ilha. 'parallel' distribui os filhos entre as threads
+// (populacao unica); no modo ilhas cada ilha ja ocupa uma thread.
+static void island_generation(Island* island, int gen, bool parallel) {
+    Genome* population = island->population;
+    sort_population(population, population_size);
+
+    if (migration_hub.island_total > 1 && gen > 0 && gen % migration_interval == 0) {
+        island_migrate(island, gen / migration_interval);
+    }
+
+    // CORRIGIDO: Comparação direta de fitness (empate: menor ilha, para ser deterministico)
+    #ifdef _OPENMP
+        #pragma omp critical(best_result)
+    #endif
+    {
+        static int best_island = INT_MAX;
+        double current_best_fitness = best_result.total_efficiency * 2.0 - best_result.board_count * 5.0;
+        if (population[0].fitness > current_best_fitness ||
+            (population[0].fitness == current_best_fitness && island->id < best_island)) {
+            evaluate_genome_to_global(&population[0]);
+            save_best_result();
+            best_result_improved();
+            best_island = island->id;
+        }
+    }
+
+    // NOVO: Detecção de estagnação e restart parcial da população
+    if (fabs(population[0].fitness - island->last_best_fitness) < 0.01) {
+        island->stagnation_count++;
+    } else {
+        island->stagnation_count = 0;
+        island->last_best_fitness = population[0].fitness;
+    }
+
+    // Se estagnado por muito tempo, fazer restart de 50% da população (menos elite).
+    // Com varias ilhas a migracao ja mantem a diversidade.
+    if (migration_hub.island_total <= 1 && island->stagnation_count >= stagnation_limit &&
+        gen < generations - 5) {
+        LOG_SUMMARY("  [RESTART] Estagnacao detectada (gen %d), reiniciando 50%% da populacao...\n", gen);
+        int restart_start = elite_size;
+        int restart_end = population_size / 2;
+
+        for (int i = restart_start; i < restart_end; i++) {
+            free_genome(&population[i]);
+            Rng rng = rng_stream(RNG_STREAM_RESTART, gen, island->id * population_size + i);
+            population[i] = create_random_genome(&rng);
+            evaluate_genome(&population[i], NULL);
+        }
+        island->stagnation_count = 0;
+    }
+
+    #if ENABLE_BENCHMARKS
+        if (island->id == 0) bench_csv_row(gen);
+    #endif
+
+    // Mostrar progresso a cada 5 gerações ou na última (apenas a primeira ilha);
+    // o fluxo JSON recebe todas as geracoes de todas as ilhas
+    bool show_progress = island->id == 0 && (gen % 5 == 0 || gen == generations - 1) &&
+                         log_level >= LOG_LEVEL_SUMMARY;
+    if (show_progress || progress_file) {
+        double avg_fitness = 0;
+        for (int i = 0; i < population_size; i++) {
+            avg_fitness += population[i].fitness;
+        }
+        avg_fitness /= population_size;
+
+        if (show_progress) {
+            LOG_SUMMARY("Geracao %4d: Melhor=%d placas, %.2f%% eff, fitness=%.2f | Media=%.2f\n",
+                        gen,
+                        population[0].board_count,
+                        population[0].total_efficiency,
+                        population[0].fitness,
+                        avg_fitness);
+        }
+        progress_event("generation", "\"island\": %d, \"generation\": %d, \"boards\": %d, "
+                       "\"efficiency\": %.4f, \"fitness\": %.4f, \"avg_fitness\": %.4f",
+                       island->id, gen, population[0].board_count, population[0].total_efficiency,
+                       population[0].fitness, avg_fitness);
+    }
+    log_flush();   // Mensagens desta geracao (restart, progresso) numa unica escrita
+
+    Genome* new_population = malloc(sizeof(Genome) * population_size);
+
+    for (int i = 0; i < elite_size; i++) {
+        new_population[i] = copy_genome(&population[i]);
+    }
+
+    // Filhos retomam a colocacao a partir dos prefixos ja avaliados dos pais
+    prefix_index_build(&island->prefix, population, population_size);
+
+    // Pares de pais sorteados antes do laco paralelo: a selecao so le a
+    // populacao, entao as threads nao precisam serializar o torneio
+    int* parent_pairs = malloc(sizeof(int) * 2 * population_size);
+    for (int i = elite_size; i < population_size; i++) {
+        Rng rng = rng_stream(RNG_STREAM_SELECTION, gen, island->id * population_size + i);
+        parent_pairs[2 * i] = tournament_selection(population, population_size, &rng);
+        parent_pairs[2 * i + 1] = tournament_selection(population, population_size, &rng);
+    }
+
+    if (parallel) {
+        #ifdef _OPENMP
+            #pragma omp parallel for schedule(dynamic)
+        #endif
+        for (int i = elite_size; i < population_size; i++) {
+            island_breed_child(island, gen, parent_pairs, new_population, i);
+        }
+    } else {
+        for (int i = elite_size; i < population_size; i++) {
+            island_breed_child(island, gen, parent_pairs, new_population, i);
+        }
+    }
+
+    prefix_index_clear(&island->prefix);
+    free(parent_pairs);
+
+    for (int i = 0; i < population_size; i++) {
+        free_genome(&population[i]);
+    }
+    free(population);
+
+    island->population = new_population;
+}
+
+// ==================== AG ESTADO ESTACIONARIO ====================
+// Modo assincrono (--steady-state) para populacao unica: sem geracoes e sem
+// barreira. Cada thread retira um ticket de avaliacao do contador global,
+// gera um filho a partir de dois torneios, avalia fora de qualquer lock e o
+// filho substitui o perdedor de um torneio inverso (a melhor posicao nunca
+// e substituida). O orcamento de avaliacoes e o mesmo do modo geracional.
+// A ordem de chegada depende do escalonamento: este modo nao e reprodutivel.
+
+static bool steady_state_mode = false;
+
+void run_steady_state(Island* island) {
+    Genome* population = island->population;
+    sort_population(population, population_size);
+
+    const int children_per_generation = population_size - elite_size;
+    const long long budget = (long long)generations * children_per_generation;
+    long long next_ticket = 0;
+    long long completed = 0;
+    int best_idx = 0;
+
+    #ifdef _OPENMP
+        omp_lock_t population_lock;
+        omp_init_lock(&population_lock);
+        #define POPULATION_LOCK() omp_set_lock(&population_lock)
+        #define POPULATION_UNLOCK() omp_unset_lock(&population_lock)
+    #else
+        #define POPULATION_LOCK()
+        #define POPULATION_UNLOCK()
+    #endif
+
+    #ifdef _OPENMP
+        #pragma omp parallel
+    #endif
+    {
+        // Copias privadas dos pais: a populacao pode mudar durante o crossover
+        Genome parents[2];
+        for (int p = 0; p < 2; p++) {
+            parents[p].piece_sequence = malloc(sizeof(int) * input_data.piece_count);
+            parents[p].rotation_choices = malloc(sizeof(int) * input_data.piece_count);
+            parents[p].placements = NULL;
+        }
+
+        while (true) {
+            long long ticket;
+            #ifdef _OPENMP
+                #pragma omp atomic capture
+            #endif
+            ticket = next_ticket++;
+            if (ticket >= budget || evolution_check_stop()) break;
+
+            Rng rng = rng_stream(RNG_STREAM_REPRODUCTION, (int)(ticket / population_size),
+                                 (int)(ticket % population_size));
+
+            POPULATION_LOCK();
+            for (int p = 0; p < 2; p++) {
+                Genome* source = &population[tournament_selection(population, population_size, &rng)];
+                memcpy(parents[p].piece_sequence, source->piece_sequence, sizeof(int) * input_data.piece_count);
+                memcpy(parents[p].rotation_choices, source->rotation_choices, sizeof(int) * input_data.piece_count);
+            }
+            POPULATION_UNLOCK();
+
+            Genome child = order_crossover(&parents[0], &parents[1], &rng);
+            mutate_genome(&child, &rng);
+            evaluate_genome(&child, NULL);
+
+            // Filho ainda privado: pode ser usado para atualizar o melhor global
+            #ifdef _OPENMP
+                #pragma omp critical(best_result)
+            #endif
+            {
+                double current_best_fitness = best_result.total_efficiency * 2.0 - best_result.board_count * 5.0;
+                if (child.fitness > current_best_fitness) {
+                    evaluate_genome_to_global(&child);
+                    save_best_result();
+                    best_result_improved();
+                }
+            }
+
+            POPULATION_LOCK();
+            // Torneio inverso: o pior de tournament_size sorteados (exceto o melhor) sai
+            int loser = -1;
+            for (int k = 0; k < tournament_size; k++) {
+                int candidate = rng_int(&rng, population_size);
+                if (candidate == best_idx) continue;
+                if (loser < 0 || population[candidate].fitness < population[loser].fitness) loser = candidate;
+            }
+            Genome replaced = child;
+            if (loser >= 0) {
+                replaced = population[loser];
+                population[loser] = child;
+                if (child.fitness > population[best_idx].fitness) best_idx = loser;
+            }
+
+            long long done = ++completed;
+            #if ENABLE_BENCHMARKS
+                if (done % children_per_generation == 0) bench_csv_row(done / children_per_generation);
+            #endif
+            bool show_progress = (done % (5LL * children_per_generation) == 0 || done == budget) &&
+                                 log_level >= LOG_LEVEL_SUMMARY;
+            bool stream_progress = progress_file && done % children_per_generation == 0;
+            if (show_progress || stream_progress) {
+                double avg_fitness = 0;
+                for (int i = 0; i < population_size; i++) {
+                    avg_fitness += population[i].fitness;
+                }
+                avg_fitness /= population_size;
+
+                if (show_progress) {
+                    LOG_SUMMARY("Geracao %4lld: Melhor=%d placas, %.2f%% eff, fitness=%.2f | Media=%.2f\n",
+                                done / children_per_generation,
+                                population[best_idx].board_count,
+                                population[best_idx].total_efficiency,
+                                population[best_idx].fitness,
+                                avg_fitness);
+                }
+                if (stream_progress) {
+                    progress_event("generation", "\"island\": %d, \"generation\": %lld, \"boards\": %d, "
+                                   "\"efficiency\": %.4f, \"fitness\": %.4f, \"avg_fitness\": %.4f",
+                                   island->id, done / children_per_generation,
+                                   population[best_idx].board_count, population[best_idx].total_efficiency,
+                                   population[best_idx].fitness, avg_fitness);
+                }
+            }
+            POPULATION_UNLOCK();
+            log_flush();
+
+            free_genome(&replaced);
+        }
+
+        for (int p = 0; p < 2; p++) {
+            free_genome(&parents[p]);
+        }
+    }
+
+    #undef POPULATION_LOCK
+    #undef POPULATION_UNLOCK
+    #ifdef _OPENMP
+        omp_destroy_lock(&population_lock);
+    #endif
+
+    sort_population(population, population_size);
+}
+
+#if ENABLE_CONCAVE_NESTING
+// ==================== CONCAVE NESTING OPTIMIZATION (PHASE 3) ====================
+
+/**
+ * Calculate concavity ratio for a piece.
+ * Returns ratio of empty space in bounding box (1.0 - polygon_area/bbox_area)
+ * Higher values indicate more concavity.
+ */
+double calculate_concavity_ratio(Piece* piece) {
+    double bbox_area = piece->width * piece->height;
+    if (bbox_area < 1e-10) return 0.0;
+
+    double polygon_area = piece->area;
+    double ratio = 1.0 - (polygon_area / bbox_area);
+
+    return (ratio < 0.0) ? 0.0 : ratio;
+}
+
+/**
+ * Sample concave regions using grid-based approach.
+ * Finds points inside bounding box but outside polygon (concavity).
+ * Returns ConcavityInfo with candidate points or NULL if no significant concavity.
+ */
+ConcavityInfo* sample_concave_regions(Piece* piece, PlacedPiece* placed, int grid_res) {
+    double concavity_ratio = calculate_concavity_ratio(piece);
+
+    // Early exit if concavity below threshold
+    if (concavity_ratio < concavity_threshold) {
+        return NULL;
+    }
+
+    ConcavityInfo* info = malloc(sizeof(ConcavityInfo));
+    if (!info) return NULL;
+
+    info->concavity_ratio = concavity_ratio;
+
+    // Allocate for worst case (all grid points)
+    info->points = malloc(sizeof(ConcavePoint) * grid_res * grid_res);
+    if (!info->points) {
+        free(info);
+        return NULL;
+    }
+    info->num_points = 0;
+
+    // Grid sampling: check each grid point
+    double step_x = piece->width / (grid_res - 1);
+    double step_y = piece->height / (grid_res - 1);
+
+    for (int iy = 0; iy < grid_res; iy++) {
+        for (int ix = 0; ix < grid_res; ix++) {
+            // Local coordinates relative to piece
+            double local_x = piece->min_x + ix * step_x;
+            double local_y = piece->min_y + iy * step_y;
+
+            // Check if point is in bbox but NOT in polygon
+            bool in_bbox = (local_x >= piece->min_x && local_x <= piece->max_x &&
+                           local_y >= piece->min_y && local_y <= piece->max_y);
+
+            bool in_polygon = point_in_polygon_soa(&piece->soa, local_x, local_y);
+
+            // This is a concave point (in bbox but outside polygon)
+            if (in_bbox && !in_polygon) {
+                // Convert to world coordinates
+                info->points[info->num_points].x = local_x + placed->position.x;
+                info->points[info->num_points].y = local_y + placed->position.y;
+                info->num_points++;
+            }
+        }
+    }
+
+    // If no concave points found, free and return NULL
+    if (info->num_points == 0) {
+        free(info->points);
+        free(info);
+        return NULL;
+    }
+
+    // Shrink allocation to actual size
+    ConcavePoint* resized = realloc(info->points, sizeof(ConcavePoint) * info->num_points);
+    if (resized) {
+        info->points = resized;
     }
 
     return info;
 }
 
 /**
- * Try to fit a small piece into a concavity region with sub-grid refinement.
- * Tests multiple positions using ONLY the piece's allowed_angles (respects input_shapes.json constraints).
- * Returns true if piece was successfully repositioned, false otherwise.
+ * Phase 3 messages go to a per-board LogBuffer: boards are optimized in
+ * parallel, so main prints the buffers in board order afterwards.
+ */
+static void concave_log(LogBuffer* log, int level, const char* format, ...) {
+    if (log_level < level) return;
+    va_list args;
+    va_start(args, format);
+    log_buffer_vappend(log, format, args);
+    va_end(args);
+}
+
+/**
+ * Candidate k of a fit search, in the serial visiting order: concavity point,
+ * then allowed rotation, then sub-grid offset (center first, then row-major).
+ * Decodes k into the tested position and rotation index.
+ */
+static Point concave_candidate(const ConcavityInfo* concavity, long long k, int rotation_count,
+                               int sub_count, double step_size, int* rot_idx) {
+    int half = subgrid_resolution / 2;
+    int side = 2 * half + 1;
+    int sub = (int)(k % sub_count);
+    *rot_idx = (int)((k / sub_count) % rotation_count);
+    int pt_idx = (int)(k / ((long long)sub_count * rotation_count));
+
+    Point position = {concavity->points[pt_idx].x, concavity->points[pt_idx].y};
+    if (sub > 0) {
+        int center = half * side + half;
+        int t = sub - 1 < center ? sub - 1 : sub;   // Ordem do sub-grid sem o centro
+        position.x += (t / side - half) * step_size;
+        position.y += (t % side - half) * step_size;
+    }
+    return position;
+}
+
+/**
+ * Tests the candidates of one concavity point in order and returns the first
+ * k that fits, or -1. Stops early once k can no longer beat *best_k.
+ */
+static long long concave_search_point(Board* board, int small_piece_idx, const ConcavityInfo* concavity,
+                                      int pt_idx, int rotation_count, int sub_count, double step_size,
+                                      const long long* best_k) {
+    int piece_id = board->placed_pieces[small_piece_idx].piece_id;
+    long long first = (long long)pt_idx * rotation_count * sub_count;
+    for (long long k = first; k < first + (long long)rotation_count * sub_count; k++) {
+        long long current;
+        #ifdef _OPENMP
+            #pragma omp atomic read
+        #endif
+        current = *best_k;
+        if (k >= current) return -1;
+
+        int rot_idx;
+        Point position = concave_candidate(concavity, k, rotation_count, sub_count, step_size, &rot_idx);
+        if (piece_fits_in_board_excluding(get_rotated_piece(piece_id, rot_idx), position, board, small_piece_idx)) {
+            return k;
+        }
+    }
+    return -1;
+}
+
+/**
+ * Try to fit a small piece into a concavity region with sub-grid refinement.
+ * Tests multiple positions using ONLY the piece's allowed_angles (respects input_shapes.json constraints).
+ * Candidate points are searched in parallel when 'parallel' is set; the winner is
+ * always the first fitting candidate in serial order, so the result does not
+ * depend on the thread count.
+ * Returns true if piece was successfully repositioned, false otherwise.
+ */
+bool try_fit_in_concavity(Board* board, int small_piece_idx, ConcavityInfo* concavity, Piece* large_piece,
+                          bool parallel, LogBuffer* log) {
+    PlacedPiece* small_placed = &board->placed_pieces[small_piece_idx];
+    Piece* small_original = &input_data.pieces[small_placed->piece_id];
+
+    // CRITICAL: Use ONLY the piece's allowed rotation angles from input_shapes.json
+    // This respects the same constraints used by the genetic algorithm
+    int num_allowed_rotations = small_original->angle_count;
+    int side = 2 * (subgrid_resolution / 2) + 1;
+    int sub_count = side * side;
+    double step_size = min_double(large_piece->width, large_piece->height) / (grid_resolution * 2.0);
+
+    long long best_k = LLONG_MAX;
+    if (parallel) {
+        #ifdef _OPENMP
+            #pragma omp parallel for schedule(dynamic, 4)
+        #endif
+        for (int pt_idx = 0; pt_idx < concavity->num_points; pt_idx++) {
+            long long k = concave_search_point(board, small_piece_idx, concavity, pt_idx,
+                                               num_allowed_rotations, sub_count, step_size, &best_k);
+            if (k >= 0) {
+                #ifdef _OPENMP
+                    #pragma omp critical(concave_best)
+                #endif
+                if (k < best_k) best_k = k;
+            }
+        }
+    } else {
+        for (int pt_idx = 0; pt_idx < concavity->num_points && best_k == LLONG_MAX; pt_idx++) {
+            long long k = concave_search_point(board, small_piece_idx, concavity, pt_idx,
+                                               num_allowed_rotations, sub_count, step_size, &best_k);
+            if (k >= 0) best_k = k;
+        }
+    }
+
+    // Rotacoes testadas ate o vencedor, como na busca serial
+    long long attempts = best_k == LLONG_MAX ? (long long)concavity->num_points * num_allowed_rotations
+                                             : best_k / sub_count + 1;
+
+    if (best_k == LLONG_MAX) {
+        concave_log(log, LOG_LEVEL_VERBOSE, "      [FALHA] Peca %d nao encaixou apos %lld tentativas\n",
+                    small_placed->piece_id, attempts);
+        concave_log(log, LOG_LEVEL_VERBOSE, "              Angulos permitidos testados: %d, Pontos candidatos testados: %d\n",
+                    num_allowed_rotations, concavity->num_points);
+        return false;
+    }
+
+    // Success! Update the piece position
+    int rot_idx;
+    Point position = concave_candidate(concavity, best_k, num_allowed_rotations, sub_count, step_size, &rot_idx);
+    int test_angle = small_original->allowed_angles[rot_idx];
+    board_move_piece(board, small_piece_idx, position, test_angle, get_rotated_piece(small_placed->piece_id, rot_idx));
+
+    if (best_k % sub_count == 0) {
+        concave_log(log, LOG_LEVEL_VERBOSE, "      [SUCESSO] Peca %d encaixada em (%.1f, %.1f) com rotacao %d graus\n",
+                    small_placed->piece_id, position.x, position.y, test_angle);
+        concave_log(log, LOG_LEVEL_VERBOSE, "                Tentativas: %lld, Angulos permitidos para esta peca: %d\n",
+                    attempts, num_allowed_rotations);
+    } else {
+        int pt_idx = (int)(best_k / ((long long)sub_count * num_allowed_rotations));
+        double off_x = position.x - concavity->points[pt_idx].x;
+        double off_y = position.y - concavity->points[pt_idx].y;
+        concave_log(log, LOG_LEVEL_VERBOSE, "      [SUCESSO - REFINADO] Peca %d encaixada em (%.1f, %.1f) com rotacao %d graus\n",
+                    small_placed->piece_id, position.x, position.y, test_angle);
+        concave_log(log, LOG_LEVEL_VERBOSE, "                           Ajuste sub-grid: (%d, %d) offset=(%.1f, %.1f)\n",
+                    (int)lround(off_x / step_size), (int)lround(off_y / step_size), off_x, off_y);
+    }
+
+    return true;
+}
+
+/**
+ * Main optimization function for concave nesting (Phase 3).
+ * Identifies large pieces with concavities and attempts to fit smaller pieces inside.
+ * Touches only this board, so boards can be optimized concurrently; messages go to 'log'.
+ * 'parallel' splits each fit search across threads (use when boards run serially).
  */
-bool try_fit_in_concavity(Board* board, int small_piece_idx, ConcavityInfo* concavity, Piece* large_piece) {
-    PlacedPiece* small_placed = &board->placed_pieces[small_piece_idx];
-    Piece* small_original = &input_data.pieces[small_placed->piece_id];
+void optimize_concave_nesting(Board* board, bool parallel, LogBuffer* log) {
+    concave_log(log, LOG_LEVEL_SUMMARY, "Analisando concavidades...\n");
+
+    // Track statistics
+    int large_pieces_found = 0;
+    int repositioning_attempts = 0;
+    int successful_repositions = 0;
+
+    // Phase 1: Identify large pieces with concavities
+    typedef struct {
+        int piece_idx;
+        double concavity_ratio;
+        double area;
+    } LargePiece;
+
+    LargePiece* large_pieces = malloc(sizeof(LargePiece) * board->piece_count);
+    int large_count = 0;
+
+    for (int i = 0; i < board->piece_count; i++) {
+        PlacedPiece* placed = &board->placed_pieces[i];
+        Piece* piece = placed->rotated_piece;
+
+        double ratio = calculate_concavity_ratio(piece);
+
+        if (ratio >= concavity_threshold) {
+            large_pieces[large_count].piece_idx = i;
+            large_pieces[large_count].concavity_ratio = ratio;
+            large_pieces[large_count].area = piece->area;
+            large_count++;
+            large_pieces_found++;
+        }
+    }
+
+    concave_log(log, LOG_LEVEL_SUMMARY, "  Encontradas %d pecas com concavidades significativas (>%.0f%%)\n",
+                large_pieces_found, concavity_threshold * 100);
+
+    if (large_count == 0) {
+        free(large_pieces);
+        concave_log(log, LOG_LEVEL_SUMMARY, "  Nenhuma otimizacao possivel.\n");
+        return;
+    }
+
+    // Sort large pieces by concavity ratio (descending)
+    for (int i = 0; i < large_count - 1; i++) {
+        for (int j = 0; j < large_count - i - 1; j++) {
+            if (large_pieces[j].concavity_ratio < large_pieces[j + 1].concavity_ratio) {
+                LargePiece temp = large_pieces[j];
+                large_pieces[j] = large_pieces[j + 1];
+                large_pieces[j + 1] = temp;
+            }
+        }
+    }
+
+    // Calculate initial efficiency
+    double initial_efficiency = board->efficiency;
+
+    // Phase 2: For each large piece, try to fit small pieces in concavity
+    for (int lp_idx = 0; lp_idx < large_count; lp_idx++) {
+        int large_idx = large_pieces[lp_idx].piece_idx;
+        PlacedPiece* large_placed = &board->placed_pieces[large_idx];
+
+        concave_log(log, LOG_LEVEL_VERBOSE, "  Analisando peca %d (concavidade: %.1f%%, area: %.0f)...\n",
+                    large_placed->piece_id,
+                    large_pieces[lp_idx].concavity_ratio * 100,
+                    large_pieces[lp_idx].area);
+
+        // Sample concave regions
+        ConcavityInfo* concavity = sample_concave_regions(large_placed->rotated_piece,
+                                                          large_placed,
+                                                          grid_resolution);
+
+        if (!concavity) {
+            concave_log(log, LOG_LEVEL_VERBOSE, "    Nao foi possivel amostrar pontos candidatos.\n");
+            continue;
+        }
+
+        concave_log(log, LOG_LEVEL_VERBOSE, "    Encontrados %d pontos candidatos na concavidade.\n", concavity->num_points);
+
+        // Find small pieces to try (area < max_small_piece_ratio * large_area)
+        typedef struct { int idx; double area; } SmallPiece;
+        SmallPiece* small_pieces = malloc(sizeof(SmallPiece) * board->piece_count);
+        int small_count = 0;
+
+        double max_small_area = large_pieces[lp_idx].area * max_small_piece_ratio;
+
+        for (int i = 0; i < board->piece_count; i++) {
+            if (i == large_idx) continue; // Skip self
+
+            PlacedPiece* placed = &board->placed_pieces[i];
+            Piece* original = &input_data.pieces[placed->piece_id];
+
+            if (original->area <= max_small_area) {
+                small_pieces[small_count].idx = i;
+                small_pieces[small_count].area = original->area;
+                small_count++;
+            }
+        }
+
+        concave_log(log, LOG_LEVEL_VERBOSE, "    Encontradas %d pecas pequenas candidatas (area < %.0f).\n",
+                    small_count, max_small_area);
+
+        // Sort small pieces by area (ascending - smallest first)
+        for (int i = 0; i < small_count - 1; i++) {
+            for (int j = 0; j < small_count - i - 1; j++) {
+                if (small_pieces[j].area > small_pieces[j + 1].area) {
+                    SmallPiece temp = small_pieces[j];
+                    small_pieces[j] = small_pieces[j + 1];
+                    small_pieces[j + 1] = temp;
+                }
+            }
+        }
+
+        // Try to fit small pieces
+        for (int sp_idx = 0; sp_idx < small_count; sp_idx++) {
+            int small_idx = small_pieces[sp_idx].idx;
+            repositioning_attempts++;
+
+            concave_log(log, LOG_LEVEL_VERBOSE, "    Tentando encaixar peca %d (area=%.0f, %.1f%% da peca grande)...\n",
+                        board->placed_pieces[small_idx].piece_id,
+                        small_pieces[sp_idx].area,
+                        (small_pieces[sp_idx].area / large_pieces[lp_idx].area) * 100.0);
+
+            if (try_fit_in_concavity(board, small_idx, concavity, large_placed->rotated_piece, parallel, log)) {
+                successful_repositions++;
+                // No modo verbose a tentativa ja registrou o [SUCESSO] detalhado
+                if (log_level < LOG_LEVEL_VERBOSE)
+                    concave_log(log, LOG_LEVEL_SUMMARY, "      [OK] Peca %d reposicionada na concavidade!\n",
+                            board->placed_pieces[small_idx].piece_id);
+            }
+        }
+
+        free(small_pieces);
+        free(concavity->points);
+        free(concavity);
+    }
+
+    free(large_pieces);
+
+    // Recalculate board efficiency after optimization
+    double board_area = board->width * board->height;
+    board->efficiency = (board->used_area / board_area) * 100.0;
+
+    concave_log(log, LOG_LEVEL_SUMMARY, "\nResultados da otimizacao de concavidades:\n");
+    concave_log(log, LOG_LEVEL_SUMMARY, "  Pecas com concavidades analisadas: %d\n", large_pieces_found);
+    concave_log(log, LOG_LEVEL_SUMMARY, "  Tentativas de reposicionamento: %d\n", repositioning_attempts);
+    concave_log(log, LOG_LEVEL_SUMMARY, "  Reposicionamentos bem-sucedidos: %d\n", successful_repositions);
+
+    if (repositioning_attempts > 0) {
+        concave_log(log, LOG_LEVEL_SUMMARY, "  Taxa de sucesso: %.1f%%\n",
+                    (successful_repositions * 100.0) / repositioning_attempts);
+    }
+
+    concave_log(log, LOG_LEVEL_SUMMARY, "  Eficiencia inicial: %.2f%%\n", initial_efficiency);
+    concave_log(log, LOG_LEVEL_SUMMARY, "  Eficiencia final: %.2f%%\n", board->efficiency);
+
+    if (board->efficiency > initial_efficiency) {
+        concave_log(log, LOG_LEVEL_SUMMARY, "  Melhoria: +%.2f%%\n", board->efficiency - initial_efficiency);
+    } else if (board->efficiency < initial_efficiency) {
+        concave_log(log, LOG_LEVEL_SILENT, "  [AVISO] Eficiencia reduziu em %.2f%% (possivel bug)\n",
+                    initial_efficiency - board->efficiency);
+    } else {
+        concave_log(log, LOG_LEVEL_SUMMARY, "  Nenhuma melhoria alcancada nesta placa.\n");
+    }
+}
+
+#endif // ENABLE_CONCAVE_NESTING
+
+// ==================== PARSING AND OUTPUT ====================
+
+// Diagnostico detalhado quando o arquivo de entrada nao pode ser aberto
+static void report_open_error(const char* filename) {
+    printf("ERRO ao abrir arquivo: %s\n", filename);
+    printf("Detalhes: ");
+
+    #ifdef _WIN32
+        // Windows: verificar se o arquivo existe
+        DWORD attrs = GetFileAttributesA(filename);
+        if (attrs == INVALID_FILE_ATTRIBUTES) {
+            DWORD error = GetLastError();
+            if (error == ERROR_FILE_NOT_FOUND) {
+                printf("Arquivo nao encontrado.\n");
+            } else if (error == ERROR_PATH_NOT_FOUND) {
+                printf("Caminho nao encontrado.\n");
+            } else if (error == ERROR_ACCESS_DENIED) {
+                printf("Acesso negado (permissao).\n");
+            } else {
+                printf("Codigo de erro Windows: %lu\n", error);
+            }
+        } else {
+            printf("Codigo de erro Windows: %lu\n", GetLastError());
+        }
+    #else
+        // Linux/Unix: usar errno para diagnostico
+        printf("%s\n", strerror(errno));
+    #endif
+
+    // Mostrar diretorio de trabalho atual para debug
+    char cwd[1024];
+    #ifdef _WIN32
+        GetCurrentDirectoryA(sizeof(cwd), cwd);
+    #else
+        if (getcwd(cwd, sizeof(cwd)) == NULL) {
+            strcpy(cwd, "(nao foi possivel determinar)");
+        }
+    #endif
+    printf("Diretorio de trabalho atual: %s\n", cwd);
+    printf("\nVERIFIQUE:\n");
+    printf("1. O arquivo '%s' existe no mesmo diretorio que o executavel?\n", filename);
+    printf("2. O nome do arquivo esta correto (maiusculas/minusculas)?\n");
+    printf("3. Voce esta executando o programa do diretorio correto?\n");
+    printf("\n");
+}
+
+// Arquivo mapeado copy-on-write (sem copia nem terminador '\0'): escritas ficam
+// privadas ao processo, entao a geometria pode ser usada direto do mapeamento
+typedef struct {
+    char* data;
+    size_t size;
+    #ifdef _WIN32
+        HANDLE file;
+        HANDLE mapping;
+    #endif
+} MappedFile;
+
+static bool mapped_file_open(MappedFile* mapped, const char* filename) {
+    static char empty[1] = "";
+    memset(mapped, 0, sizeof(*mapped));
+    mapped->data = empty;
+
+    #ifdef _WIN32
+        mapped->file = CreateFileA(filename, GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING,
+                                   FILE_ATTRIBUTE_NORMAL | FILE_FLAG_SEQUENTIAL_SCAN, NULL);
+        if (mapped->file == INVALID_HANDLE_VALUE) {
+            report_open_error(filename);
+            return false;
+        }
+        LARGE_INTEGER size;
+        if (!GetFileSizeEx(mapped->file, &size)) {
+            printf("ERRO: Falha ao obter tamanho do arquivo %s\n", filename);
+            CloseHandle(mapped->file);
+            return false;
+        }
+        mapped->size = (size_t)size.QuadPart;
+        if (mapped->size == 0) return true;   // Arquivo vazio nao pode ser mapeado
+        mapped->mapping = CreateFileMappingA(mapped->file, NULL, PAGE_WRITECOPY, 0, 0, NULL);
+        char* view = mapped->mapping ? MapViewOfFile(mapped->mapping, FILE_MAP_COPY, 0, 0, 0) : NULL;
+        if (!view) {
+            printf("ERRO: Falha ao mapear o arquivo %s (codigo %lu)\n", filename, GetLastError());
+            if (mapped->mapping) CloseHandle(mapped->mapping);
+            CloseHandle(mapped->file);
+            return false;
+        }
+        mapped->data = view;
+    #else
+        int fd = open(filename, O_RDONLY);
+        if (fd < 0) {
+            report_open_error(filename);
+            return false;
+        }
+        struct stat info;
+        if (fstat(fd, &info) != 0) {
+            printf("ERRO: Falha ao obter tamanho do arquivo %s: %s\n", filename, strerror(errno));
+            close(fd);
+            return false;
+        }
+        mapped->size = (size_t)info.st_size;
+        if (mapped->size > 0) {
+            void* view = mmap(NULL, mapped->size, PROT_READ | PROT_WRITE, MAP_PRIVATE, fd, 0);
+            if (view == MAP_FAILED) {
+                printf("ERRO: Falha ao mapear o arquivo %s: %s\n", filename, strerror(errno));
+                close(fd);
+                return false;
+            }
+            #ifdef MADV_SEQUENTIAL
+                madvise(view, mapped->size, MADV_SEQUENTIAL);
+            #endif
+            mapped->data = view;
+        }
+        close(fd);   // O mapeamento continua valido
+    #endif
+    return true;
+}
+
+static void mapped_file_close(MappedFile* mapped) {
+    #ifdef _WIN32
+        if (mapped->size > 0) {
+            UnmapViewOfFile(mapped->data);
+            CloseHandle(mapped->mapping);
+        }
+        CloseHandle(mapped->file);
+    #else
+        if (mapped->size > 0) munmap(mapped->data, mapped->size);
+    #endif
+    mapped->data = NULL;
+    mapped->size = 0;
+}
+
+// Leitor JSON de passagem unica: avanca um cursor sobre o buffer mapeado,
+// sem copias; chaves desconhecidas sao puladas e a ordem das chaves e livre.
+// O primeiro erro registra linha e coluna e interrompe a leitura.
+typedef struct {
+    const char* start;
+    const char* cursor;
+    const char* end;
+    bool failed;
+    char error[256];
+} JsonReader;
+
+static void json_reader_error(JsonReader* r, const char* format, ...) {
+    if (r->failed) return;
+    r->failed = true;
+    int line = 1, column = 1;
+    for (const char* c = r->start; c < r->cursor; c++) {
+        if (*c == '\n') {
+            line++;
+            column = 1;
+        } else {
+            column++;
+        }
+    }
+    int len = snprintf(r->error, sizeof(r->error), "linha %d, coluna %d: ", line, column);
+    va_list args;
+    va_start(args, format);
+    vsnprintf(r->error + len, sizeof(r->error) - len, format, args);
+    va_end(args);
+}
+
+static inline void json_reader_skip_whitespace(JsonReader* r) {
+    while (r->cursor < r->end &&
+           (*r->cursor == ' ' || *r->cursor == '\t' || *r->cursor == '\n' || *r->cursor == '\r')) {
+        r->cursor++;
+    }
+}
+
+// Proximo caractere significativo (0 no fim do arquivo), sem consumir
+static inline char json_reader_peek(JsonReader* r) {
+    json_reader_skip_whitespace(r);
+    return r->cursor < r->end ? *r->cursor : '\0';
+}
+
+static const char* json_reader_describe(JsonReader* r) {
+    static const char* end_text = "fim do arquivo";
+    if (r->cursor >= r->end) return end_text;
+    static char text[4][8];
+    static int slot = 0;
+    char* out = text[slot++ % 4];
+    snprintf(out, 8, "'%c'", (unsigned char)*r->cursor >= 0x20 ? *r->cursor : '?');
+    return out;
+}
+
+static bool json_reader_expect(JsonReader* r, char c) {
+    if (json_reader_peek(r) != c) {
+        json_reader_error(r, "esperado '%c', encontrado %s", c, json_reader_describe(r));
+        return false;
+    }
+    r->cursor++;
+    return true;
+}
+
+// String sem decodificar escapes: aponta para o conteudo dentro do buffer
+static bool json_reader_string(JsonReader* r, const char** text, size_t* length) {
+    if (!json_reader_expect(r, '"')) return false;
+    const char* begin = r->cursor;
+    while (r->cursor < r->end && *r->cursor != '"') {
+        if (*r->cursor == '\\') r->cursor++;
+        else if ((unsigned char)*r->cursor < 0x20) {
+            json_reader_error(r, "caractere de controle dentro de string");
+            return false;
+        }
+        r->cursor++;
+    }
+    if (r->cursor >= r->end) {
+        json_reader_error(r, "string sem aspas de fechamento");
+        return false;
+    }
+    *text = begin;
+    *length = (size_t)(r->cursor - begin);
+    r->cursor++;
+    return true;
+}
+
+#define JSON_NUMBER_MAX_DIGITS 768   // Digitos que podem decidir o arredondamento de um double
+
+static const double json_exact_pow10[] = {
+    1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9, 1e10, 1e11,
+    1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22
+};
+
+// Numero JSON. Caminho rapido exato (mantissa < 2^53 e expoente <= 22, ambos
+// representaveis: uma unica operacao corretamente arredondada); demais casos
+// via strtod numa copia terminada em '\0'.
+static bool json_reader_number(JsonReader* r, double* value) {
+    json_reader_skip_whitespace(r);
+    const char* begin = r->cursor;
+    const char* c = begin;
+    bool negative = false;
+    if (c < r->end && *c == '-') {
+        negative = true;
+        c++;
+    }
+    if (c >= r->end || *c < '0' || *c > '9') {
+        json_reader_error(r, "esperado numero, encontrado %s", json_reader_describe(r));
+        return false;
+    }
+
+    if (*c == '0' && c + 1 < r->end && c[1] >= '0' && c[1] <= '9') {
+        r->cursor = c;
+        json_reader_error(r, "zero a esquerda em numero");
+        return false;
+    }
+
+    uint64_t mantissa = 0;
+    int digits = 0, exponent = 0;
+    for (; c < r->end && *c >= '0' && *c <= '9'; c++) {
+        if (digits < 19) mantissa = mantissa * 10 + (uint64_t)(*c - '0');
+        else exponent++;
+        if (mantissa > 0) digits++;
+    }
+    if (c < r->end && *c == '.') {
+        c++;
+        if (c >= r->end || *c < '0' || *c > '9') {
+            r->cursor = c;
+            json_reader_error(r, "esperado digito apos o ponto decimal");
+            return false;
+        }
+        for (; c < r->end && *c >= '0' && *c <= '9'; c++) {
+            if (digits < 19) {
+                mantissa = mantissa * 10 + (uint64_t)(*c - '0');
+                exponent--;
+                if (mantissa > 0) digits++;
+            }
+        }
+    }
+    if (c < r->end && (*c == 'e' || *c == 'E')) {
+        c++;
+        int sign = 1, power = 0;
+        if (c < r->end && (*c == '+' || *c == '-')) {
+            if (*c == '-') sign = -1;
+            c++;
+        }
+        if (c >= r->end || *c < '0' || *c > '9') {
+            r->cursor = c;
+            json_reader_error(r, "expoente sem digitos");
+            return false;
+        }
+        for (; c < r->end && *c >= '0' && *c <= '9'; c++) {
+            if (power < 10000) power = power * 10 + (*c - '0');
+        }
+        exponent += sign * power;
+    }
+    r->cursor = c;
+
+    if (digits < 19 && mantissa < (1ULL << 53) && exponent >= -22 && exponent <= 22) {
+        double result = (double)mantissa;
+        result = exponent < 0 ? result / json_exact_pow10[-exponent] : result * json_exact_pow10[exponent];
+        *value = negative ? -result : result;
+        return true;
+    }
+
+    // Copia normalizada para strtod: ate JSON_NUMBER_MAX_DIGITS digitos
+    // significativos sem ponto decimal e o expoente reescrito (digitos da
+    // fracao o decrementam, digitos descartados da parte inteira o
+    // incrementam). Digitos descartados nao nulos viram um '1' final, que
+    // preserva a direcao do arredondamento em casos de empate.
+    char text[JSON_NUMBER_MAX_DIGITS + 32];
+    int length = 0, shift = 0;
+    bool fraction = false, sticky = false;
+    const char* p = begin;
+    if (negative) {
+        text[length++] = '-';
+        p++;
+    }
+    int first_digit = length;
+    for (; p < c && *p != 'e' && *p != 'E'; p++) {
+        if (*p == '.') {
+            fraction = true;
+        } else if (length == first_digit && *p == '0') {
+            if (fraction) shift--;      // Zero a esquerda
+        } else if (length - first_digit < JSON_NUMBER_MAX_DIGITS) {
+            text[length++] = *p;
+            if (fraction) shift--;
+        } else {
+            if (!fraction) shift++;
+            if (*p != '0') sticky = true;
+        }
+    }
+    if (length == first_digit) text[length++] = '0';
+    if (sticky) {
+        text[length++] = '1';
+        shift--;
+    }
+    if (p < c) {
+        p++;
+        int sign = 1, power = 0;
+        if (*p == '+' || *p == '-') {
+            if (*p == '-') sign = -1;
+            p++;
+        }
+        for (; p < c; p++) {
+            if (power < 10000) power = power * 10 + (*p - '0');
+        }
+        shift += sign * power;
+    }
+    snprintf(text + length, sizeof(text) - length, "e%d", shift);
+    *value = strtod(text, NULL);
+    return true;
+}
+
+// Numero inteiro em [lo, hi]; fora disso o erro aponta para o numero
+static bool json_reader_int(JsonReader* r, int* value, int lo, int hi, const char* what) {
+    json_reader_skip_whitespace(r);
+    const char* text = r->cursor;
+    double number;
+    if (!json_reader_number(r, &number)) return false;
+    if (number != floor(number) || number < lo || number > hi) {
+        r->cursor = text;
+        json_reader_error(r, "%s invalido %g (esperado inteiro entre %d e %d)", what, number, lo, hi);
+        return false;
+    }
+    *value = (int)number;
+    return true;
+}
+
+static bool json_reader_skip_value(JsonReader* r);
+
+// Pula um objeto ou array inteiro (chaves/colchetes balanceados, strings respeitadas)
+static bool json_reader_skip_container(JsonReader* r) {
+    int depth = 0;
+    do {
+        char c = json_reader_peek(r);
+        if (c == '"') {
+            const char* text;
+            size_t length;
+            if (!json_reader_string(r, &text, &length)) return false;
+            continue;
+        }
+        if (c == '\0') {
+            json_reader_error(r, "fim do arquivo dentro de objeto ou array");
+            return false;
+        }
+        if (c == '{' || c == '[') depth++;
+        else if (c == '}' || c == ']') depth--;
+        r->cursor++;
+    } while (depth > 0);
+    return true;
+}
+
+static bool json_reader_skip_value(JsonReader* r) {
+    char c = json_reader_peek(r);
+    if (c == '{' || c == '[') return json_reader_skip_container(r);
+    if (c == '"') {
+        const char* text;
+        size_t length;
+        return json_reader_string(r, &text, &length);
+    }
+    if (c == '-' || (c >= '0' && c <= '9')) {
+        double ignored;
+        return json_reader_number(r, &ignored);
+    }
+    static const char* literals[] = {"true", "false", "null"};
+    for (int i = 0; i < 3; i++) {
+        size_t length = strlen(literals[i]);
+        if ((size_t)(r->end - r->cursor) >= length && memcmp(r->cursor, literals[i], length) == 0) {
+            r->cursor += length;
+            return true;
+        }
+    }
+    json_reader_error(r, "valor JSON invalido (encontrado %s)", json_reader_describe(r));
+    return false;
+}
 
-    #if DEBUG_CONCAVE_NESTING
-    int attempts = 0;
-    #endif
+// Iteracao de arrays/objetos: chamar com *first = true antes do primeiro
+// elemento; retorna false no fechamento (ou em erro)
+static bool json_reader_next(JsonReader* r, char close, bool* first) {
+    char c = json_reader_peek(r);
+    if (c == close) {
+        r->cursor++;
+        return false;
+    }
+    if (!*first) {
+        if (c != ',') {
+            json_reader_error(r, "esperado ',' ou '%c', encontrado %s", close, json_reader_describe(r));
+            return false;
+        }
+        r->cursor++;
+    }
+    *first = false;
+    return !r->failed;
+}
 
-    // CRITICAL: Use ONLY the piece's allowed rotation angles from input_shapes.json
-    // This respects the same constraints used by the genetic algorithm
-    int num_allowed_rotations = small_original->angle_count;
+// Proxima chave do objeto corrente (ja consome o ':'); false no '}'
+static bool json_reader_key(JsonReader* r, bool* first, const char** key, size_t* length) {
+    if (!json_reader_next(r, '}', first)) return false;
+    if (json_reader_peek(r) != '"') {
+        json_reader_error(r, "esperado nome de campo entre aspas, encontrado %s", json_reader_describe(r));
+        return false;
+    }
+    return json_reader_string(r, key, length) && json_reader_expect(r, ':');
+}
 
-    // Try each candidate point in the concavity
-    for (int pt_idx = 0; pt_idx < concavity->num_points; pt_idx++) {
-        Point candidate_pos = {concavity->points[pt_idx].x, concavity->points[pt_idx].y};
+static inline bool json_key_is(const char* key, size_t length, const char* name) {
+    return strlen(name) == length && memcmp(key, name, length) == 0;
+}
 
-        // Try ONLY allowed rotations for this piece (respects allowed_angles[])
-        for (int rot_idx = 0; rot_idx < num_allowed_rotations; rot_idx++) {
-            int test_angle = small_original->allowed_angles[rot_idx];
+// Normaliza a peca para min x/y = 0 e calcula bounding box e area
+static void finish_input_piece(Piece* piece) {
+    double min_x = piece->points[0].x, min_y = piece->points[0].y;
+    for (int i = 1; i < piece->point_count; i++) {
+        if (piece->points[i].x < min_x) min_x = piece->points[i].x;
+        if (piece->points[i].y < min_y) min_y = piece->points[i].y;
+    }
+    for (int i = 0; i < piece->point_count; i++) {
+        piece->points[i].x -= min_x;
+        piece->points[i].y -= min_y;
+    }
 
-            #if DEBUG_CONCAVE_NESTING
-            attempts++;
-            #endif
+    calculate_bounding_box_cached(piece);
+    piece->width = piece->max_x - piece->min_x;
+    piece->height = piece->max_y - piece->min_y;
+    piece->area = calculate_polygon_area(piece->points, piece->point_count);
+}
 
-            // Create rotated piece for testing
-            Piece test_rotated = rotate_piece(small_original, test_angle);
+#define MAX_PIECE_INSTANCES 1000000
 
-            // Test if piece fits at this position
-            // Need to temporarily remove the piece from board to avoid self-collision
-            int original_count = board->piece_count;
-            board->piece_count--;
+static inline int type_quantity(int type_id) {
+    return input_data.type_first[type_id + 1] - input_data.type_first[type_id];
+}
 
-            // Validate fit
-            bool fits = piece_fits_in_board(&test_rotated, candidate_pos, board);
+// input_data.pieces contem um registro por tipo; expande em quantities[t]
+// instancias por tipo. As copias compartilham points/allowed_angles do tipo
+// (liberados uma vez, pela primeira instancia) e recebem type_id = t.
+static bool expand_piece_types(const int* quantities, const char* filename) {
+    int type_count = input_data.piece_count;
+    long long total = 0;
+    for (int t = 0; t < type_count; t++) total += quantities[t];
+    if (total > MAX_PIECE_INSTANCES) {
+        printf("ERRO: %s tem %lld instancias de pecas (maximo %d)\n", filename, total, MAX_PIECE_INSTANCES);
+        return false;
+    }
 
-            // Restore board state
-            board->piece_count = original_count;
+    Piece* instances = malloc(sizeof(Piece) * (size_t)total);
+    input_data.type_first = malloc(sizeof(int) * (type_count + 1));
+    int count = 0;
+    for (int t = 0; t < type_count; t++) {
+        input_data.type_first[t] = count;
+        for (int k = 0; k < quantities[t]; k++) {
+            instances[count] = input_data.pieces[t];
+            instances[count].id = count;
+            instances[count].type_id = t;
+            count++;
+        }
+    }
+    input_data.type_first[type_count] = count;
+    free(input_data.pieces);
+    input_data.pieces = instances;
+    input_data.piece_count = count;
+    input_data.type_count = type_count;
+    return true;
+}
 
-            if (fits) {
-                // Success! Update the piece position
-                free(small_placed->rotated_piece.points);
-                small_placed->position = candidate_pos;
-                small_placed->angle = test_angle;
-                small_placed->rotated_piece = test_rotated;
+// Uma peca: {"angle": [...], "data": [[x, y], ...], "quantity": n} em qualquer ordem
+static bool parse_input_piece(JsonReader* r, Piece* piece, int* quantity) {
+    int point_capacity = 0, angle_capacity = 0;
+    bool has_data = false;
+    *quantity = 1;
+
+    if (!json_reader_expect(r, '{')) return false;
+    const char* key;
+    size_t key_length;
+    bool first = true;
+    while (json_reader_key(r, &first, &key, &key_length)) {
+        if (json_key_is(key, key_length, "angle")) {
+            if (!json_reader_expect(r, '[')) return false;
+            piece->angle_count = 0;
+            bool first_angle = true;
+            while (json_reader_next(r, ']', &first_angle)) {
+                double angle;
+                const char* angle_text = r->cursor;
+                if (!json_reader_number(r, &angle)) return false;
+                if (angle != floor(angle) || fabs(angle) > 3600) {
+                    r->cursor = angle_text;
+                    json_reader_error(r, "angulo invalido %g (esperado inteiro em graus)", angle);
+                    return false;
+                }
+                if (piece->angle_count == angle_capacity) {
+                    angle_capacity = angle_capacity ? angle_capacity * 2 : 4;
+                    piece->allowed_angles = realloc(piece->allowed_angles, sizeof(int) * angle_capacity);
+                }
+                piece->allowed_angles[piece->angle_count++] = (int)angle;
+            }
+        } else if (json_key_is(key, key_length, "data")) {
+            if (!json_reader_expect(r, '[')) return false;
+            has_data = true;
+            piece->point_count = 0;
+            bool first_point = true;
+            while (json_reader_next(r, ']', &first_point)) {
+                if (piece->point_count == point_capacity) {
+                    point_capacity = point_capacity ? point_capacity * 2 : 64;
+                    piece->points = realloc(piece->points, sizeof(Point) * point_capacity);
+                }
+                Point* point = &piece->points[piece->point_count];
+                if (!json_reader_expect(r, '[') || !json_reader_number(r, &point->x) ||
+                    !json_reader_expect(r, ',') || !json_reader_number(r, &point->y) ||
+                    !json_reader_expect(r, ']')) {
+                    return false;
+                }
+                piece->point_count++;
+            }
+        } else if (json_key_is(key, key_length, "quantity")) {
+            double value;
+            const char* quantity_text = r->cursor;
+            if (!json_reader_number(r, &value)) return false;
+            if (value != floor(value) || value < 1 || value > MAX_PIECE_INSTANCES) {
+                r->cursor = quantity_text;
+                json_reader_error(r, "quantidade invalida %g (esperado inteiro >= 1)", value);
+                return false;
+            }
+            *quantity = (int)value;
+        } else if (!json_reader_skip_value(r)) {
+            return false;
+        }
+    }
+    if (r->failed) return false;
 
-                #if DEBUG_CONCAVE_NESTING
-                printf("      [SUCESSO] Peca %d encaixada em (%.1f, %.1f) com rotacao %d graus\n",
-                       small_placed->piece_id, candidate_pos.x, candidate_pos.y, test_angle);
-                printf("                Tentativas: %d, Angulos permitidos para esta peca: %d\n",
-                       attempts, num_allowed_rotations);
-                #endif
+    if (!has_data || piece->point_count < 3) {
+        json_reader_error(r, "peca %d precisa de \"data\" com pelo menos 3 pontos", piece->id);
+        return false;
+    }
+    if (piece->angle_count == 0) {
+        // Sem "angle": apenas a orientacao original
+        piece->allowed_angles = realloc(piece->allowed_angles, sizeof(int));
+        piece->allowed_angles[0] = 0;
+        piece->angle_count = 1;
+    }
+    finish_input_piece(piece);
+    return true;
+}
 
-                return true;
-            } else {
-                // Try sub-grid refinement around this position
-                double step_size = min_double(large_piece->width, large_piece->height) / (GRID_RESOLUTION * 2.0);
-
-                for (int sub_x = -SUBGRID_RESOLUTION/2; sub_x <= SUBGRID_RESOLUTION/2; sub_x++) {
-                    for (int sub_y = -SUBGRID_RESOLUTION/2; sub_y <= SUBGRID_RESOLUTION/2; sub_y++) {
-                        if (sub_x == 0 && sub_y == 0) continue; // Already tested
-
-                        Point refined_pos = {
-                            candidate_pos.x + sub_x * step_size,
-                            candidate_pos.y + sub_y * step_size
-                        };
-
-                        board->piece_count--;
-                        bool refined_fits = piece_fits_in_board(&test_rotated, refined_pos, board);
-                        board->piece_count = original_count;
-
-                        if (refined_fits) {
-                            // Found better position with sub-grid refinement!
-                            free(small_placed->rotated_piece.points);
-                            small_placed->position = refined_pos;
-                            small_placed->angle = test_angle;
-                            small_placed->rotated_piece = test_rotated;
-
-                            #if DEBUG_CONCAVE_NESTING
-                            printf("      [SUCESSO - REFINADO] Peca %d encaixada em (%.1f, %.1f) com rotacao %d graus\n",
-                                   small_placed->piece_id, refined_pos.x, refined_pos.y, test_angle);
-                            printf("                           Ajuste sub-grid: (%d, %d) offset=(%.1f, %.1f)\n",
-                                   sub_x, sub_y, sub_x * step_size, sub_y * step_size);
-                            #endif
-
-                            return true;
-                        }
-                    }
+static bool parse_input_document(JsonReader* r, int** quantities) {
+    enum { FIELD_BOARD_X = 1, FIELD_BOARD_Y = 2, FIELD_BOARD_MARGIN = 4, FIELD_PIECE_GAP = 8, FIELD_PIECES = 16 };
+    static const char* field_names[] = {
+        "board_x", "board_y", "distance_between_boards", "distance_between_peaces", "peaces"
+    };
+    int seen = 0;
+    int piece_capacity = 0;
+
+    if (!json_reader_expect(r, '{')) return false;
+    const char* key;
+    size_t key_length;
+    bool first = true;
+    while (json_reader_key(r, &first, &key, &key_length)) {
+        if (json_key_is(key, key_length, "board_x")) {
+            if (!json_reader_number(r, &input_data.board_x)) return false;
+            seen |= FIELD_BOARD_X;
+        } else if (json_key_is(key, key_length, "board_y")) {
+            if (!json_reader_number(r, &input_data.board_y)) return false;
+            seen |= FIELD_BOARD_Y;
+        } else if (json_key_is(key, key_length, "distance_between_boards")) {
+            if (!json_reader_number(r, &input_data.distance_between_boards)) return false;
+            seen |= FIELD_BOARD_MARGIN;
+        } else if (json_key_is(key, key_length, "distance_between_peaces") ||
+                   json_key_is(key, key_length, "distance_between_pieces")) {
+            if (!json_reader_number(r, &input_data.distance_between_pieces)) return false;
+            seen |= FIELD_PIECE_GAP;
+        } else if (json_key_is(key, key_length, "peaces") || json_key_is(key, key_length, "pieces")) {
+            if (!json_reader_expect(r, '[')) return false;
+            seen |= FIELD_PIECES;
+            bool first_piece = true;
+            while (json_reader_next(r, ']', &first_piece)) {
+                // Tamanhos dinamicos: vetores dobram de capacidade conforme necessario
+                if (input_data.piece_count == piece_capacity) {
+                    piece_capacity = piece_capacity ? piece_capacity * 2 : 16;
+                    input_data.pieces = realloc(input_data.pieces, sizeof(Piece) * piece_capacity);
+                    *quantities = realloc(*quantities, sizeof(int) * piece_capacity);
                 }
-
-                // Clean up test rotation
-                free(test_rotated.points);
+                Piece* piece = &input_data.pieces[input_data.piece_count];
+                memset(piece, 0, sizeof(*piece));
+                piece->id = input_data.piece_count;
+                piece->shape_id = -1;
+                int* quantity = &(*quantities)[input_data.piece_count];
+                input_data.piece_count++;   // Contada ja: liberada junto em caso de erro
+                if (!parse_input_piece(r, piece, quantity)) return false;
             }
+        } else if (!json_reader_skip_value(r)) {
+            return false;
         }
     }
+    if (r->failed) return false;
 
-    #if DEBUG_CONCAVE_NESTING
-    printf("      [FALHA] Peca %d nao encaixou apos %d tentativas\n",
-           small_placed->piece_id, attempts);
-    printf("              Angulos permitidos testados: %d, Pontos candidatos testados: %d\n",
-           num_allowed_rotations, concavity->num_points);
-    #endif
+    if (json_reader_peek(r) != '\0') {
+        json_reader_error(r, "conteudo apos o fim do objeto principal");
+        return false;
+    }
+    for (int i = 0; i < 5; i++) {
+        if (!(seen & (1 << i))) {
+            json_reader_error(r, "campo obrigatorio \"%s\" ausente", field_names[i]);
+            return false;
+        }
+    }
+    if (input_data.piece_count == 0) {
+        json_reader_error(r, "\"peaces\" nao contem pecas");
+        return false;
+    }
+    return true;
+}
 
-    return false;
+static bool parse_input_json(const MappedFile* mapped, const char* filename) {
+    JsonReader reader = {mapped->data, mapped->data, mapped->data + mapped->size, false, ""};
+    input_data.pieces = NULL;
+    input_data.piece_count = 0;
+    int* quantities = NULL;
+    bool ok = parse_input_document(&reader, &quantities);
+    if (!ok) printf("ERRO: JSON invalido em %s, %s\n", filename, reader.error);
+    else ok = expand_piece_types(quantities, filename);
+    free(quantities);
+
+    if (!ok) {
+        for (int i = 0; i < input_data.piece_count; i++) {
+            free(input_data.pieces[i].points);
+            free(input_data.pieces[i].allowed_angles);
+        }
+        free(input_data.pieces);
+        input_data.pieces = NULL;
+        input_data.piece_count = 0;
+    }
+    return ok;
 }
 
-/**
- * Main optimization function for concave nesting (Phase 3).
- * Identifies large pieces with concavities and attempts to fit smaller pieces inside.
- */
-void optimize_concave_nesting(Board* board) {
-    printf("Analisando concavidades...\n");
+// Escritor JSON em streaming para o resultado: bytes acumulados num buffer e
+// gravados em blocos com fwrite. Numeros formatados sem printf no caso comum
+// (independente do locale) com a menor representacao que volta ao mesmo
+// double. Modo pretty (indentado, vertices [x, y] numa linha) ou compacto.
 
-    // Track statistics
-    int large_pieces_found = 0;
-    int repositioning_attempts = 0;
-    int successful_repositions = 0;
+static bool output_compact = false;          // --compact-output
+static bool output_transforms_only = false;  // --transforms-only: sem "data"
 
-    // Phase 1: Identify large pieces with concavities
-    typedef struct {
-        int piece_idx;
-        double concavity_ratio;
-        double area;
-    } LargePiece;
+#define JSON_WRITER_BUFFER (64 * 1024)
+#define JSON_WRITER_MAX_DEPTH 16
 
-    LargePiece* large_pieces = malloc(sizeof(LargePiece) * board->piece_count);
-    int large_count = 0;
+typedef struct {
+    FILE* file;
+    char* buffer;
+    size_t length;
+    bool pretty;
+    bool failed;
+    bool after_key;                              // Proximo valor segue "chave":
+    int depth;
+    bool has_items[JSON_WRITER_MAX_DEPTH];       // Nivel ja tem elementos (precisa de virgula)
+    bool single_line[JSON_WRITER_MAX_DEPTH];     // Nivel escrito numa linha no modo pretty
+} JsonWriter;
+
+static const double json_pow10[] = {1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9};
+
+// Menor texto decimal que volta ao mesmo double; retorna o comprimento
+static int json_format_double(double value, char* out) {
+    if (!isfinite(value)) {
+        memcpy(out, "null", 5);
+        return 4;
+    }
+    if (value == 0.0) {
+        memcpy(out, "0", 2);
+        return 1;
+    }
 
-    for (int i = 0; i < board->piece_count; i++) {
-        PlacedPiece* placed = &board->placed_pieces[i];
-        Piece* piece = &placed->rotated_piece;
+    // Caminho rapido: |v| = n / 10^d com n < 2^53 e d <= 9 (coordenadas, areas,
+    // porcentagens). A divisao e corretamente arredondada, entao o texto com o
+    // menor d que reproduz v volta exatamente a v.
+    double magnitude = fabs(value);
+    if (magnitude < 1e15) {
+        for (int d = 0; d < (int)(sizeof(json_pow10) / sizeof(json_pow10[0])); d++) {
+            double scaled = floor(magnitude * json_pow10[d] + 0.5);
+            if (scaled >= 9007199254740992.0) break;
+            if (scaled / json_pow10[d] != magnitude) continue;
+
+            char digits[24];
+            int count = 0;
+            uint64_t n = (uint64_t)scaled;
+            do {
+                digits[count++] = (char)('0' + n % 10);
+                n /= 10;
+            } while (n > 0);
+            while (count <= d) digits[count++] = '0';   // Zero antes do ponto
+
+            int len = 0;
+            if (value < 0) out[len++] = '-';
+            for (int i = count - 1; i >= 0; i--) {
+                out[len++] = digits[i];
+                if (i == d && d > 0) out[len++] = '.';
+            }
+            out[len] = '\0';
+            return len;
+        }
+    }
 
-        double ratio = calculate_concavity_ratio(piece);
+    // Caso geral: menor precisao de %g que volta ao mesmo valor
+    int len = 0;
+    for (int precision = 15; precision <= 17; precision++) {
+        len = snprintf(out, 32, "%.*g", precision, value);
+        if (precision == 17 || strtod(out, NULL) == value) break;
+    }
+    // printf usa o separador decimal do locale; JSON exige '.'
+    for (char* c = out; *c; c++) {
+        if (*c != '-' && *c != '+' && *c != 'e' && (*c < '0' || *c > '9')) *c = '.';
+    }
+    return len;
+}
 
-        if (ratio >= CONCAVITY_THRESHOLD) {
-            large_pieces[large_count].piece_idx = i;
-            large_pieces[large_count].concavity_ratio = ratio;
-            large_pieces[large_count].area = piece->area;
-            large_count++;
-            large_pieces_found++;
+static void json_flush(JsonWriter* w) {
+    if (w->length > 0 && fwrite(w->buffer, 1, w->length, w->file) != w->length) w->failed = true;
+    w->length = 0;
+}
+
+static void json_put(JsonWriter* w, const char* text, size_t length) {
+    if (w->length + length > JSON_WRITER_BUFFER) {
+        json_flush(w);
+        if (length > JSON_WRITER_BUFFER) {
+            if (fwrite(text, 1, length, w->file) != length) w->failed = true;
+            return;
         }
     }
+    memcpy(w->buffer + w->length, text, length);
+    w->length += length;
+}
 
-    printf("  Encontradas %d pecas com concavidades significativas (>%.0f%%)\n",
-           large_pieces_found, CONCAVITY_THRESHOLD * 100);
+static void json_put_char(JsonWriter* w, char c) {
+    if (w->length == JSON_WRITER_BUFFER) json_flush(w);
+    w->buffer[w->length++] = c;
+}
 
-    if (large_count == 0) {
-        free(large_pieces);
-        printf("  Nenhuma otimizacao possivel.\n");
+// Virgula e quebra de linha/indentacao antes de um elemento
+static void json_separator(JsonWriter* w) {
+    if (w->after_key) {
+        w->after_key = false;
         return;
     }
+    if (w->depth == 0) return;
+    bool first = !w->has_items[w->depth];
+    if (!first) json_put_char(w, ',');
+    w->has_items[w->depth] = true;
+    if (!w->pretty) return;
+    if (w->single_line[w->depth]) {
+        if (!first) json_put_char(w, ' ');
+        return;
+    }
+    json_put_char(w, '\n');
+    for (int i = 0; i < w->depth; i++) json_put(w, "  ", 2);
+}
 
-    // Sort large pieces by concavity ratio (descending)
-    for (int i = 0; i < large_count - 1; i++) {
-        for (int j = 0; j < large_count - i - 1; j++) {
-            if (large_pieces[j].concavity_ratio < large_pieces[j + 1].concavity_ratio) {
-                LargePiece temp = large_pieces[j];
-                large_pieces[j] = large_pieces[j + 1];
-                large_pieces[j + 1] = temp;
-            }
+static void json_begin(JsonWriter* w, char open, bool single_line) {
+    json_separator(w);
+    json_put_char(w, open);
+    if (w->depth + 1 >= JSON_WRITER_MAX_DEPTH) {
+        w->failed = true;
+        return;
+    }
+    bool parent_single = w->depth > 0 && w->single_line[w->depth];
+    w->depth++;
+    w->has_items[w->depth] = false;
+    w->single_line[w->depth] = single_line || parent_single;
+}
+
+static void json_end(JsonWriter* w, char close) {
+    bool newline = w->pretty && w->has_items[w->depth] && !w->single_line[w->depth];
+    w->depth--;
+    if (newline) {
+        json_put_char(w, '\n');
+        for (int i = 0; i < w->depth; i++) json_put(w, "  ", 2);
+    }
+    json_put_char(w, close);
+}
+
+#define json_begin_object(w) json_begin(w, '{', false)
+#define json_end_object(w) json_end(w, '}')
+#define json_begin_array(w) json_begin(w, '[', false)
+#define json_end_array(w) json_end(w, ']')
+
+static void json_string(JsonWriter* w, const char* text) {
+    json_separator(w);
+    json_put_char(w, '"');
+    for (const char* c = text; *c; c++) {
+        if (*c == '"' || *c == '\\') {
+            json_put_char(w, '\\');
+            json_put_char(w, *c);
+        } else if ((unsigned char)*c < 0x20) {
+            char escape[8];
+            json_put(w, escape, snprintf(escape, sizeof(escape), "\\u%04x", (unsigned char)*c));
+        } else {
+            json_put_char(w, *c);
         }
     }
+    json_put_char(w, '"');
+}
 
-    // Calculate initial efficiency
-    double initial_efficiency = board->efficiency;
+static void json_key(JsonWriter* w, const char* name) {
+    json_string(w, name);
+    json_put_char(w, ':');
+    if (w->pretty) json_put_char(w, ' ');
+    w->after_key = true;
+}
 
-    // Phase 2: For each large piece, try to fit small pieces in concavity
-    for (int lp_idx = 0; lp_idx < large_count; lp_idx++) {
-        int large_idx = large_pieces[lp_idx].piece_idx;
-        PlacedPiece* large_placed = &board->placed_pieces[large_idx];
+static void json_int(JsonWriter* w, long long value) {
+    json_separator(w);
+    char digits[24];
+    int count = 0;
+    unsigned long long n = value < 0 ? 0ULL - (unsigned long long)value : (unsigned long long)value;
+    do {
+        digits[count++] = (char)('0' + n % 10);
+        n /= 10;
+    } while (n > 0);
+    if (value < 0) json_put_char(w, '-');
+    while (count > 0) json_put_char(w, digits[--count]);
+}
 
-        printf("  Analisando peca %d (concavidade: %.1f%%, area: %.0f)...\n",
-               large_placed->piece_id,
-               large_pieces[lp_idx].concavity_ratio * 100,
-               large_pieces[lp_idx].area);
+static void json_double(JsonWriter* w, double value) {
+    json_separator(w);
+    char text[32];
+    json_put(w, text, json_format_double(value, text));
+}
 
-        // Sample concave regions
-        ConcavityInfo* concavity = sample_concave_regions(&large_placed->rotated_piece,
-                                                          large_placed,
-                                                          GRID_RESOLUTION);
+static bool json_writer_init(JsonWriter* w, FILE* file, bool pretty) {
+    memset(w, 0, sizeof(*w));
+    w->file = file;
+    w->pretty = pretty;
+    w->buffer = malloc(JSON_WRITER_BUFFER);
+    return w->buffer != NULL;
+}
 
-        if (!concavity) {
-            printf("    Nao foi possivel amostrar pontos candidatos.\n");
-            continue;
-        }
+// Grava o restante do buffer; retorna false se alguma escrita falhou
+static bool json_writer_finish(JsonWriter* w) {
+    json_put_char(w, '\n');
+    json_flush(w);
+    free(w->buffer);
+    w->buffer = NULL;
+    return !w->failed;
+}
 
-        printf("    Encontrados %d pontos candidatos na concavidade.\n", concavity->num_points);
+// Escrita atomica: grava em <arquivo>.tmp e renomeia por cima do destino,
+// entao leitores nunca veem um arquivo pela metade
+static FILE* atomic_write_open(const char* filename, char* temp_path, size_t temp_size) {
+    snprintf(temp_path, temp_size, "%s.tmp", filename);
 
-        // Find small pieces to try (area < MAX_SMALL_PIECE_RATIO * large_area)
-        typedef struct { int idx; double area; } SmallPiece;
-        SmallPiece* small_pieces = malloc(sizeof(SmallPiece) * board->piece_count);
-        int small_count = 0;
+    // CORRIGIDO: Usar modo "wb" para garantir escrita binaria consistente
+    FILE* file = fopen(temp_path, "wb");
+    if (!file) {
+        printf("ERRO: Nao foi possivel criar/escrever o arquivo %s\n", temp_path);
+        printf("Detalhes: ");
+
+        #ifdef _WIN32
+            DWORD error = GetLastError();
+            if (error == ERROR_ACCESS_DENIED) {
+                printf("Acesso negado. Verifique permissoes de escrita.\n");
+            } else if (error == ERROR_PATH_NOT_FOUND) {
+                printf("Caminho nao encontrado.\n");
+            } else {
+                printf("Codigo de erro Windows: %lu\n", error);
+            }
+        #else
+            printf("%s\n", strerror(errno));
+        #endif
+    }
+    return file;
+}
 
-        double max_small_area = large_pieces[lp_idx].area * MAX_SMALL_PIECE_RATIO;
+// Fecha o temporario e, se tudo foi escrito ('ok'), renomeia sobre o destino
+static bool atomic_write_commit(FILE* file, bool ok, const char* temp_path, const char* filename) {
+    bool write_failed = !ok || ferror(file) != 0;
+    if (fclose(file) != 0) write_failed = true;
+    if (write_failed) {
+        printf("ERRO: Falha ao escrever %s\n", temp_path);
+        remove(temp_path);
+        return false;
+    }
 
-        for (int i = 0; i < board->piece_count; i++) {
-            if (i == large_idx) continue; // Skip self
+    #ifdef _WIN32
+        bool renamed = MoveFileExA(temp_path, filename, MOVEFILE_REPLACE_EXISTING) != 0;
+    #else
+        bool renamed = rename(temp_path, filename) == 0;
+    #endif
+    if (!renamed) {
+        printf("ERRO: Nao foi possivel substituir %s\n", filename);
+        remove(temp_path);
+    }
+    return renamed;
+}
 
-            PlacedPiece* placed = &board->placed_pieces[i];
-            Piece* original = &input_data.pieces[placed->piece_id];
+bool write_output_json(const char* filename) {
+    char temp_path[512];
+    FILE* file = atomic_write_open(filename, temp_path, sizeof(temp_path));
+    if (!file) return false;
 
-            if (original->area <= max_small_area) {
-                small_pieces[small_count].idx = i;
-                small_pieces[small_count].area = original->area;
-                small_count++;
-            }
-        }
+    JsonWriter writer;
+    if (!json_writer_init(&writer, file, !output_compact)) {
+        printf("ERRO: Falha ao alocar buffer de escrita para %s\n", temp_path);
+        fclose(file);
+        remove(temp_path);
+        return false;
+    }
+    JsonWriter* w = &writer;
+
+    json_begin_object(w);
+    json_key(w, "board_count");
+    json_int(w, best_result.board_count);
+    json_key(w, "board_x");
+    json_double(w, input_data.board_x);
+    json_key(w, "board_y");
+    json_double(w, input_data.board_y);
+    json_key(w, "total_efficiency");
+    json_double(w, best_result.total_efficiency);
+    json_key(w, "execution_time");
+    json_double(w, best_result.execution_time);
+    if (output_transforms_only) {
+        // Vertices: pontos da entrada transladados para min x/y = 0, rotacionados
+        // (anti-horario) em torno da media dos vertices, + (position_x, position_y)
+        json_key(w, "geometry");
+        json_string(w, "transforms");
+    }
+    json_key(w, "boards");
+    json_begin_array(w);
 
-        printf("    Encontradas %d pecas pequenas candidatas (area < %.0f).\n",
-               small_count, max_small_area);
+    for (int i = 0; i < best_result.board_count; i++) {
+        Board* board = &best_result.boards[i];
+        json_begin_object(w);
+        json_key(w, "board_id");
+        json_int(w, i);
+        json_key(w, "efficiency");
+        json_double(w, board->efficiency);
+        json_key(w, "piece_count");
+        json_int(w, board->piece_count);
+        json_key(w, "pieces");
+        json_begin_array(w);
 
-        // Sort small pieces by area (ascending - smallest first)
-        for (int i = 0; i < small_count - 1; i++) {
-            for (int j = 0; j < small_count - i - 1; j++) {
-                if (small_pieces[j].area > small_pieces[j + 1].area) {
-                    SmallPiece temp = small_pieces[j];
-                    small_pieces[j] = small_pieces[j + 1];
-                    small_pieces[j + 1] = temp;
+        for (int j = 0; j < board->piece_count; j++) {
+            PlacedPiece* piece = &board->placed_pieces[j];
+            json_begin(w, '{', output_transforms_only);
+            // piece_id e o tipo da entrada; "instance" distingue copias do tipo
+            int type_id = input_data.pieces[piece->piece_id].type_id;
+            json_key(w, "piece_id");
+            json_int(w, type_id);
+            if (type_quantity(type_id) > 1) {
+                json_key(w, "instance");
+                json_int(w, piece->piece_id - input_data.type_first[type_id]);
+            }
+            json_key(w, "position_x");
+            json_double(w, piece->position.x);
+            json_key(w, "position_y");
+            json_double(w, piece->position.y);
+            json_key(w, "angle");
+            json_int(w, piece->angle);
+
+            if (!output_transforms_only) {
+                Piece* outline = shape_exact_piece(piece->rotated_piece->shape_id);
+                json_key(w, "data");
+                json_begin_array(w);
+                for (int k = 0; k < outline->point_count; k++) {
+                    json_begin(w, '[', true);
+                    json_double(w, outline->points[k].x + piece->position.x);
+                    json_double(w, outline->points[k].y + piece->position.y);
+                    json_end_array(w);
                 }
+                json_end_array(w);
             }
+            json_end_object(w);
         }
 
-        // Try to fit small pieces
-        for (int sp_idx = 0; sp_idx < small_count; sp_idx++) {
-            int small_idx = small_pieces[sp_idx].idx;
-            repositioning_attempts++;
+        json_end_array(w);
+        json_end_object(w);
+    }
 
-            #if DEBUG_CONCAVE_NESTING
-            printf("    Tentando encaixar peca %d (area=%.0f, %.1f%% da peca grande)...\n",
-                   board->placed_pieces[small_idx].piece_id,
-                   small_pieces[sp_idx].area,
-                   (small_pieces[sp_idx].area / large_pieces[lp_idx].area) * 100.0);
-            #endif
+    json_end_array(w);
+    json_end_object(w);
 
-            if (try_fit_in_concavity(board, small_idx, concavity, &large_placed->rotated_piece)) {
-                successful_repositions++;
-                #if !DEBUG_CONCAVE_NESTING
-                printf("      [OK] Peca %d reposicionada na concavidade!\n",
-                       board->placed_pieces[small_idx].piece_id);
-                #endif
-            }
-        }
+    return atomic_write_commit(file, json_writer_finish(w), temp_path, filename);
+}
 
-        free(small_pieces);
-        free(concavity->points);
-        free(concavity);
-    }
+// ==================== FORMATO BINARIO ====================
+// Instancias e resultados em binario little-endian versionado, para recarga
+// sem parse: o arquivo e mapeado e a geometria usada direto do mapeamento.
+// Todas as secoes comecam em deslocamentos multiplos de 8 a partir do inicio
+// do arquivo. O formato e escolhido pelo conteudo na leitura (magic) e pela
+// extensao na escrita: caminhos terminados em ".bin" sao binarios, o resto JSON.
+//
+// Instancia: BinaryInstanceHeader, BinaryPieceRecord[piece_count] (um por tipo),
+//            double[2 * point_count] (x, y, ja com min x/y = 0), int32[angle_count]
+// Resultado: BinaryResultHeader, BinaryBoardRecord[board_count],
+//            BinaryPlacement[placement_count] (vertices: ver --transforms-only;
+//            piece_id e o indice da instancia: tipos expandidos em ordem)
+
+#define BINARY_INSTANCE_MAGIC "NESTINST"
+#define BINARY_RESULT_MAGIC "NESTRSLT"
+#define BINARY_FORMAT_VERSION 1
 
-    free(large_pieces);
+typedef struct {
+    char magic[8];
+    uint32_t version;
+    uint32_t header_size;
+    uint32_t piece_count;
+    uint32_t flags;                 // Reservado para secoes opcionais (0)
+    uint64_t point_count;
+    uint64_t angle_count;
+    uint64_t pieces_offset;
+    uint64_t points_offset;
+    uint64_t angles_offset;
+    double board_x, board_y;
+    double distance_between_boards;
+    double distance_between_pieces;
+} BinaryInstanceHeader;
 
-    // Recalculate board efficiency after optimization
-    double board_area = board->width * board->height;
-    board->efficiency = (board->used_area / board_area) * 100.0;
+typedef struct {
+    uint64_t first_point;
+    uint32_t point_count;
+    uint32_t first_angle;
+    uint32_t angle_count;
+    uint32_t quantity;              // Instancias do tipo (0 equivale a 1)
+    double area;
+    double min_x, min_y, max_x, max_y;
+} BinaryPieceRecord;
 
-    printf("\nResultados da otimizacao de concavidades:\n");
-    printf("  Pecas com concavidades analisadas: %d\n", large_pieces_found);
-    printf("  Tentativas de reposicionamento: %d\n", repositioning_attempts);
-    printf("  Reposicionamentos bem-sucedidos: %d\n", successful_repositions);
+typedef struct {
+    char magic[8];
+    uint32_t version;
+    uint32_t header_size;
+    uint32_t board_count;
+    uint32_t placement_count;
+    uint64_t boards_offset;
+    uint64_t placements_offset;
+    double board_x, board_y;
+    double total_efficiency;
+    double execution_time;
+} BinaryResultHeader;
 
-    if (repositioning_attempts > 0) {
-        printf("  Taxa de sucesso: %.1f%%\n",
-               (successful_repositions * 100.0) / repositioning_attempts);
-    }
+typedef struct {
+    uint32_t first_placement;
+    uint32_t placement_count;
+    double used_area;
+    double efficiency;
+} BinaryBoardRecord;
 
-    printf("  Eficiencia inicial: %.2f%%\n", initial_efficiency);
-    printf("  Eficiencia final: %.2f%%\n", board->efficiency);
+typedef struct {
+    int32_t piece_id;
+    int32_t angle;
+    double x, y;
+} BinaryPlacement;
 
-    if (board->efficiency > initial_efficiency) {
-        printf("  Melhoria: +%.2f%%\n", board->efficiency - initial_efficiency);
-    } else if (board->efficiency < initial_efficiency) {
-        printf("  [AVISO] Eficiencia reduziu em %.2f%% (possivel bug)\n",
-               initial_efficiency - board->efficiency);
-    } else {
-        printf("  Nenhuma melhoria alcancada nesta placa.\n");
-    }
-}
+// Layout fixo: os registros sao lidos do mapeamento sem conversao
+typedef char binary_layout_check[(sizeof(BinaryInstanceHeader) == 96 && sizeof(BinaryPieceRecord) == 64 &&
+                                  sizeof(BinaryResultHeader) == 72 && sizeof(BinaryBoardRecord) == 24 &&
+                                  sizeof(BinaryPlacement) == 24 && sizeof(Point) == 16 &&
+                                  sizeof(int) == 4) ? 1 : -1];
 
-#endif // ENABLE_CONCAVE_NESTING
+static char convert_instance_path[256] = "";
+static char convert_result_path[256] = "";
 
-// ==================== PARSING AND OUTPUT ====================
+static MappedFile input_mapping;          // Mantido aberto enquanto a geometria vem do binario
+static bool input_geometry_mapped = false;
 
-char* read_file(const char* filename) {
-    // CORRIGIDO: Usar modo binario "rb" para evitar problemas com conversao CRLF no Windows
-    // Isso garante que ftell() retorna o tamanho exato do arquivo
-    FILE* file = fopen(filename, "rb");
-    if (!file) {
-        // CORRIGIDO: Fornecer diagnostico detalhado do erro
-        printf("ERRO ao abrir arquivo: %s\n", filename);
-        printf("Detalhes: ");
+static bool binary_host_supported() {
+    uint16_t probe = 1;
+    if (*(uint8_t*)&probe == 1) return true;
+    printf("ERRO: Formato binario requer uma maquina little-endian\n");
+    return false;
+}
 
-        #ifdef _WIN32
-            // Windows: verificar se o arquivo existe
-            DWORD attrs = GetFileAttributesA(filename);
-            if (attrs == INVALID_FILE_ATTRIBUTES) {
-                DWORD error = GetLastError();
-                if (error == ERROR_FILE_NOT_FOUND) {
-                    printf("Arquivo nao encontrado.\n");
-                } else if (error == ERROR_PATH_NOT_FOUND) {
-                    printf("Caminho nao encontrado.\n");
-                } else if (error == ERROR_ACCESS_DENIED) {
-                    printf("Acesso negado (permissao).\n");
-                } else {
-                    printf("Codigo de erro Windows: %lu\n", error);
-                }
-            }
-        #else
-            // Linux/Unix: usar errno para diagnostico
-            printf("%s\n", strerror(errno));
-        #endif
+static bool path_is_binary(const char* path) {
+    size_t length = strlen(path);
+    return length >= 4 && strcmp(path + length - 4, ".bin") == 0;
+}
 
-        // Mostrar diretorio de trabalho atual para debug
-        char cwd[1024];
-        #ifdef _WIN32
-            GetCurrentDirectoryA(sizeof(cwd), cwd);
-        #else
-            if (getcwd(cwd, sizeof(cwd)) == NULL) {
-                strcpy(cwd, "(nao foi possivel determinar)");
-            }
-        #endif
-        printf("Diretorio de trabalho atual: %s\n", cwd);
-        printf("\nVERIFIQUE:\n");
-        printf("1. O arquivo '%s' existe no mesmo diretorio que o executavel?\n", filename);
-        printf("2. O nome do arquivo esta correto (maiusculas/minusculas)?\n");
-        printf("3. Voce esta executando o programa do diretorio correto?\n");
-        printf("\n");
+static inline uint64_t binary_align(uint64_t offset) {
+    return (offset + 7) & ~(uint64_t)7;
+}
+
+// Secao [offset, offset + count * size) dentro do arquivo e alinhada
+static bool binary_section_ok(const MappedFile* mapped, uint64_t offset, uint64_t count, size_t size) {
+    if (offset % 8 != 0 || offset > mapped->size) return false;
+    return count <= (mapped->size - offset) / size;
+}
 
-        return NULL;
+static void free_input_data() {
+    if (!input_geometry_mapped) {
+        // Instancias do mesmo tipo compartilham a geometria da primeira
+        for (int t = 0; t < input_data.type_count; t++) {
+            Piece* piece = &input_data.pieces[input_data.type_first[t]];
+            free(piece->points);
+            free(piece->allowed_angles);
+        }
+    } else {
+        mapped_file_close(&input_mapping);
+        input_geometry_mapped = false;
     }
+    free(input_data.pieces);
+    free(input_data.type_first);
+    input_data.pieces = NULL;
+    input_data.type_first = NULL;
+    input_data.piece_count = 0;
+    input_data.type_count = 0;
+}
 
-    // CORRIGIDO: Verificar se fseek foi bem-sucedido
-    if (fseek(file, 0, SEEK_END) != 0) {
-        printf("ERRO: Falha ao posicionar no final do arquivo %s\n", filename);
-        fclose(file);
-        return NULL;
+static bool binary_instance_load(MappedFile* mapped, const char* filename) {
+    if (!binary_host_supported()) return false;
+    const BinaryInstanceHeader* header = (const BinaryInstanceHeader*)mapped->data;
+    const char* error = NULL;
+    if (mapped->size < sizeof(BinaryInstanceHeader)) error = "cabecalho truncado";
+    else if (header->version != BINARY_FORMAT_VERSION) error = "versao nao suportada";
+    else if (header->header_size < sizeof(BinaryInstanceHeader)) error = "tamanho de cabecalho invalido";
+    else if (header->piece_count == 0 || header->piece_count > INT_MAX) error = "numero de pecas invalido";
+    else if (!binary_section_ok(mapped, header->pieces_offset, header->piece_count, sizeof(BinaryPieceRecord)))
+        error = "secao de pecas fora do arquivo";
+    else if (!binary_section_ok(mapped, header->points_offset, header->point_count, sizeof(Point)))
+        error = "secao de vertices fora do arquivo";
+    else if (!binary_section_ok(mapped, header->angles_offset, header->angle_count, sizeof(int32_t)))
+        error = "secao de angulos fora do arquivo";
+    if (error) {
+        printf("ERRO: Instancia binaria invalida em %s: %s\n", filename, error);
+        return false;
     }
 
-    long size = ftell(file);
-    if (size < 0) {
-        printf("ERRO: Falha ao obter tamanho do arquivo %s\n", filename);
-        fclose(file);
-        return NULL;
+    const BinaryPieceRecord* records = (const BinaryPieceRecord*)(mapped->data + header->pieces_offset);
+    Point* points = (Point*)(mapped->data + header->points_offset);
+    int* angles = (int*)(mapped->data + header->angles_offset);
+    for (uint32_t i = 0; i < header->piece_count; i++) {
+        const BinaryPieceRecord* record = &records[i];
+        if (record->point_count < 3 || record->first_point > header->point_count ||
+            record->point_count > header->point_count - record->first_point ||
+            record->angle_count == 0 || record->first_angle > header->angle_count ||
+            record->angle_count > header->angle_count - record->first_angle) {
+            printf("ERRO: Instancia binaria invalida em %s: peca %u fora das secoes\n", filename, i);
+            return false;
+        }
     }
 
-    if (fseek(file, 0, SEEK_SET) != 0) {
-        printf("ERRO: Falha ao retornar ao inicio do arquivo %s\n", filename);
-        fclose(file);
-        return NULL;
+    input_data.board_x = header->board_x;
+    input_data.board_y = header->board_y;
+    input_data.distance_between_boards = header->distance_between_boards;
+    input_data.distance_between_pieces = header->distance_between_pieces;
+    input_data.piece_count = (int)header->piece_count;
+    input_data.pieces = calloc(input_data.piece_count, sizeof(Piece));
+    int* quantities = malloc(sizeof(int) * input_data.piece_count);
+    for (int i = 0; i < input_data.piece_count; i++) {
+        const BinaryPieceRecord* record = &records[i];
+        Piece* piece = &input_data.pieces[i];
+        piece->id = i;
+        piece->shape_id = -1;
+        piece->points = points + record->first_point;
+        piece->point_count = (int)record->point_count;
+        piece->allowed_angles = angles + record->first_angle;
+        piece->angle_count = (int)record->angle_count;
+        // Area e bbox vem dos vertices; o registro so e conferido, para que
+        // um arquivo inconsistente nao passe despercebido
+        calculate_bounding_box_cached(piece);
+        piece->width = piece->max_x - piece->min_x;
+        piece->height = piece->max_y - piece->min_y;
+        piece->area = calculate_polygon_area(piece->points, piece->point_count);
+        double tolerance = 1e-9 * (1.0 + fabs(piece->min_x) + fabs(piece->max_x) +
+                                   fabs(piece->min_y) + fabs(piece->max_y));
+        if (!isfinite(piece->area) || !isfinite(piece->width) || !isfinite(piece->height) ||
+            fabs(piece->area - record->area) > tolerance * (1.0 + piece->width + piece->height) ||
+            fabs(piece->min_x - record->min_x) > tolerance || fabs(piece->max_x - record->max_x) > tolerance ||
+            fabs(piece->min_y - record->min_y) > tolerance || fabs(piece->max_y - record->max_y) > tolerance) {
+            printf("ERRO: Instancia binaria invalida em %s: area ou bbox da peca %d nao confere com os vertices\n",
+                   filename, i);
+            free(input_data.pieces);
+            free(quantities);
+            input_data.pieces = NULL;
+            input_data.piece_count = 0;
+            return false;
+        }
+        if (record->quantity == 0) quantities[i] = 1;
+        else if (record->quantity > MAX_PIECE_INSTANCES) quantities[i] = MAX_PIECE_INSTANCES + 1;
+        else quantities[i] = (int)record->quantity;
     }
-
-    // CORRIGIDO: Verificar se malloc foi bem-sucedido
-    char* content = malloc(size + 1);
-    if (!content) {
-        printf("ERRO: Falha ao alocar memoria para ler %s (tamanho: %ld bytes)\n", filename, size);
-        fclose(file);
-        return NULL;
+    bool ok = expand_piece_types(quantities, filename);
+    free(quantities);
+    if (!ok) {
+        free(input_data.pieces);
+        input_data.pieces = NULL;
+        input_data.piece_count = 0;
     }
+    return ok;
+}
 
-    size_t bytes_read = fread(content, 1, size, file);
-    fclose(file);
+// Carrega a instancia: binaria (pelo magic) ou JSON
+bool load_input(const char* filename) {
+    MappedFile mapped;
+    if (!mapped_file_open(&mapped, filename)) {
+        printf("Erro: Nao foi possivel ler o arquivo %s\n", filename);
+        return false;
+    }
+    if (mapped.size >= 8 && memcmp(mapped.data, BINARY_INSTANCE_MAGIC, 8) == 0) {
+        if (!binary_instance_load(&mapped, filename)) {
+            mapped_file_close(&mapped);
+            return false;
+        }
+        input_mapping = mapped;
+        input_geometry_mapped = true;
+        return true;
+    }
+    bool ok = parse_input_json(&mapped, filename);
+    mapped_file_close(&mapped);
+    return ok;
+}
 
-    // CORRIGIDO: Em modo binario "rb", bytes_read deve ser exatamente igual a size
-    // Se nao for, algo deu errado na leitura
-    if (bytes_read != (size_t)size) {
-        printf("ERRO: Leitura incompleta do arquivo %s\n", filename);
-        printf("Esperado: %ld bytes, Lido: %zu bytes\n", size, bytes_read);
-        free(content);
-        return NULL;
+static bool write_instance_binary(const char* filename) {
+    if (!binary_host_supported()) return false;
+    uint64_t point_total = 0, angle_total = 0;
+    for (int t = 0; t < input_data.type_count; t++) {
+        point_total += input_data.pieces[input_data.type_first[t]].point_count;
+        angle_total += input_data.pieces[input_data.type_first[t]].angle_count;
     }
 
-    content[size] = '\0';
-    return content;
+    BinaryInstanceHeader header;
+    memset(&header, 0, sizeof(header));
+    memcpy(header.magic, BINARY_INSTANCE_MAGIC, 8);
+    header.version = BINARY_FORMAT_VERSION;
+    header.header_size = sizeof(header);
+    header.piece_count = (uint32_t)input_data.type_count;
+    header.point_count = point_total;
+    header.angle_count = angle_total;
+    header.pieces_offset = sizeof(header);
+    header.points_offset = header.pieces_offset + sizeof(BinaryPieceRecord) * (uint64_t)input_data.type_count;
+    header.angles_offset = header.points_offset + sizeof(Point) * point_total;
+    header.board_x = input_data.board_x;
+    header.board_y = input_data.board_y;
+    header.distance_between_boards = input_data.distance_between_boards;
+    header.distance_between_pieces = input_data.distance_between_pieces;
+
+    char temp_path[512];
+    FILE* file = atomic_write_open(filename, temp_path, sizeof(temp_path));
+    if (!file) return false;
+    bool ok = fwrite(&header, sizeof(header), 1, file) == 1;
+
+    uint64_t first_point = 0;
+    uint32_t first_angle = 0;
+    for (int t = 0; t < input_data.type_count && ok; t++) {
+        Piece* piece = &input_data.pieces[input_data.type_first[t]];
+        BinaryPieceRecord record;
+        memset(&record, 0, sizeof(record));
+        record.first_point = first_point;
+        record.point_count = (uint32_t)piece->point_count;
+        record.first_angle = first_angle;
+        record.angle_count = (uint32_t)piece->angle_count;
+        record.quantity = (uint32_t)type_quantity(t);
+        record.area = piece->area;
+        record.min_x = piece->min_x;
+        record.min_y = piece->min_y;
+        record.max_x = piece->max_x;
+        record.max_y = piece->max_y;
+        ok = fwrite(&record, sizeof(record), 1, file) == 1;
+        first_point += piece->point_count;
+        first_angle += (uint32_t)piece->angle_count;
+    }
+    for (int t = 0; t < input_data.type_count && ok; t++) {
+        Piece* piece = &input_data.pieces[input_data.type_first[t]];
+        ok = fwrite(piece->points, sizeof(Point), piece->point_count, file) == (size_t)piece->point_count;
+    }
+    for (int t = 0; t < input_data.type_count && ok; t++) {
+        Piece* piece = &input_data.pieces[input_data.type_first[t]];
+        ok = fwrite(piece->allowed_angles, sizeof(int), piece->angle_count, file) == (size_t)piece->angle_count;
+    }
+    return atomic_write_commit(file, ok, temp_path, filename);
 }
 
-double parse_number(const char** json) {
-    while (**json && (**json == ' ' || **json == '\t' || **json == '\n' || **json == '\r')) (*json)++;
+// Mesmo esquema de input_shapes.json (vertices ja transladados para min x/y = 0)
+static bool write_instance_json(const char* filename) {
+    char temp_path[512];
+    FILE* file = atomic_write_open(filename, temp_path, sizeof(temp_path));
+    if (!file) return false;
+    JsonWriter writer;
+    if (!json_writer_init(&writer, file, !output_compact)) {
+        fclose(file);
+        remove(temp_path);
+        return false;
+    }
+    JsonWriter* w = &writer;
+
+    json_begin_object(w);
+    json_key(w, "board_x");
+    json_double(w, input_data.board_x);
+    json_key(w, "board_y");
+    json_double(w, input_data.board_y);
+    json_key(w, "distance_between_boards");
+    json_double(w, input_data.distance_between_boards);
+    json_key(w, "distance_between_peaces");
+    json_double(w, input_data.distance_between_pieces);
+    json_key(w, "peaces");
+    json_begin_array(w);
+    for (int t = 0; t < input_data.type_count; t++) {
+        Piece* piece = &input_data.pieces[input_data.type_first[t]];
+        json_begin_object(w);
+        if (type_quantity(t) > 1) {
+            json_key(w, "quantity");
+            json_int(w, type_quantity(t));
+        }
+        json_key(w, "angle");
+        json_begin(w, '[', true);
+        for (int a = 0; a < piece->angle_count; a++) json_int(w, piece->allowed_angles[a]);
+        json_end_array(w);
+        json_key(w, "data");
+        json_begin_array(w);
+        for (int k = 0; k < piece->point_count; k++) {
+            json_begin(w, '[', true);
+            json_double(w, piece->points[k].x);
+            json_double(w, piece->points[k].y);
+            json_end_array(w);
+        }
+        json_end_array(w);
+        json_end_object(w);
+    }
+    json_end_array(w);
+    json_end_object(w);
 
-    char* end;
-    double value = strtod(*json, &end);
-    *json = end;
-    return value;
+    return atomic_write_commit(file, json_writer_finish(w), temp_path, filename);
 }
 
-void skip_whitespace(const char** json) {
-    while (**json && (**json == ' ' || **json == '\t' || **json == '\n' || **json == '\r')) (*json)++;
+bool write_instance(const char* filename) {
+    return path_is_binary(filename) ? write_instance_binary(filename) : write_instance_json(filename);
 }
 
-bool parse_input_json(const char* filename) {
-    char* json_content = read_file(filename);
-    if (!json_content) {
-        printf("Erro: Nao foi possivel ler o arquivo %s\n", filename);
-        return false;
+static bool write_result_binary(const char* filename) {
+    if (!binary_host_supported()) return false;
+    uint32_t placement_total = 0;
+    for (int i = 0; i < best_result.board_count; i++) placement_total += best_result.boards[i].piece_count;
+
+    BinaryResultHeader header;
+    memset(&header, 0, sizeof(header));
+    memcpy(header.magic, BINARY_RESULT_MAGIC, 8);
+    header.version = BINARY_FORMAT_VERSION;
+    header.header_size = sizeof(header);
+    header.board_count = (uint32_t)best_result.board_count;
+    header.placement_count = placement_total;
+    header.boards_offset = sizeof(header);
+    header.placements_offset = header.boards_offset + sizeof(BinaryBoardRecord) * (uint64_t)best_result.board_count;
+    header.board_x = input_data.board_x;
+    header.board_y = input_data.board_y;
+    header.total_efficiency = best_result.total_efficiency;
+    header.execution_time = best_result.execution_time;
+
+    char temp_path[512];
+    FILE* file = atomic_write_open(filename, temp_path, sizeof(temp_path));
+    if (!file) return false;
+    bool ok = fwrite(&header, sizeof(header), 1, file) == 1;
+
+    uint32_t first_placement = 0;
+    for (int i = 0; i < best_result.board_count && ok; i++) {
+        Board* board = &best_result.boards[i];
+        BinaryBoardRecord record = {first_placement, (uint32_t)board->piece_count, board->used_area, board->efficiency};
+        ok = fwrite(&record, sizeof(record), 1, file) == 1;
+        first_placement += (uint32_t)board->piece_count;
+    }
+    for (int i = 0; i < best_result.board_count && ok; i++) {
+        Board* board = &best_result.boards[i];
+        for (int j = 0; j < board->piece_count && ok; j++) {
+            PlacedPiece* piece = &board->placed_pieces[j];
+            BinaryPlacement placement = {piece->piece_id, piece->angle, piece->position.x, piece->position.y};
+            ok = fwrite(&placement, sizeof(placement), 1, file) == 1;
+        }
     }
+    return atomic_write_commit(file, ok, temp_path, filename);
+}
 
-    const char* json = json_content;
-
-    char* board_x_pos = strstr(json, "\"board_x\"");
-    if (!board_x_pos) return false;
-    json = board_x_pos + strlen("\"board_x\"");
-    while (*json && *json != ':') json++;
-    json++;
-    input_data.board_x = parse_number(&json);
-
-    char* board_y_pos = strstr(json, "\"board_y\"");
-    if (!board_y_pos) return false;
-    json = board_y_pos + strlen("\"board_y\"");
-    while (*json && *json != ':') json++;
-    json++;
-    input_data.board_y = parse_number(&json);
-
-    char* dist_boards_pos = strstr(json, "\"distance_between_boards\"");
-    if (!dist_boards_pos) return false;
-    json = dist_boards_pos + strlen("\"distance_between_boards\"");
-    while (*json && *json != ':') json++;
-    json++;
-    input_data.distance_between_boards = parse_number(&json);
-
-    char* dist_pieces_pos = strstr(json, "\"distance_between_peaces\"");
-    if (!dist_pieces_pos) return false;
-    json = dist_pieces_pos + strlen("\"distance_between_peaces\"");
-    while (*json && *json != ':') json++;
-    json++;
-    input_data.distance_between_pieces = parse_number(&json);
-
-    char* pieces_pos = strstr(json, "\"peaces\"");
-    if (!pieces_pos) return false;
-    json = pieces_pos + strlen("\"peaces\"");
-    while (*json && *json != '[') json++;
-    json++;
-
-    input_data.pieces = malloc(sizeof(Piece) * MAX_PIECES);
-    input_data.piece_count = 0;
+bool write_result(const char* filename) {
+    return path_is_binary(filename) ? write_result_binary(filename) : write_output_json(filename);
+}
+
+// Remonta best_result a partir de colocacoes (piece_id, angle, x, y) por placa;
+// area e eficiencia sao recalculadas a partir da instancia carregada
+static bool result_from_placements(const BinaryBoardRecord* boards, int board_count,
+                                   const BinaryPlacement* placements, uint32_t placement_count,
+                                   const char* filename) {
+    arena_reset(&best_result_arena);
+    best_result.board_count = board_count;
+    best_result.boards = arena_alloc(&best_result_arena, sizeof(Board) * (board_count > 0 ? board_count : 1));
+    bool* seen = arena_calloc(&best_result_arena, input_data.piece_count, sizeof(bool));
 
-    while (*json && *json != ']') {
-        skip_whitespace(&json);
-        if (*json == ']') break;
-        if (*json == ',') json++;
-        skip_whitespace(&json);
-        if (*json == ']') break;
-        if (*json != '{') json++;
-
-        Piece* piece = &input_data.pieces[input_data.piece_count];
-        piece->id = input_data.piece_count;
-        piece->points = malloc(sizeof(Point) * MAX_POINTS);
-        piece->point_count = 0;
-        piece->allowed_angles = malloc(sizeof(int) * MAX_ANGLES);
-        piece->angle_count = 0;
-
-        char* angle_pos = strstr(json, "\"angle\"");
-        if (angle_pos) {
-            json = angle_pos + strlen("\"angle\"");
-            while (*json && *json != '[') json++;
-            json++;
-
-            while (*json && *json != ']') {
-                skip_whitespace(&json);
-                if (*json == ']') break;
-                if (*json == ',') json++;
-                skip_whitespace(&json);
-                if (*json == ']') break;
-
-                piece->allowed_angles[piece->angle_count++] = (int)parse_number(&json);
+    double total_used_area = 0;
+    for (int i = 0; i < board_count; i++) {
+        Board* board = &best_result.boards[i];
+        board_init(board, &best_result_arena);
+        if (boards[i].first_placement > placement_count ||
+            boards[i].placement_count > placement_count - boards[i].first_placement ||
+            boards[i].placement_count > (uint32_t)input_data.piece_count) {
+            printf("ERRO: Resultado invalido em %s: placa %d fora da secao de colocacoes\n", filename, i);
+            return false;
+        }
+        for (uint32_t j = 0; j < boards[i].placement_count; j++) {
+            const BinaryPlacement* placement = &placements[boards[i].first_placement + j];
+            if (placement->piece_id < 0 || placement->piece_id >= input_data.piece_count) {
+                printf("ERRO: Resultado invalido em %s: peca %d nao existe na instancia\n",
+                       filename, placement->piece_id);
+                return false;
+            }
+            // Uma instancia colocada duas vezes contaria sua area duas vezes
+            if (seen[placement->piece_id]) {
+                printf("ERRO: Resultado invalido em %s: peca %d colocada mais de uma vez\n",
+                       filename, placement->piece_id);
+                return false;
+            }
+            seen[placement->piece_id] = true;
+            Piece* original = &input_data.pieces[placement->piece_id];
+            int rot_idx = -1;
+            for (int a = 0; a < original->angle_count; a++) {
+                if (original->allowed_angles[a] == placement->angle) rot_idx = a;
             }
-            json++;
+            if (rot_idx < 0) {
+                printf("ERRO: Resultado invalido em %s: angulo %d nao permitido para a peca %d\n",
+                       filename, placement->angle, placement->piece_id);
+                return false;
+            }
+            PlacedPiece* placed = &board->placed_pieces[board->piece_count++];
+            placed->piece_id = placement->piece_id;
+            placed->angle = placement->angle;
+            placed->position.x = placement->x;
+            placed->position.y = placement->y;
+            placed->rotated_piece = get_rotated_piece(placement->piece_id, rot_idx);
+            board->used_area += original->area;
         }
+        board->efficiency = board->used_area / (board->width * board->height) * 100.0;
+        total_used_area += board->used_area;
+        grid_rebuild(board);
+    }
+    double total_board_area = board_count * input_data.board_x * input_data.board_y;
+    best_result.total_efficiency = total_board_area > 0 ? total_used_area / total_board_area * 100.0 : 0.0;
+    return true;
+}
 
-        char* data_pos = strstr(json, "\"data\"");
-        if (data_pos) {
-            json = data_pos + strlen("\"data\"");
-            while (*json && *json != '[') json++;
-            json++;
+static bool binary_result_load(const MappedFile* mapped, const char* filename) {
+    if (!binary_host_supported()) return false;
+    const BinaryResultHeader* header = (const BinaryResultHeader*)mapped->data;
+    const char* error = NULL;
+    if (mapped->size < sizeof(BinaryResultHeader)) error = "cabecalho truncado";
+    else if (header->version != BINARY_FORMAT_VERSION) error = "versao nao suportada";
+    else if (header->header_size < sizeof(BinaryResultHeader)) error = "tamanho de cabecalho invalido";
+    else if (header->board_count > INT_MAX) error = "numero de placas invalido";
+    else if (!binary_section_ok(mapped, header->boards_offset, header->board_count, sizeof(BinaryBoardRecord)))
+        error = "secao de placas fora do arquivo";
+    else if (!binary_section_ok(mapped, header->placements_offset, header->placement_count, sizeof(BinaryPlacement)))
+        error = "secao de colocacoes fora do arquivo";
+    if (error) {
+        printf("ERRO: Resultado binario invalido em %s: %s\n", filename, error);
+        return false;
+    }
+    best_result.execution_time = header->execution_time;
+    return result_from_placements((const BinaryBoardRecord*)(mapped->data + header->boards_offset),
+                                  (int)header->board_count,
+                                  (const BinaryPlacement*)(mapped->data + header->placements_offset),
+                                  header->placement_count, filename);
+}
 
-            while (*json && *json != ']') {
-                skip_whitespace(&json);
-                if (*json == ']') break;
-                if (*json == ',') json++;
-                skip_whitespace(&json);
-                if (*json == ']') break;
-                if (*json == '[') json++;
+// Le o esquema de genetic_nesting_optimized_result.json; "data" e ignorado
+// (os vertices sao recalculados a partir da instancia)
+static bool result_json_load(const MappedFile* mapped, const char* filename) {
+    JsonReader reader = {mapped->data, mapped->data, mapped->data + mapped->size, false, ""};
+    JsonReader* r = &reader;
+    BinaryBoardRecord* boards = NULL;
+    BinaryPlacement* placements = NULL;
+    int board_count = 0, board_capacity = 0;
+    uint32_t placement_count = 0, placement_capacity = 0;
+    double execution_time = 0;
+
+    const char* key;
+    size_t key_length;
+    bool first = true;
+    if (json_reader_expect(r, '{')) {
+        while (json_reader_key(r, &first, &key, &key_length)) {
+            if (json_key_is(key, key_length, "execution_time")) {
+                if (!json_reader_number(r, &execution_time)) break;
+            } else if (json_key_is(key, key_length, "boards")) {
+                if (!json_reader_expect(r, '[')) break;
+                bool first_board = true;
+                while (json_reader_next(r, ']', &first_board)) {
+                    if (board_count == board_capacity) {
+                        board_capacity = board_capacity ? board_capacity * 2 : 16;
+                        boards = realloc(boards, sizeof(BinaryBoardRecord) * board_capacity);
+                    }
+                    BinaryBoardRecord* board = &boards[board_count++];
+                    memset(board, 0, sizeof(*board));
+                    board->first_placement = placement_count;
+                    if (!json_reader_expect(r, '{')) break;
+                    bool first_field = true;
+                    while (json_reader_key(r, &first_field, &key, &key_length)) {
+                        if (!json_key_is(key, key_length, "pieces")) {
+                            if (!json_reader_skip_value(r)) break;
+                            continue;
+                        }
+                        if (!json_reader_expect(r, '[')) break;
+                        bool first_piece = true;
+                        while (json_reader_next(r, ']', &first_piece)) {
+                            if (placement_count == placement_capacity) {
+                                placement_capacity = placement_capacity ? placement_capacity * 2 : 64;
+                                placements = realloc(placements, sizeof(BinaryPlacement) * placement_capacity);
+                            }
+                            BinaryPlacement* placement = &placements[placement_count++];
+                            board->placement_count++;
+                            int piece_id = -1, instance = 0, angle = 0;
+                            placement->x = placement->y = 0;
+                            if (!json_reader_expect(r, '{')) break;
+                            bool first_piece_field = true;
+                            while (json_reader_key(r, &first_piece_field, &key, &key_length)) {
+                                bool ok;
+                                if (json_key_is(key, key_length, "piece_id")) {
+                                    ok = json_reader_int(r, &piece_id, 0, input_data.type_count - 1, "piece_id");
+                                } else if (json_key_is(key, key_length, "instance")) {
+                                    ok = json_reader_int(r, &instance, 0, MAX_PIECE_INSTANCES - 1, "instance");
+                                } else if (json_key_is(key, key_length, "angle")) {
+                                    ok = json_reader_int(r, &angle, -3600, 3600, "angulo");
+                                }
+                                else if (json_key_is(key, key_length, "position_x")) ok = json_reader_number(r, &placement->x);
+                                else if (json_key_is(key, key_length, "position_y")) ok = json_reader_number(r, &placement->y);
+                                else ok = json_reader_skip_value(r);
+                                if (!ok) break;
+                            }
+                            // (tipo, instancia) -> indice da instancia; sem piece_id ou
+                            // instancia alem da quantidade vira -1 e e rejeitado em
+                            // result_from_placements
+                            placement->piece_id = -1;
+                            if (piece_id >= 0 && instance < type_quantity(piece_id)) {
+                                placement->piece_id = input_data.type_first[piece_id] + instance;
+                            }
+                            placement->angle = angle;
+                        }
+                    }
+                }
+            } else if (!json_reader_skip_value(r)) {
+                break;
+            }
+        }
+    }
 
-                Point* point = &piece->points[piece->point_count];
-                point->x = parse_number(&json);
+    bool ok = !r->failed;
+    if (!ok) printf("ERRO: JSON invalido em %s, %s\n", filename, r->error);
+    if (ok) {
+        best_result.execution_time = execution_time;
+        ok = result_from_placements(boards, board_count, placements, placement_count, filename);
+    }
+    free(boards);
+    free(placements);
+    return ok;
+}
 
-                skip_whitespace(&json);
-                if (*json == ',') json++;
-                skip_whitespace(&json);
+// Carrega um resultado (binario pelo magic, ou JSON) em best_result
+bool load_result(const char* filename) {
+    MappedFile mapped;
+    if (!mapped_file_open(&mapped, filename)) return false;
+    bool ok = mapped.size >= 8 && memcmp(mapped.data, BINARY_RESULT_MAGIC, 8) == 0
+              ? binary_result_load(&mapped, filename)
+              : result_json_load(&mapped, filename);
+    mapped_file_close(&mapped);
+    return ok;
+}
 
-                point->y = parse_number(&json);
-                piece->point_count++;
+// ==================== CONFIGURACAO ====================
+// Todos os parametros podem ser definidos em um arquivo (--config ARQUIVO,
+// linhas "chave = valor", '#' inicia comentario) ou na linha de comando
+// (--chave valor). Os argumentos sao aplicados em ordem, entao o que vem
+// depois sobrescreve o que veio antes. O primeiro argumento livre e a seed.
+
+typedef enum {
+    CONFIG_INT,
+    CONFIG_UINT,        // ConfigUint (0 .. UINT_MAX, marca se foi definido)
+    CONFIG_DOUBLE,
+    CONFIG_FLAG,        // Sem valor na linha de comando; "1"/"0" no arquivo
+    CONFIG_PATH,        // char[256]
+    CONFIG_STRING,      // const char* (copia propria)
+    CONFIG_TOPOLOGY,
+    CONFIG_LOG_LEVEL
+} ConfigType;
 
-                while (*json && *json != ']' && *json != '[' && *json != ',') json++;
-                if (*json == ']') json++;
-            }
-        }
+typedef struct {
+    const char* name;
+    ConfigType type;
+    void* target;
+    const char* help;
+} ConfigOption;
 
-        double min_x, min_y, max_x, max_y;
-        if (piece->point_count > 0) {
-            min_x = max_x = piece->points[0].x;
-            min_y = max_y = piece->points[0].y;
+typedef struct {
+    unsigned int value;
+    bool set;
+} ConfigUint;
+
+static ConfigUint seed_option = {0, false};
+
+static const ConfigOption config_options[] = {
+    {"input",                 CONFIG_PATH,     input_path,             "arquivo JSON de entrada"},
+    {"output",                CONFIG_PATH,     result_path,            "arquivo de resultado (JSON; binario se terminar em .bin)"},
+    {"convert-instance",      CONFIG_PATH,     convert_instance_path,  "gravar a instancia de --input neste arquivo (.bin ou JSON) e sair"},
+    {"convert-result",        CONFIG_PATH,     convert_result_path,    "converter este resultado para --output (mesma instancia) e sair"},
+    {"seed",                  CONFIG_UINT,     &seed_option,           "seed fixa (reprodutivel)"},
+    {"population",            CONFIG_INT,      &population_size,       "tamanho da populacao"},
+    {"generations",           CONFIG_INT,      &generations,           "numero de geracoes"},
+    {"tournament",            CONFIG_INT,      &tournament_size,       "tamanho do torneio"},
+    {"mutation-rate",         CONFIG_DOUBLE,   &mutation_rate,         "taxa de mutacao (0..1)"},
+    {"elite",                 CONFIG_INT,      &elite_size,            "elite preservada por geracao"},
+    {"stagnation-limit",      CONFIG_INT,      &stagnation_limit,      "geracoes sem melhoria antes do restart"},
+    {"steady-state",          CONFIG_FLAG,     &steady_state_mode,     "AG estado estacionario assincrono"},
+    {"time-limit",            CONFIG_DOUBLE,   &time_limit_seconds,    "limite de tempo em segundos (0 = sem limite)"},
+    {"stall-seconds",         CONFIG_DOUBLE,   &stall_limit_seconds,   "parar apos S segundos sem melhoria (0 = nunca)"},
+    {"islands",               CONFIG_INT,      &island_count,          "ilhas por processo"},
+    {"topology",              CONFIG_TOPOLOGY, &migration_topology,    "ring | torus"},
+    {"migration-interval",    CONFIG_INT,      &migration_interval,    "geracoes entre migracoes"},
+    {"migration-size",        CONFIG_INT,      &migration_size,        "elites enviados por migracao"},
+    {"island-procs",          CONFIG_INT,      &island_process_count,  "processos de ilhas"},
+    {"island-rank",           CONFIG_INT,      &island_process_rank,   "rank deste processo"},
+    {"island-shm",            CONFIG_STRING,   &island_shm_name,       "nome da memoria compartilhada"},
+    {"log-level",             CONFIG_LOG_LEVEL, &log_level,            "silent | summary | verbose"},
+    {"compact-output",        CONFIG_FLAG,     &output_compact,        "JSON de resultado sem espacos nem quebras de linha"},
+    {"transforms-only",       CONFIG_FLAG,     &output_transforms_only, "resultado apenas com piece_id, angle e posicao (sem vertices)"},
+    {"progress-json",         CONFIG_PATH,     progress_json_path,     "eventos de progresso em JSON lines ('-' = stdout)"},
+    {"simplify-tolerance",    CONFIG_DOUBLE,   &simplify_tolerance,    "simplificar contornos para a busca (afastamento maximo; 0 = exato)"},
+    {"concavity-threshold",   CONFIG_DOUBLE,   &concavity_threshold,   "concavidade minima para a fase 3 (0..1)"},
+    {"grid-resolution",       CONFIG_INT,      &grid_resolution,       "grade de pontos candidatos na concavidade"},
+    {"subgrid-resolution",    CONFIG_INT,      &subgrid_resolution,    "refinamento em torno de cada ponto"},
+    {"max-small-piece-ratio", CONFIG_DOUBLE,   &max_small_piece_ratio, "area maxima da peca pequena (fracao da grande)"},
+#if ENABLE_PROFILING
+    {"profile-json",          CONFIG_PATH,     profile_json_path,      "grava contadores e tempos por fase em JSON"},
+#endif
+#if ENABLE_BENCHMARKS
+    {"bench-generate",        CONFIG_PATH,     bench_generate_path,    "gerar instancia sintetica e sair"},
+    {"bench-pieces",          CONFIG_INT,      &bench_pieces,          "pecas da instancia sintetica"},
+    {"bench-vertices",        CONFIG_INT,      &bench_vertices,        "vertices por peca da instancia sintetica"},
+    {"bench-shapes",          CONFIG_STRING,   &bench_shapes,          "mix | rect | l | c"},
+    {"bench-micro",           CONFIG_PATH,     bench_micro_path,       "rodar microbenchmarks (CSV) e sair"},
+    {"bench-csv",             CONFIG_PATH,     bench_csv_path,         "CSV de progresso por geracao"},
+#endif
+};
+#define CONFIG_OPTION_COUNT ((int)(sizeof(config_options) / sizeof(config_options[0])))
 
-            for (int i = 1; i < piece->point_count; i++) {
-                if (piece->points[i].x < min_x) min_x = piece->points[i].x;
-                if (piece->points[i].x > max_x) max_x = piece->points[i].x;
-                if (piece->points[i].y < min_y) min_y = piece->points[i].y;
-                if (piece->points[i].y > max_y) max_y = piece->points[i].y;
-            }
+static const ConfigOption* config_find(const char* name) {
+    for (int i = 0; i < CONFIG_OPTION_COUNT; i++) {
+        if (strcmp(config_options[i].name, name) == 0) return &config_options[i];
+    }
+    return NULL;
+}
 
-            for (int i = 0; i < piece->point_count; i++) {
-                piece->points[i].x -= min_x;
-                piece->points[i].y -= min_y;
-            }
-        }
+static bool config_parse_int(const char* text, int* out) {
+    char* end;
+    long value = strtol(text, &end, 10);
+    if (end == text || *end != '\0' || value < INT_MIN || value > INT_MAX) return false;
+    *out = (int)value;
+    return true;
+}
 
-        calculate_bounding_box_cached(piece);
-        piece->width = piece->max_x - piece->min_x;
-        piece->height = piece->max_y - piece->min_y;
-        piece->area = calculate_polygon_area(piece->points, piece->point_count);
+static bool config_parse_uint(const char* text, ConfigUint* out) {
+    while (*text == ' ' || *text == '\t') text++;
+    if (*text == '-') return false;     // strtoul aceitaria e negaria o valor
+    char* end;
+    errno = 0;
+    unsigned long value = strtoul(text, &end, 10);
+    if (end == text || *end != '\0' || errno == ERANGE || value > UINT_MAX) return false;
+    out->value = (unsigned int)value;
+    out->set = true;
+    return true;
+}
 
-        input_data.piece_count++;
+static bool config_parse_double(const char* text, double* out) {
+    char* end;
+    double value = strtod(text, &end);
+    // nan passaria por todas as validacoes de faixa (comparacoes falsas)
+    if (end == text || *end != '\0' || !isfinite(value)) return false;
+    *out = value;
+    return true;
+}
 
-        int brace_count = 1;
-        while (*json && brace_count > 0) {
-            if (*json == '{') brace_count++;
-            else if (*json == '}') brace_count--;
-            json++;
+// Aplica um valor; 'origin' identifica a fonte nas mensagens de erro
+static bool config_set(const ConfigOption* option, const char* value, const char* origin) {
+    bool ok = true;
+    switch (option->type) {
+        case CONFIG_INT:
+            ok = config_parse_int(value, (int*)option->target);
+            break;
+        case CONFIG_UINT:
+            ok = config_parse_uint(value, (ConfigUint*)option->target);
+            break;
+        case CONFIG_DOUBLE:
+            ok = config_parse_double(value, (double*)option->target);
+            break;
+        case CONFIG_FLAG:
+            if (strcmp(value, "1") == 0 || strcmp(value, "true") == 0) *(bool*)option->target = true;
+            else if (strcmp(value, "0") == 0 || strcmp(value, "false") == 0) *(bool*)option->target = false;
+            else ok = false;
+            break;
+        case CONFIG_PATH:
+            ok = strlen(value) < 256;
+            if (ok) snprintf((char*)option->target, 256, "%s", value);
+            break;
+        case CONFIG_STRING: {
+            size_t len = strlen(value) + 1;
+            char* copy = malloc(len);
+            memcpy(copy, value, len);
+            *(const char**)option->target = copy;
+            break;
         }
+        case CONFIG_TOPOLOGY:
+            if (strcmp(value, "ring") == 0) *(MigrationTopology*)option->target = TOPOLOGY_RING;
+            else if (strcmp(value, "torus") == 0) *(MigrationTopology*)option->target = TOPOLOGY_TORUS;
+            else ok = false;
+            break;
+        case CONFIG_LOG_LEVEL:
+            if (strcmp(value, "silent") == 0) *(int*)option->target = LOG_LEVEL_SILENT;
+            else if (strcmp(value, "summary") == 0) *(int*)option->target = LOG_LEVEL_SUMMARY;
+            else if (strcmp(value, "verbose") == 0) *(int*)option->target = LOG_LEVEL_VERBOSE;
+            else ok = false;
+            break;
     }
+    if (!ok) printf("Erro: valor invalido para '%s' (%s): %s\n", option->name, origin, value);
+    return ok;
+}
 
-    free(json_content);
-    return true;
+static char* config_trim(char* text) {
+    while (*text == ' ' || *text == '\t') text++;
+    char* end = text + strlen(text);
+    while (end > text && (end[-1] == ' ' || end[-1] == '\t' || end[-1] == '\r' || end[-1] == '\n')) end--;
+    *end = '\0';
+    return text;
 }
 
-void write_output_json(const char* filename) {
-    // CORRIGIDO: Usar modo "wb" para garantir escrita binaria consistente
-    FILE* file = fopen(filename, "wb");
+static bool config_load_file(const char* filename) {
+    FILE* file = fopen(filename, "rb");
     if (!file) {
-        printf("ERRO: Nao foi possivel criar/escrever o arquivo %s\n", filename);
-        printf("Detalhes: ");
-
-        #ifdef _WIN32
-            DWORD error = GetLastError();
-            if (error == ERROR_ACCESS_DENIED) {
-                printf("Acesso negado. Verifique permissoes de escrita.\n");
-            } else if (error == ERROR_PATH_NOT_FOUND) {
-                printf("Caminho nao encontrado.\n");
-            } else {
-                printf("Codigo de erro Windows: %lu\n", error);
-            }
-        #else
-            printf("%s\n", strerror(errno));
-        #endif
-
-        return;
+        printf("Erro: nao foi possivel abrir o arquivo de configuracao %s (%s)\n", filename, strerror(errno));
+        return false;
     }
 
-    fprintf(file, "{\n");
-    fprintf(file, "  \"board_count\": %d,\n", best_result.board_count);
-    fprintf(file, "  \"board_x\": %.2f,\n", input_data.board_x);
-    fprintf(file, "  \"board_y\": %.2f,\n", input_data.board_y);
-    fprintf(file, "  \"total_efficiency\": %.2f,\n", best_result.total_efficiency);
-    fprintf(file, "  \"execution_time\": %.3f,\n", best_result.execution_time);
-    fprintf(file, "  \"boards\": [\n");
+    char line[1024];
+    char origin[300];
+    int line_number = 0;
+    bool ok = true;
+    while (ok && fgets(line, sizeof(line), file)) {
+        line_number++;
+        char* comment = strchr(line, '#');
+        if (comment) *comment = '\0';
+        char* key = config_trim(line);
+        if (*key == '\0') continue;
+
+        snprintf(origin, sizeof(origin), "%s:%d", filename, line_number);
+        char* equals = strchr(key, '=');
+        if (!equals) {
+            printf("Erro: esperado 'chave = valor' em %s\n", origin);
+            ok = false;
+            break;
+        }
+        *equals = '\0';
+        key = config_trim(key);
+        char* value = config_trim(equals + 1);
+
+        const ConfigOption* option = config_find(key);
+        if (!option) {
+            printf("Erro: opcao desconhecida '%s' em %s\n", key, origin);
+            ok = false;
+        } else {
+            ok = config_set(option, value, origin);
+        }
+    }
+    fclose(file);
+    return ok;
+}
 
-    for (int i = 0; i < best_result.board_count; i++) {
-        Board* board = &best_result.boards[i];
-        fprintf(file, "    {\n");
-        fprintf(file, "      \"board_id\": %d,\n", i);
-        fprintf(file, "      \"efficiency\": %.2f,\n", board->efficiency);
-        fprintf(file, "      \"piece_count\": %d,\n", board->piece_count);
-        fprintf(file, "      \"pieces\": [\n");
+static void config_print_usage(const char* program) {
+    printf("Uso: %s [seed] [--config ARQUIVO] [--opcao valor]...\n\n", program);
+    printf("Opcoes (tambem aceitas como 'opcao = valor' no arquivo de configuracao):\n");
+    for (int i = 0; i < CONFIG_OPTION_COUNT; i++) {
+        const ConfigOption* option = &config_options[i];
+        printf("  --%-23s %s\n", option->name, option->help);
+    }
+}
 
-        for (int j = 0; j < board->piece_count; j++) {
-            PlacedPiece* piece = &board->placed_pieces[j];
-            fprintf(file, "        {\n");
-            fprintf(file, "          \"piece_id\": %d,\n", piece->piece_id);
-            fprintf(file, "          \"position_x\": %.2f,\n", piece->position.x);
-            fprintf(file, "          \"position_y\": %.2f,\n", piece->position.y);
-            fprintf(file, "          \"angle\": %d,\n", piece->angle);
-
-            fprintf(file, "          \"data\": [\n");
-            for (int k = 0; k < piece->rotated_piece.point_count; k++) {
-                double world_x = piece->rotated_piece.points[k].x + piece->position.x;
-                double world_y = piece->rotated_piece.points[k].y + piece->position.y;
-
-                fprintf(file, "            [\n");
-                fprintf(file, "                %.6f,\n", world_x);
-                fprintf(file, "                %.6f\n", world_y);
-                fprintf(file, "            ]%s\n",
-                       (k < piece->rotated_piece.point_count - 1) ? "," : "");
+// Retorna 0 para continuar, 1 para sair com erro e 2 para sair sem erro (--help)
+static int config_parse_args(int argc, char* argv[]) {
+    bool seed_positional = false;
+    for (int i = 1; i < argc; i++) {
+        const char* arg = argv[i];
+        if (strcmp(arg, "--help") == 0 || strcmp(arg, "-h") == 0) {
+            config_print_usage(argv[0]);
+            return 2;
+        }
+        if (strncmp(arg, "--", 2) != 0) {
+            if (seed_positional) {
+                printf("Erro: argumento inesperado: %s\n", arg);
+                return 1;
             }
-            fprintf(file, "          ]\n");
-
-            fprintf(file, "        }%s\n", (j < board->piece_count - 1) ? "," : "");
+            seed_positional = true;
+            if (!config_set(config_find("seed"), arg, "argumento posicional")) return 1;
+            continue;
+        }
+        if (strcmp(arg, "--config") == 0) {
+            if (i + 1 >= argc) {
+                printf("Erro: --config requer um arquivo\n");
+                return 1;
+            }
+            if (!config_load_file(argv[++i])) return 1;
+            continue;
         }
 
-        fprintf(file, "      ]\n");
-        fprintf(file, "    }%s\n", (i < best_result.board_count - 1) ? "," : "");
+        const ConfigOption* option = config_find(arg + 2);
+        if (!option) {
+            printf("Erro: opcao desconhecida: %s (use --help)\n", arg);
+            return 1;
+        }
+        if (option->type == CONFIG_FLAG) {
+            *(bool*)option->target = true;
+            continue;
+        }
+        if (i + 1 >= argc) {
+            printf("Erro: %s requer um valor\n", arg);
+            return 1;
+        }
+        if (!config_set(option, argv[++i], "linha de comando")) return 1;
     }
+    return 0;
+}
 
-    fprintf(file, "  ]\n");
-    fprintf(file, "}\n");
-
-    fclose(file);
+// Verifica combinacoes invalidas depois que todas as fontes foram aplicadas
+static bool config_validate() {
+    const char* error = NULL;
+    if (population_size < 2) error = "population deve ser >= 2";
+    else if (generations < 1) error = "generations deve ser >= 1";
+    else if (tournament_size < 1) error = "tournament deve ser >= 1";
+    else if (elite_size < 0 || elite_size >= population_size) error = "elite deve estar entre 0 e population - 1";
+    else if (mutation_rate < 0.0 || mutation_rate > 1.0) error = "mutation-rate deve estar entre 0 e 1";
+    else if (migration_interval < 1) error = "migration-interval deve ser >= 1";
+    else if (migration_size < 0 || migration_size > population_size - elite_size)
+        error = "migration-size deve estar entre 0 e population - elite";
+    else if (grid_resolution < 1 || subgrid_resolution < 1) error = "grid-resolution e subgrid-resolution devem ser >= 1";
+    else if (time_limit_seconds < 0 || stall_limit_seconds < 0) error = "limites de tempo nao podem ser negativos";
+    else if (simplify_tolerance < 0) error = "simplify-tolerance nao pode ser negativo";
+    else if (island_process_rank < 0 || island_process_rank >= island_process_count)
+        error = "island-rank deve estar entre 0 e island-procs - 1";
+#if ENABLE_BENCHMARKS
+    else if (bench_pieces < 1 || bench_vertices < 4) error = "bench-pieces deve ser >= 1 e bench-vertices >= 4";
+#endif
+    if (error) printf("Erro de configuracao: %s\n", error);
+    return error == NULL;
 }
 
 // ==================== MAIN ====================
 
 int main(int argc, char* argv[]) {
-    printf("========================================\n");
-    printf("  ALGORITMO GENETICO OTIMIZADO - NESTING\n");
-    printf("========================================\n\n");
+    // Configuracao primeiro: o nivel de log vale desde o cabecalho
+    int parse_status = config_parse_args(argc, argv);
+    if (parse_status != 0) return parse_status == 2 ? 0 : 1;
+    if (island_count < 1) island_count = 1;
+    if (island_process_count < 1) island_process_count = 1;
+    if (!config_validate()) return 1;
+
+    LOG_SUMMARY("========================================\n");
+    LOG_SUMMARY("  ALGORITMO GENETICO OTIMIZADO - NESTING\n");
+    LOG_SUMMARY("========================================\n\n");
 
     // Informações sobre paralelização OpenMP
     #ifdef _OPENMP
         int num_threads = omp_get_max_threads();
-        printf("OpenMP ATIVADO: %d threads disponiveis\n", num_threads);
-        printf("Versao OpenMP: %d\n\n", _OPENMP);
+        LOG_SUMMARY("OpenMP ATIVADO: %d threads disponiveis\n", num_threads);
+        LOG_SUMMARY("Versao OpenMP: %d\n\n", _OPENMP);
     #else
-        printf("OpenMP DESATIVADO: execucao serial\n\n");
+        LOG_SUMMARY("OpenMP DESATIVADO: execucao serial\n\n");
+    #endif
+
+    simd_init();
+    LOG_SUMMARY("Kernels geometricos: %s\n\n", simd_level);
+    #ifndef _OPENMP
+        if (island_count > 1) {
+            LOG_SUMMARY("Aviso: sem OpenMP, uma ilha por processo (use --island-procs)\n");
+            island_count = 1;
+        }
     #endif
 
     // Inicialização melhorada do gerador de números aleatórios
     unsigned int seed;
 
-    if (argc > 1) {
+    if (seed_option.set) {
         // Se passar um argumento, usa como seed fixa para reprodutibilidade
-        seed = (unsigned int)atoi(argv[1]);
-        printf("MODO REPRODUTIVEL: usando seed fixa = %u\n\n", seed);
+        seed = seed_option.value;
+        LOG_SUMMARY("MODO REPRODUTIVEL: usando seed fixa = %u (independente do numero de threads)\n\n", seed);
     } else {
         // Caso contrário, usa método mais robusto para aleatoriedade verdadeira
         // Combina tempo em microsegundos + PID para garantir unicidade
@@ -1810,251 +6781,283 @@ int main(int argc, char* argv[]) {
             clock_gettime(CLOCK_MONOTONIC, &ts);
             seed = (unsigned int)(ts.tv_sec ^ ts.tv_nsec ^ (getpid() << 16));
         #endif
-        printf("MODO ALEATORIO: seed gerada = %u\n", seed);
-        printf("(Para reproduzir este resultado, execute: %s %u)\n\n", argv[0], seed);
+        LOG_SUMMARY("MODO ALEATORIO: seed gerada = %u\n", seed);
+        LOG_SUMMARY("(Para reproduzir este resultado, execute: %s %u)\n\n", argv[0], seed);
     }
 
-    srand(seed);
+    rng_seed = seed;
+    #if ENABLE_BENCHMARKS
+        if (bench_generate_path[0]) return bench_generate_instance(bench_generate_path) ? 0 : 1;
+    #endif
     init_trig_cache();
-
-    // Inicializar seeds thread-local para OpenMP
     #ifdef _OPENMP
-        max_threads = omp_get_max_threads();
-        thread_seeds = malloc(sizeof(unsigned int) * max_threads);
-
-        // Cada thread recebe uma seed unica derivada da seed principal
-        for (int i = 0; i < max_threads; i++) {
-            // Usar uma combinacao da seed principal + thread ID para garantir unicidade
-            // mas ainda permitir reprodutibilidade se a seed principal for fixa
-            thread_seeds[i] = seed + (i * 1234567891u);
+        // Uma thread por ilha (o time precisa ter exatamente island_count threads)
+        if (island_count > 1) {
+            omp_set_dynamic(0);
+            if (island_count > omp_get_max_threads()) omp_set_num_threads(island_count);
         }
-
-        printf("Seeds das threads inicializadas: %d threads\n\n", max_threads);
     #endif
-
-    clock_t start_time = clock();
-
-    if (!parse_input_json("input_shapes.json")) {
-        printf("Erro: Falha ao carregar input_shapes.json\n");
+    init_thread_arenas();
+    arena_init(&result_arena, ARENA_BLOCK_SIZE);
+    arena_init(&best_result_arena, ARENA_BLOCK_SIZE);
+
+    run_start_time = wall_time();
+    last_improvement_time = run_start_time;
+    if (!progress_open()) return 1;
+
+    PROFILE_PHASE_BEGIN(PHASE_PARSE);
+    bool parsed = load_input(input_path);
+    PROFILE_PHASE_END(PHASE_PARSE);
+    if (!parsed) {
+        printf("Erro: Falha ao carregar %s\n", input_path);
         return 1;
     }
 
-    printf("Carregado: %d pecas\n", input_data.piece_count);
-    printf("Dimensoes da placa: %.2f x %.2f\n", input_data.board_x, input_data.board_y);
-    printf("Distancia entre pecas: %.2f\n", input_data.distance_between_pieces);
-    printf("Margem da placa: %.2f\n\n", input_data.distance_between_boards);
-
-    printf("Parametros do AG:\n");
-    printf("  Populacao: %d\n", POPULATION_SIZE);
-    printf("  Geracoes: %d\n", GENERATIONS);
-    printf("  Taxa de mutacao: %.2f%%\n", MUTATION_RATE * 100);
-    printf("  Tamanho do torneio: %d\n", TOURNAMENT_SIZE);
-    printf("  Elite preservada: %d\n\n", ELITE_SIZE);
+    if (input_data.type_count < input_data.piece_count) {
+        LOG_SUMMARY("Carregado: %d pecas (%d tipos)\n", input_data.piece_count, input_data.type_count);
+    } else {
+        LOG_SUMMARY("Carregado: %d pecas\n", input_data.piece_count);
+    }
+    LOG_SUMMARY("Dimensoes da placa: %.2f x %.2f\n", input_data.board_x, input_data.board_y);
+    LOG_SUMMARY("Distancia entre pecas: %.2f\n", input_data.distance_between_pieces);
+    LOG_SUMMARY("Margem da placa: %.2f\n\n", input_data.distance_between_boards);
+    if (convert_instance_path[0]) {
+        if (!write_instance(convert_instance_path)) return 1;
+        LOG_SUMMARY("Instancia convertida: %s -> %s\n", input_path, convert_instance_path);
+        return 0;
+    }
+    progress_event("start", "\"seed\": %u, \"pieces\": %d, \"population\": %d, \"generations\": %d, "
+                   "\"islands\": %d", seed, input_data.piece_count, population_size, generations,
+                   island_count * island_process_count);
+
+    PROFILE_PHASE_BEGIN(PHASE_SETUP);
+    shape_table_init();
+    nfp_init();
+    spatial_index_setup();
+    fitness_cache_init();
+    PROFILE_PHASE_END(PHASE_SETUP);
+
+    if (convert_result_path[0]) {
+        if (!load_result(convert_result_path) || !write_result(result_path)) return 1;
+        LOG_SUMMARY("Resultado convertido: %s -> %s\n", convert_result_path, result_path);
+        return 0;
+    }
 
-    printf("Inicializando populacao...\n");
-    Genome* population = malloc(sizeof(Genome) * POPULATION_SIZE);
+    #if ENABLE_BENCHMARKS
+        if (bench_micro_path[0]) return bench_run_micro(bench_micro_path) ? 0 : 1;
+    #endif
 
-    int greedy_count = POPULATION_SIZE / 10;
-    for (int i = 0; i < greedy_count; i++) {
-        population[i] = create_greedy_genome();
+    LOG_SUMMARY("Parametros do AG:\n");
+    LOG_SUMMARY("  Populacao: %d\n", population_size);
+    LOG_SUMMARY("  Geracoes: %d\n", generations);
+    LOG_SUMMARY("  Taxa de mutacao: %.2f%%\n", mutation_rate * 100);
+    LOG_SUMMARY("  Tamanho do torneio: %d\n", tournament_size);
+    LOG_SUMMARY("  Elite preservada: %d\n", elite_size);
+    if (time_limit_seconds > 0) LOG_SUMMARY("  Limite de tempo: %.1f s\n", time_limit_seconds);
+    if (stall_limit_seconds > 0) LOG_SUMMARY("  Parada por estagnacao: %.1f s sem melhoria\n", stall_limit_seconds);
+    LOG_SUMMARY("\n");
+
+    // Com varios processos de ilhas, cada rank grava o seu melhor resultado
+    // (<saida>_rank<R>.<ext>; o rank 0 usa o nome configurado)
+    if (island_process_count > 1 && island_process_rank > 0) {
+        char base[256];
+        memcpy(base, result_path, sizeof(base));
+        const char* extension = strrchr(base, '.');
+        if (!extension || strpbrk(extension, "/\\")) extension = base + strlen(base);
+        snprintf(result_path, sizeof(result_path), "%.*s_rank%d%s", (int)(extension - base), base,
+                 island_process_rank, extension);
     }
-    for (int i = greedy_count; i < POPULATION_SIZE; i++) {
-        population[i] = create_random_genome();
+
+    int island_total = island_count * island_process_count;
+    if (island_total > 1) {
+        LOG_SUMMARY("Modelo de ilhas: %d ilhas (%d por processo, rank %d/%d), topologia %s\n",
+                    island_total, island_count, island_process_rank, island_process_count,
+                    migration_topology == TOPOLOGY_TORUS ? "toro" : "anel");
+        LOG_SUMMARY("  Migracao: %d elites a cada %d geracoes\n\n", migration_size, migration_interval);
+        bool hub_ok = island_process_count > 1 ? migration_hub_attach_shared(island_total, seed)
+                                               : migration_hub_create_local(island_total);
+        if (!hub_ok) return 1;
     }
 
-    printf("Avaliando populacao inicial...\n");
-    #ifdef _OPENMP
-        #pragma omp parallel for schedule(dynamic)
-    #endif
-    for (int i = 0; i < POPULATION_SIZE; i++) {
+    LOG_SUMMARY("Inicializando populacao...\n");
+    Island* islands = calloc(island_count, sizeof(Island));
+    int first_island = island_process_rank * island_count;
+
+    PROFILE_PHASE_BEGIN(PHASE_INIT_POPULATION);
+    if (island_count == 1) {
+        LOG_SUMMARY("Avaliando populacao inicial...\n");
+        island_init(&islands[0], first_island, true);
+    } else {
+        LOG_SUMMARY("Avaliando populacoes iniciais das ilhas...\n");
         #ifdef _OPENMP
-            #pragma omp critical
+            #pragma omp parallel for num_threads(island_count) schedule(static, 1)
         #endif
-        {
-            printf("  Avaliando individuo %d/%d...\r", i+1, POPULATION_SIZE);
-            fflush(stdout);
+        for (int t = 0; t < island_count; t++) {
+            island_init(&islands[t], first_island + t, false);
         }
-        evaluate_genome(&population[i]);
     }
-    printf("\n");
 
-    int best_idx = 0;
-    double min_fitness = population[0].fitness;
-    double max_fitness = population[0].fitness;
-    for (int i = 1; i < POPULATION_SIZE; i++) {
-        if (population[i].fitness > population[best_idx].fitness) {
-            best_idx = i;
+    Genome* best_initial = &islands[0].population[0];
+    double min_fitness = best_initial->fitness;
+    double max_fitness = best_initial->fitness;
+    for (int t = 0; t < island_count; t++) {
+        for (int i = 0; i < population_size; i++) {
+            Genome* genome = &islands[t].population[i];
+            if (genome->fitness > best_initial->fitness) best_initial = genome;
+            if (genome->fitness < min_fitness) min_fitness = genome->fitness;
+            if (genome->fitness > max_fitness) max_fitness = genome->fitness;
         }
-        if (population[i].fitness < min_fitness) min_fitness = population[i].fitness;
-        if (population[i].fitness > max_fitness) max_fitness = population[i].fitness;
     }
 
-    printf("\nMelhor inicial: %d placas, %.2f%% eff, fitness=%.2f\n",
-           population[best_idx].board_count,
-           population[best_idx].total_efficiency,
-           population[best_idx].fitness);
-    printf("Range de fitness: min=%.2f, max=%.2f, diff=%.2f\n\n",
-           min_fitness, max_fitness, max_fitness - min_fitness);
+    LOG_SUMMARY("\nMelhor inicial: %d placas, %.2f%% eff, fitness=%.2f\n",
+                best_initial->board_count,
+                best_initial->total_efficiency,
+                best_initial->fitness);
+    LOG_SUMMARY("Range de fitness: min=%.2f, max=%.2f, diff=%.2f\n\n",
+                min_fitness, max_fitness, max_fitness - min_fitness);
 
-    evaluate_genome_to_global(&population[best_idx]);
+    evaluate_genome_to_global(best_initial);
     save_best_result();
+    best_result_improved();
+    PROFILE_PHASE_END(PHASE_INIT_POPULATION);
 
-    printf("Iniciando evolucao...\n");
-    printf("=========================================\n");
-
-    // Variáveis para detectar estagnação e fazer restart
-    double last_best_fitness = -DBL_MAX;
-    int stagnation_count = 0;
-    const int STAGNATION_LIMIT = 10;  // Se ficar 10 gerações sem melhoria, fazer restart
-
-    for (int gen = 0; gen < GENERATIONS; gen++) {
-        // Ordenar populacao por fitness (decrescente) - bubble sort
-        for (int i = 0; i < POPULATION_SIZE - 1; i++) {
-            for (int j = 0; j < POPULATION_SIZE - i - 1; j++) {
-                if (population[j].fitness < population[j + 1].fitness) {
-                    Genome temp = population[j];
-                    population[j] = population[j + 1];
-                    population[j + 1] = temp;
-                }
-            }
-        }
-
-        // CORRIGIDO: Comparação direta de fitness
-        double current_best_fitness = best_result.total_efficiency * 2.0 - best_result.board_count * 5.0;
-        if (population[0].fitness > current_best_fitness) {
-            evaluate_genome_to_global(&population[0]);
-            save_best_result();
-        }
-
-        // NOVO: Detecção de estagnação e restart parcial da população
-        if (fabs(population[0].fitness - last_best_fitness) < 0.01) {
-            stagnation_count++;
-        } else {
-            stagnation_count = 0;
-            last_best_fitness = population[0].fitness;
-        }
-
-        // Se estagnado por muito tempo, fazer restart de 50% da população (menos elite)
-        if (stagnation_count >= STAGNATION_LIMIT && gen < GENERATIONS - 5) {
-            printf("  [RESTART] Estagnacao detectada (gen %d), reiniciando 50%% da populacao...\n", gen);
-            int restart_start = ELITE_SIZE;
-            int restart_end = POPULATION_SIZE / 2;
-
-            for (int i = restart_start; i < restart_end; i++) {
-                free_genome(&population[i]);
-                population[i] = create_random_genome();
-                evaluate_genome(&population[i]);
-            }
-            stagnation_count = 0;
-        }
-
-        // Mostrar progresso a cada 5 gerações ou na última
-        if (gen % 5 == 0 || gen == GENERATIONS - 1) {
-            double avg_fitness = 0;
-            double min_gen_fit = population[0].fitness;
-            double max_gen_fit = population[0].fitness;
+    LOG_SUMMARY("Iniciando evolucao...\n");
+    LOG_SUMMARY("=========================================\n");
 
-            #ifdef _OPENMP
-                #pragma omp parallel for reduction(+:avg_fitness) reduction(min:min_gen_fit) reduction(max:max_gen_fit)
-            #endif
-            for (int i = 0; i < POPULATION_SIZE; i++) {
-                avg_fitness += population[i].fitness;
-                if (population[i].fitness < min_gen_fit) min_gen_fit = population[i].fitness;
-                if (population[i].fitness > max_gen_fit) max_gen_fit = population[i].fitness;
-            }
-            avg_fitness /= POPULATION_SIZE;
-
-            printf("Geracao %4d: Melhor=%d placas, %.2f%% eff, fitness=%.2f | Media=%.2f\n",
-                   gen,
-                   population[0].board_count,
-                   population[0].total_efficiency,
-                   population[0].fitness,
-                   avg_fitness);
-        }
-
-        Genome* new_population = malloc(sizeof(Genome) * POPULATION_SIZE);
+    if (island_total > 1 && steady_state_mode) {
+        LOG_SUMMARY("Aviso: --steady-state ignorado no modelo de ilhas\n");
+        steady_state_mode = false;
+    }
 
-        for (int i = 0; i < ELITE_SIZE; i++) {
-            new_population[i] = copy_genome(&population[i]);
+    PROFILE_PHASE_BEGIN(PHASE_EVOLUTION);
+    if (steady_state_mode) {
+        LOG_SUMMARY("Modo estado estacionario: %d avaliacoes assincronas\n",
+                    generations * (population_size - elite_size));
+        run_steady_state(&islands[0]);
+    } else if (island_count == 1) {
+        for (int gen = 0; gen < generations && !evolution_check_stop(); gen++) {
+            island_generation(&islands[0], gen, true);
         }
-
+    } else {
+        // Sem barreira global: cada ilha avanca no seu ritmo, sincronizando
+        // apenas com os vizinhos nas migracoes
         #ifdef _OPENMP
-            #pragma omp parallel for schedule(dynamic)
-        #endif
-        for (int i = ELITE_SIZE; i < POPULATION_SIZE; i++) {
-            int parent1_idx, parent2_idx;
-
-            #ifdef _OPENMP
-                #pragma omp critical
-            #endif
+            #pragma omp parallel num_threads(island_count)
             {
-                parent1_idx = tournament_selection(population, POPULATION_SIZE);
-                parent2_idx = tournament_selection(population, POPULATION_SIZE);
+                Island* island = &islands[omp_get_thread_num()];
+                for (int gen = 0; gen < generations; gen++) {
+                    if (evolution_check_stop()) {
+                        island_retire(island);   // Vizinhos nao esperam por uma ilha encerrada
+                        break;
+                    }
+                    island_generation(island, gen, false);
+                }
             }
-
-            Genome child = order_crossover(&population[parent1_idx], &population[parent2_idx]);
-            mutate_genome(&child);
-            evaluate_genome(&child);
-
-            new_population[i] = child;
-        }
-
-        for (int i = 0; i < POPULATION_SIZE; i++) {
-            free_genome(&population[i]);
-        }
-        free(population);
-
-        population = new_population;
+        #endif
     }
+    log_flush_all();
 
-    printf("=========================================\n\n");
+    PROFILE_PHASE_END(PHASE_EVOLUTION);
+    LOG_SUMMARY("=========================================\n\n");
 
-    clock_t end_time = clock();
-    best_result.execution_time = ((double)(end_time - start_time)) / CLOCKS_PER_SEC;
+    // Tempo de parede (clock() somaria o tempo de CPU de todas as threads)
+    best_result.execution_time = wall_time() - run_start_time;
+    #if ENABLE_BENCHMARKS
+        bench_csv_row(-1);   // Linha final (geracao -1): contadores totais da execucao
+        bench_csv_close();
+    #endif
+    const char* stop_reason = "generations";
+    if (evolution_stop_reason == STOP_TIME_LIMIT) {
+        stop_reason = "time_limit";
+        LOG_SUMMARY("Evolucao encerrada pelo limite de tempo (%.1f s)\n", time_limit_seconds);
+    } else if (evolution_stop_reason == STOP_STALL) {
+        stop_reason = "stall";
+        LOG_SUMMARY("Evolucao encerrada por estagnacao (%.1f s sem melhoria)\n", stall_limit_seconds);
+    }
 
-    printf("\n========================================\n");
-    printf("  RESULTADO FINAL\n");
-    printf("========================================\n");
-    printf("Placas utilizadas: %d\n", best_result.board_count);
-    printf("Eficiencia total: %.2f%%\n", best_result.total_efficiency);
-    printf("Tempo de execucao: %.2f segundos\n", best_result.execution_time);
-    printf("\nDetalhamento por placa:\n");
+    LOG_SUMMARY("\n========================================\n");
+    LOG_SUMMARY("  RESULTADO FINAL\n");
+    LOG_SUMMARY("========================================\n");
+    LOG_SUMMARY("Placas utilizadas: %d\n", best_result.board_count);
+    LOG_SUMMARY("Eficiencia total: %.2f%%\n", best_result.total_efficiency);
+    LOG_SUMMARY("Tempo de execucao: %.2f segundos\n", best_result.execution_time);
+    LOG_SUMMARY("Cache de fitness: %lld acertos, %lld falhas (%.1f%% de acerto)\n",
+                fitness_cache_hits, fitness_cache_misses,
+                fitness_cache_hits + fitness_cache_misses > 0 ?
+                100.0 * fitness_cache_hits / (fitness_cache_hits + fitness_cache_misses) : 0.0);
+    if (prefix_placements_total > 0) {
+        LOG_SUMMARY("Avaliacao incremental: %.1f%% das colocacoes reaproveitadas de prefixos\n",
+                    100.0 * prefix_placements_reused / prefix_placements_total);
+    }
+    LOG_SUMMARY("\nDetalhamento por placa:\n");
 
     for (int i = 0; i < best_result.board_count; i++) {
-        printf("  Placa %d: %d pecas, %.2f%% eficiencia\n",
-               i + 1,
-               best_result.boards[i].piece_count,
-               best_result.boards[i].efficiency);
+        LOG_SUMMARY("  Placa %d: %d pecas, %.2f%% eficiencia\n",
+                    i + 1,
+                    best_result.boards[i].piece_count,
+                    best_result.boards[i].efficiency);
     }
 
-    write_output_json("genetic_nesting_optimized_result.json");
-    printf("\nResultado salvo em: genetic_nesting_optimized_result.json\n");
+    PROFILE_PHASE_BEGIN(PHASE_OUTPUT);
+    write_result(result_path);
+    PROFILE_PHASE_END(PHASE_OUTPUT);
+    LOG_SUMMARY("\nResultado salvo em: %s\n", result_path);
 
 #if ENABLE_CONCAVE_NESTING
     // ==================== PHASE 3: CONCAVE NESTING OPTIMIZATION ====================
-    printf("\n========================================\n");
-    printf("  FASE 3: OTIMIZACAO DE CONCAVIDADES\n");
-    printf("========================================\n\n");
-
-    printf("Parametros de precisao configurados:\n");
-    printf("  Grid principal: %dx%d (%d pontos candidatos por peca)\n",
-           GRID_RESOLUTION, GRID_RESOLUTION, GRID_RESOLUTION * GRID_RESOLUTION);
-    printf("  Sub-grid de refinamento: %dx%d pontos\n",
-           SUBGRID_RESOLUTION, SUBGRID_RESOLUTION);
-    printf("  Rotacoes: Usa allowed_angles de cada peca (respeita input_shapes.json)\n");
-    printf("  Threshold de concavidade: %.0f%% de espaco vazio\n",
-           CONCAVITY_THRESHOLD * 100);
-    printf("  Tamanho maximo de peca pequena: %.0f%% da peca grande\n\n",
-           MAX_SMALL_PIECE_RATIO * 100);
+    LOG_SUMMARY("\n========================================\n");
+    LOG_SUMMARY("  FASE 3: OTIMIZACAO DE CONCAVIDADES\n");
+    LOG_SUMMARY("========================================\n\n");
+
+    LOG_SUMMARY("Parametros de precisao configurados:\n");
+    LOG_SUMMARY("  Grid principal: %dx%d (%d pontos candidatos por peca)\n",
+                grid_resolution, grid_resolution, grid_resolution * grid_resolution);
+    LOG_SUMMARY("  Sub-grid de refinamento: %dx%d pontos\n",
+                subgrid_resolution, subgrid_resolution);
+    LOG_SUMMARY("  Rotacoes: Usa allowed_angles de cada peca (respeita input_shapes.json)\n");
+    LOG_SUMMARY("  Threshold de concavidade: %.0f%% de espaco vazio\n",
+                concavity_threshold * 100);
+    LOG_SUMMARY("  Tamanho maximo de peca pequena: %.0f%% da peca grande\n\n",
+                max_small_piece_ratio * 100);
 
     // Optimization is applied to each board independently
+    PROFILE_PHASE_BEGIN(PHASE_CONCAVE);
     double total_initial_efficiency = best_result.total_efficiency;
 
-    for (int board_idx = 0; board_idx < best_result.board_count; board_idx++) {
-        printf("Otimizando Placa %d/%d:\n", board_idx + 1, best_result.board_count);
-        optimize_concave_nesting(&best_result.boards[board_idx]);
-        printf("\n");
+    // Placas independentes: com placas suficientes para ocupar as threads, uma
+    // placa por thread; senao placas em serie e a busca de encaixe em paralelo.
+    // O resultado e o mesmo nos dois casos (vence o primeiro encaixe na ordem serial).
+    int board_total = best_result.board_count;
+    LogBuffer* concave_logs = calloc(board_total > 0 ? board_total : 1, sizeof(LogBuffer));
+    #ifdef _OPENMP
+        bool parallel_boards = board_total > 1 && board_total >= omp_get_max_threads();
+    #else
+        bool parallel_boards = false;
+    #endif
+
+    if (parallel_boards) {
+        #ifdef _OPENMP
+            #pragma omp parallel for schedule(dynamic, 1)
+        #endif
+        for (int board_idx = 0; board_idx < board_total; board_idx++) {
+            Board* board = &best_result.boards[board_idx];
+            board->grid.arena = get_thread_arena();   // Crescimento da grade fora da arena compartilhada
+            concave_log(&concave_logs[board_idx], LOG_LEVEL_SUMMARY, "Otimizando Placa %d/%d:\n", board_idx + 1, board_total);
+            optimize_concave_nesting(board, false, &concave_logs[board_idx]);
+        }
+    } else {
+        for (int board_idx = 0; board_idx < board_total; board_idx++) {
+            concave_log(&concave_logs[board_idx], LOG_LEVEL_SUMMARY, "Otimizando Placa %d/%d:\n", board_idx + 1, board_total);
+            optimize_concave_nesting(&best_result.boards[board_idx], true, &concave_logs[board_idx]);
+        }
+    }
+
+    for (int board_idx = 0; board_idx < board_total; board_idx++) {
+        concave_log(&concave_logs[board_idx], LOG_LEVEL_SUMMARY, "\n");
+        log_buffer_write(&concave_logs[board_idx]);
+        free(concave_logs[board_idx].data);
     }
+    free(concave_logs);
 
     // Recalculate total efficiency after all boards optimized
     double total_used_area = 0;
@@ -2063,56 +7066,65 @@ int main(int argc, char* argv[]) {
     }
     double total_board_area = best_result.board_count * input_data.board_x * input_data.board_y;
     best_result.total_efficiency = total_board_area > 0 ? (total_used_area / total_board_area) * 100.0 : 0.0;
+    PROFILE_PHASE_END(PHASE_CONCAVE);
 
-    printf("========================================\n");
-    printf("  RESUMO DA FASE 3\n");
-    printf("========================================\n");
-    printf("Eficiencia total inicial: %.2f%%\n", total_initial_efficiency);
-    printf("Eficiencia total final: %.2f%%\n", best_result.total_efficiency);
+    LOG_SUMMARY("========================================\n");
+    LOG_SUMMARY("  RESUMO DA FASE 3\n");
+    LOG_SUMMARY("========================================\n");
+    LOG_SUMMARY("Eficiencia total inicial: %.2f%%\n", total_initial_efficiency);
+    LOG_SUMMARY("Eficiencia total final: %.2f%%\n", best_result.total_efficiency);
 
     if (best_result.total_efficiency > total_initial_efficiency) {
-        printf("Melhoria total: +%.2f%%\n", best_result.total_efficiency - total_initial_efficiency);
+        LOG_SUMMARY("Melhoria total: +%.2f%%\n", best_result.total_efficiency - total_initial_efficiency);
 
         // Save optimized result
-        write_output_json("genetic_nesting_optimized_result.json");
-        printf("\nResultado otimizado salvo em: genetic_nesting_optimized_result.json\n");
+        PROFILE_PHASE_BEGIN(PHASE_OUTPUT);
+        write_result(result_path);
+        PROFILE_PHASE_END(PHASE_OUTPUT);
+        LOG_SUMMARY("\nResultado otimizado salvo em: %s\n", result_path);
     } else {
-        printf("Nenhuma melhoria significativa obtida.\n");
+        LOG_SUMMARY("Nenhuma melhoria significativa obtida.\n");
     }
 
-    printf("========================================\n\n");
+    LOG_SUMMARY("========================================\n\n");
+    progress_event("concave", "\"initial_efficiency\": %.4f, \"efficiency\": %.4f",
+                   total_initial_efficiency, best_result.total_efficiency);
 #endif // ENABLE_CONCAVE_NESTING
 
-    for (int i = 0; i < POPULATION_SIZE; i++) {
-        free_genome(&population[i]);
-    }
-    free(population);
+    if (simplify_tolerance > 0) validate_exact_layout(&best_result);
 
-    for (int i = 0; i < input_data.piece_count; i++) {
-        free(input_data.pieces[i].points);
-        free(input_data.pieces[i].allowed_angles);
-    }
-    free(input_data.pieces);
+    progress_event("end", "\"boards\": %d, \"efficiency\": %.4f, \"execution_time\": %.3f, \"stop\": \"%s\"",
+                   best_result.board_count, best_result.total_efficiency, best_result.execution_time,
+                   stop_reason);
+    progress_close();
 
-    for (int i = 0; i < best_result.board_count; i++) {
-        for (int j = 0; j < best_result.boards[i].piece_count; j++) {
-            free(best_result.boards[i].placed_pieces[j].rotated_piece.points);
-        }
-        free(best_result.boards[i].placed_pieces);
+    #if ENABLE_PROFILING
+        #ifdef _OPENMP
+            profile_report(omp_get_max_threads() > island_count ? omp_get_max_threads() : island_count);
+        #else
+            profile_report(1);
+        #endif
+    #endif
+
+    for (int t = 0; t < island_count; t++) {
+        island_free(&islands[t]);
     }
-    free(best_result.boards);
+    free(islands);
+    migration_hub_close();
 
-    // Liberar seeds das threads
-    #ifdef _OPENMP
-        if (thread_seeds != NULL) {
-            free(thread_seeds);
-            thread_seeds = NULL;
-        }
-    #endif
+    free_input_data();
+    fitness_cache_free();
+    nfp_free();
+    shape_table_free();
+
+    arena_destroy(&result_arena);
+    arena_destroy(&best_result_arena);
+
+    free_thread_arenas();
 
-    printf("\n========================================\n");
-    printf("  EXECUCAO CONCLUIDA COM SUCESSO\n");
-    printf("========================================\n");
+    LOG_SUMMARY("\n========================================\n");
+    LOG_SUMMARY("  EXECUCAO CONCLUIDA COM SUCESSO\n");
+    LOG_SUMMARY("========================================\n");
 
     return 0;
 }